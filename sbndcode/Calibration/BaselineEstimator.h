@@ -0,0 +1,144 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   BaselineEstimator.h
+///
+/// \brief  Baseline estimates of deconvoluted waveforms, without ROOT
+///         histograms.
+///
+/// Methods:
+///
+/// Mode           - most populated bin of a histogram of the samples, with
+///                  the binning CalWireSBND used with TH1F: as many bins of
+///                  about one unit as fit between min(0, samples) and
+///                  max(0, samples); the largest sample falls in the
+///                  overflow, as with TH1F. Counts are integers in a
+///                  buffer reused from call to call.
+/// TruncatedMean  - mean of the samples within a half width of a center.
+/// ModeMean       - truncated mean around the mode (half width 2), falling
+///                  back to the mode; this is the former TH1F baseline.
+///                  Samples spanning less than one unit have no mode, and
+///                  both Mode and ModeMean return 0 for them.
+/// RollingMedian  - median of a window of samples around each sample, for
+///                  baselines which drift along the waveform.
+///
+/// An estimator keeps its buffers across calls, so it should be owned by
+/// (one thread of) the caller and reused for all channels.
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef BASELINEESTIMATOR_H
+#define BASELINEESTIMATOR_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace caldata {
+
+  class BaselineEstimator {
+  public:
+
+    /// Most probable value of the samples, or 0 if they span less than one unit
+    float Mode(float const* data, std::size_t n)
+      { float mode; return FindMode(data, n, mode)? mode: 0.f; }
+
+    /// Mean of the samples within halfWidth of center; center if there are none
+    static float TruncatedMean(float const* data, std::size_t n, float center, float halfWidth);
+
+    /// Truncated mean around the mode, as the former TH1F baseline
+    float ModeMean(float const* data, std::size_t n, float halfWidth = 2.)
+      {
+        float mode;
+        return FindMode(data, n, mode)? TruncatedMean(data, n, mode, halfWidth): 0.f;
+      }
+
+    /// Median of the (up to) window samples centred on each sample
+    void RollingMedian(float const* data, std::size_t n, std::size_t window,
+                       std::vector<float>& baseline);
+
+    float Mode(std::vector<float> const& data) { return Mode(data.data(), data.size()); }
+    float ModeMean(std::vector<float> const& data, float halfWidth = 2.)
+      { return ModeMean(data.data(), data.size(), halfWidth); }
+
+  private:
+
+    /// Fill the mode histogram; false if the samples span less than one unit
+    bool FindMode(float const* data, std::size_t n, float& mode);
+
+    std::vector<unsigned int> fCounts;  ///< histogram of the mode
+    std::vector<float> fWindow;         ///< sorted samples of the rolling median window
+  };
+
+} // namespace caldata
+
+//----------------------------------------------------------------------
+inline bool caldata::BaselineEstimator::FindMode(float const* data, std::size_t n, float& mode)
+{
+  float min = 0, max = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    min = std::min(min, data[i]);
+    max = std::max(max, data[i]);
+  }
+  int const nbin = max - min;
+  if (nbin <= 0) return false;
+
+  // same bin assignment as TH1::Fill (TAxis::FindBin) for a TH1F(nbin, min, max)
+  double const xmin = min;
+  double const xmax = max;
+  fCounts.assign(nbin, 0);
+  for (std::size_t i = 0; i < n; ++i) {
+    double const x = data[i];
+    if (x < xmin || !(x < xmax)) continue; // under/overflow
+    ++fCounts[int(nbin*(x - xmin)/(xmax - xmin))];
+  }
+
+  // first bin with the highest count, as TH1::GetMaximumBin, and its
+  // center, as TAxis::GetBinCenter
+  int const maxBin = std::max_element(fCounts.begin(), fCounts.end()) - fCounts.begin();
+  double const binWidth = (xmax - xmin)/nbin;
+  mode = xmin + maxBin*binWidth + 0.5*binWidth;
+  return true;
+}
+
+//----------------------------------------------------------------------
+inline float caldata::BaselineEstimator::TruncatedMean(float const* data, std::size_t n,
+                                                       float center, float halfWidth)
+{
+  float sum = 0;
+  int ncount = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    if (std::fabs(data[i] - center) < halfWidth) {
+      sum += data[i];
+      ++ncount;
+    }
+  }
+  return ncount? sum/ncount: center;
+}
+
+//----------------------------------------------------------------------
+inline void caldata::BaselineEstimator::RollingMedian(float const* data, std::size_t n,
+                                                      std::size_t window,
+                                                      std::vector<float>& baseline)
+{
+  baseline.resize(n);
+  if (n == 0) return;
+  std::size_t const half = std::max<std::size_t>(window, 1)/2;
+
+  // the window of sample i is [i - half, i + half], clipped to the waveform;
+  // it is kept sorted, adding and removing one sample per step
+  fWindow.clear();
+  std::size_t last = 0; // one past the last sample in the window
+  for (std::size_t i = 0; i < n; ++i) {
+    for (; last < n && last <= i + half; ++last)
+      fWindow.insert(std::upper_bound(fWindow.begin(), fWindow.end(), data[last]), data[last]);
+    if (i > half) {
+      float const old = data[i - half - 1];
+      fWindow.erase(std::lower_bound(fWindow.begin(), fWindow.end(), old));
+    }
+    std::size_t const size = fWindow.size();
+    baseline[i] = (size % 2)? fWindow[size/2]: 0.5f*(fWindow[size/2 - 1] + fWindow[size/2]);
+  }
+}
+
+#endif // BASELINEESTIMATOR_H
@@ -9,6 +9,8 @@
 //  copied over and modified to SBND   
 ////////////////////////////////////////////////////////////////////////
 
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <stdint.h>
@@ -27,10 +29,13 @@
 #include "cetlib_except/exception.h"
 #include "cetlib/search_path.h"
 #include "art/Utilities/make_tool.h"
+#include "art/Persistency/Common/PtrMaker.h"
 #include "lardata/ArtDataHelper/WireCreator.h"
 
 #include "sbndcode/Utilities/SignalShapingServiceSBND.h"
+#include "sbndcode/Utilities/FFTWorkspaceSBND.h"
 #include "sbndcode/Calibration/IROIFinder.h"
+#include "sbndcode/Calibration/BaselineEstimator.h"
 #include "larcore/Geometry/Geometry.h"
 //#include "Filters/ChannelFilter.h"
 
@@ -46,6 +51,10 @@
 #include "TFile.h"
 #include "TH1F.h"
 
+#include "tbb/blocked_range.h"
+#include "tbb/enumerable_thread_specific.h"
+#include "tbb/parallel_for.h"
+
 ///creation of calibrated signals on wires
 namespace caldata {
 
@@ -80,6 +89,11 @@ namespace caldata {
     bool          fDoAdvBaselineSub;  ///< use interpolation-based baseline subtraction
     int           fBaseSampleBins;    ///< bin grouping size in "interpolate"  method
     float         fBaseVarCut;        ///< baseline variance cut used in "interpolate" method
+    bool          fUseRollingMedian;  ///< subtract a rolling median instead of the mode-based mean
+    size_t        fBaseMedianWindow;  ///< samples in the rolling median window
+    float         fBaseValidationTol; ///< compare the baseline to the TH1F one, if positive
+    bool          fParallelCalibration; ///< calibrate channels concurrently
+    unsigned int  fParallelGrainSize; ///< number of channels per task in parallel calibration
    
     std::string  fDigitModuleLabel;   ///< module that made digits
                                                        
@@ -87,9 +101,36 @@ namespace caldata {
                               ///< it is set by the DigitModuleLabel
                               ///< ex.:  "daq:preSpill" for prespill data
     
-    void          SubtractBaseline(std::vector<float>& holder);
-    void          SubtractBaselineAdv(std::vector<float>& holder);
+    /// FFT plans and scratch space of the calibration of a sequence of digits
+    struct DeconWorkspace {
+      DeconWorkspace(int transformSize, std::string const& fftOptions)
+        : fft(transformSize, fftOptions), holders(kDeconBlockSize) {}
+      util::FFTWorkspaceSBND          fft;
+      std::vector<short>              rawadc;             ///< uncompressed adc values
+      std::vector<std::vector<float>> holders;            ///< signal data of a block of channels
+      BaselineEstimator               baselineEstimator;  ///< histogram and median buffers
+      std::vector<float>              baseline;           ///< rolling median baseline
+    };
+
+    /// Calibrate digits [first, last), storing each wire at its digit index
+    void          CalibrateDigits(detinfo::DetectorClocksData const& clockData,
+                                  std::vector<raw::RawDigit> const& digits,
+                                  size_t first, size_t last,
+                                  unsigned int dataSize, int transformSize,
+                                  DeconWorkspace& ws, std::vector<recob::Wire>& wires) const;
+
+    void          SubtractBaseline(std::vector<float>& holder, DeconWorkspace& ws) const;
+    void          SubtractBaselineAdv(std::vector<float>& holder) const;
+    float         HistogramBaseline(std::vector<float> const& holder) const;
     
+    int fWorkspaceSize = 0;                                ///< transform size of the workspaces
+    std::unique_ptr<DeconWorkspace> fWorkspace;            ///< workspace of the serial calibration
+    std::unique_ptr<tbb::enumerable_thread_specific<DeconWorkspace>> fWorkspaces; ///< per-thread workspaces
+    mutable std::mutex fHistogramMutex;                    ///< serialises the TH1F baseline validation
+
+    /// Maximum number of channels of the same view deconvoluted in one batch
+    static constexpr size_t kDeconBlockSize{64};
+
 
   protected: 
     
@@ -125,6 +166,17 @@ namespace caldata {
     fDoAdvBaselineSub = p.get< bool >       ("DoAdvBaselineSub");
     fBaseSampleBins   = p.get< int >        ("BaseSampleBins");
     fBaseVarCut       = p.get< int >        ("BaseVarCut");
+
+    std::string const baselineMethod = p.get< std::string >("BaselineMethod", "mode");
+    if (baselineMethod != "mode" && baselineMethod != "median") {
+      throw cet::exception("CalWireSBND")
+        << "BaselineMethod must be \"mode\" or \"median\", not \"" << baselineMethod << "\"\n";
+    }
+    fUseRollingMedian  = (baselineMethod == "median");
+    fBaseMedianWindow  = p.get< size_t >     ("BaselineMedianWindow", 501);
+    fBaseValidationTol = p.get< float >      ("BaselineValidationTolerance", 0.);
+    fParallelCalibration = p.get< bool >       ("ParallelCalibration", false);
+    fParallelGrainSize = p.get< unsigned int > ("ParallelGrainSize", kDeconBlockSize);
     
     fSpillName="";
     
@@ -149,16 +201,9 @@ namespace caldata {
   //////////////////////////////////////////////////////
   void CalWireSBND::produce(art::Event& evt)
   {      
-    // get the geometry
-    art::ServiceHandle<geo::Geometry> geom;
-
     // get the FFT service to have access to the FFT size
     art::ServiceHandle<util::LArFFT> fFFT;
-    int transformSize = fFFT->FFTSize();
-
-    // Get signal shaping service.
-    art::ServiceHandle<util::SignalShapingServiceSBND> sss;
-    double DeconNorm = sss->GetDeconNorm();
+    int const transformSize = fFFT->FFTSize();
 
     // make a collection of Wires
     std::unique_ptr<std::vector<recob::Wire> > wirecol(new std::vector<recob::Wire>);
@@ -181,14 +226,12 @@ namespace caldata {
     unsigned int dataSize = digitVec0->Samples(); //size of raw data vectors
 
 
+    // the FFT can't be resized here: SignalShapingServiceSBND has built its
+    // deconvolution kernels with the configured size at the beginning of the run
     if( (unsigned int)transformSize < dataSize){
-      mf::LogWarning("CalWireSBND")<<"FFT size (" << transformSize << ") "
-                                    << "is smaller than the data size (" << dataSize << ") "
-                                    << "\nResizing the FFT now...";
-      fFFT->ReinitializeFFT(dataSize,fFFT->FFTOptions(),fFFT->FFTFitBins());
-      transformSize = fFFT->FFTSize();
-      mf::LogWarning("CalWireSBND")<<"FFT size is now (" << transformSize << ") "
-                                    << "and should be larger than the data size (" << dataSize << ")";
+      throw cet::exception("CalWireSBND") << "FFT size (" << transformSize << ") "
+                                          << "is smaller than the data size (" << dataSize << "): "
+                                          << "increase LArFFT FFTSize\n";
     }
 
     mf::LogInfo("CalWireSBND") << "Data size is " << dataSize << " and transform size is " << transformSize;
@@ -197,92 +240,36 @@ namespace caldata {
       mf::LogError("CalWireSBND")<<"Set BaseSampleBins modulo dataSize= "<<dataSize;
     }
 
-    uint32_t     channel(0); // channel number
-    unsigned int bin(0);     // time bin loop variable
-    
 ///    filter::ChannelFilter *chanFilt = new filter::ChannelFilter();  
 
-    std::vector<float> holder;                // holds signal data
-    std::vector<short> rawadc(transformSize);  // vector holding uncompressed adc values
-    std::vector<TComplex> freqHolder(transformSize+1); // temporary frequency data
+    // plans and scratch space are kept across events, unless the FFT size changes
+    if (fWorkspaceSize != transformSize) {
+      if (fParallelCalibration)
+        fWorkspaces = std::make_unique<tbb::enumerable_thread_specific<DeconWorkspace>>(transformSize, fFFT->FFTOptions());
+      else
+        fWorkspace = std::make_unique<DeconWorkspace>(transformSize, fFFT->FFTOptions());
+      fWorkspaceSize = transformSize;
+    }
     
     auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(evt);
 
-    // loop over all wires    
-    wirecol->reserve(digitVecHandle->size());
-    for(size_t rdIter = 0; rdIter < digitVecHandle->size(); ++rdIter){ // ++ move
-      holder.clear();
-      
-      // get the reference to the current raw::RawDigit
-      art::Ptr<raw::RawDigit> digitVec(digitVecHandle, rdIter);
-      channel = digitVec->Channel();
-
-      // skip bad channels
-      //  if(!chanFilt->BadChannel(channel)) {
-      if(true) {
-
-        // resize and pad with zeros
-        holder.resize(transformSize, 0.);
-        
-        // uncompress the data
-        raw::Uncompress(digitVec->ADCs(), rawadc, digitVec->Compression());
-        
-        // loop over all adc values and subtract the pedestal
-        float pdstl = digitVec->GetPedestal();
-        
-        for(bin = 0; bin < dataSize; ++bin) 
-          holder[bin]=(rawadc[bin]-pdstl);
-
-	//fill the remaining bin with data
-	for(bin = dataSize; bin < holder.size(); bin++){
-	  //  philosophy change - don't repeat data but instead fill extra space with zeros.
-          //    not sure that one is better than the other.
-	  //	  holder[bin] = (rawadc[bin-dataSize]-pdstl);
-	  holder[bin] = 0.0;
-	}
-
-        // Do deconvolution.
-        sss->Deconvolute(clockData, channel, holder);
-	  for(bin = 0; bin < holder.size(); ++bin) holder[bin]=holder[bin]/DeconNorm;
-      } // end if not a bad channel 
-      
-      holder.resize(dataSize,1e-5);
-
-      // restore DC component through baseline subtraction
-      if( fDoBaselineSub ) SubtractBaseline(holder);
-      // more advanced, interpolation-based subtraction alg 
-      // that uses the BaseSampleBins and BaseVarCut params
-      if( fDoAdvBaselineSub ) SubtractBaselineAdv(holder);
-
-      // Make a single ROI that spans the entire data size
-      //RegionsOfInterest_t sparse_holder;
-      //sparse_holder.add_range(0,holder.begin(),holder.end());
-      CandidateROIVec candROIVec;
-      fROITool->FindROIs( holder, channel, candROIVec);//calculates ROI and returns it to roiVec.
-      //auto view = geom->View(channel);
-      recob::Wire::RegionsOfInterest_t roiVec;
-
-      //looping over roiVec to make a RegionOfInterest_t object.
-      for(auto const& CandidateROI: candROIVec){
-	size_t roiStart = CandidateROI.first;
-	size_t roiStop = CandidateROI.second;
-	std::vector<float> roiHolder;
-	for(size_t i_holder=roiStart; i_holder<=roiStop; i_holder++){
-	  roiHolder.push_back(holder[i_holder]);
-	}
-	roiVec.add_range(roiStart, std::move(roiHolder));
-      }
-      wirecol->push_back(recob::WireCreator(std::move(roiVec),*digitVec).move());
-
-
-      // add an association between the last object in wirecol--Hec
-      // (that we just inserted) and digitVec
-      if (!util::CreateAssn(*this, evt, *wirecol, digitVec, *WireDigitAssn, fSpillName)) {
-        throw cet::exception("CalWireSBND")
-          << "Can't associate wire #" << (wirecol->size() - 1)
-          << " with raw digit #" << digitVec.key() << "\n";
-      } // if failed to add association
+    // one wire per digit, stored at the digit index
+    std::vector<raw::RawDigit> const& digits = *digitVecHandle;
+    size_t const nDigits = digits.size();
+    wirecol->resize(nDigits);
+    if (fParallelCalibration) {
+      tbb::parallel_for(tbb::blocked_range<size_t>(0, nDigits, fParallelGrainSize),
+        [&](tbb::blocked_range<size_t> const& range) {
+          CalibrateDigits(clockData, digits, range.begin(), range.end(), dataSize, transformSize,
+                          fWorkspaces->local(), *wirecol);
+        });
     }
+    else CalibrateDigits(clockData, digits, 0, nDigits, dataSize, transformSize, *fWorkspace, *wirecol);
+
+    // associations, in digit order
+    art::PtrMaker<recob::Wire> makeWirePtr(evt, fSpillName);
+    for(size_t iDigit = 0; iDigit < nDigits; ++iDigit)
+      WireDigitAssn->addSingle(art::Ptr<raw::RawDigit>(digitVecHandle, iDigit), makeWirePtr(iDigit));
 
 
     if(wirecol->size() == 0)
@@ -300,14 +287,115 @@ namespace caldata {
   }
  
   
-  void CalWireSBND::SubtractBaseline(std::vector<float>& holder)
+  //////////////////////////////////////////////////////
+  // Digits are processed in blocks of consecutive channels of the same view,
+  // which share the deconvolution kernel. Everything used here is either
+  // read-only or in the workspace, so that ranges of digits may be
+  // calibrated concurrently, each with its own workspace.
+  void CalWireSBND::CalibrateDigits(detinfo::DetectorClocksData const& clockData,
+                                    std::vector<raw::RawDigit> const& digits,
+                                    size_t first, size_t last,
+                                    unsigned int dataSize, int transformSize,
+                                    DeconWorkspace& ws, std::vector<recob::Wire>& wires) const
   {
+    art::ServiceHandle<geo::Geometry const> geom;
+    art::ServiceHandle<util::SignalShapingServiceSBND const> sss;
+    double DeconNorm = sss->GetDeconNorm();
+
+    unsigned int bin(0);     // time bin loop variable
+
+    std::vector<std::vector<float>*> block;
+    block.reserve(kDeconBlockSize);
+
+    for(size_t blockStart = first; blockStart < last; blockStart += block.size()){
+      geo::View_t const view = geom->View(digits[blockStart].Channel());
+      block.clear();
+      while (block.size() < kDeconBlockSize && blockStart + block.size() < last
+             && geom->View(digits[blockStart + block.size()].Channel()) == view)
+        block.push_back(&ws.holders[block.size()]);
+
+      for(size_t iBlock = 0; iBlock < block.size(); ++iBlock){
+        raw::RawDigit const& digit = digits[blockStart + iBlock];
+        std::vector<float>& holder = *block[iBlock];
+
+        // resize and pad with zeros
+        holder.assign(transformSize, 0.);
+        
+        // uncompress the data
+        ws.rawadc.resize(transformSize);
+        raw::Uncompress(digit.ADCs(), ws.rawadc, digit.Compression());
+        
+        // loop over all adc values and subtract the pedestal
+        //  philosophy change - don't repeat data in the remaining bins
+        //  but instead fill extra space with zeros.
+        float pdstl = digit.GetPedestal();
+        
+        for(bin = 0; bin < dataSize; ++bin) 
+          holder[bin]=(ws.rawadc[bin]-pdstl);
+      }
+
+      // Do deconvolution.
+      sss->DeconvoluteBlock(clockData, view, block, ws.fft);
+
+      for(size_t iBlock = 0; iBlock < block.size(); ++iBlock){
+        std::vector<float>& holder = *block[iBlock];
+        raw::RawDigit const& digit = digits[blockStart + iBlock];
+
+        for(bin = 0; bin < holder.size(); ++bin) holder[bin]=holder[bin]/DeconNorm;
+      
+        holder.resize(dataSize,1e-5);
+
+        // restore DC component through baseline subtraction
+        if( fDoBaselineSub ) SubtractBaseline(holder, ws);
+        // more advanced, interpolation-based subtraction alg 
+        // that uses the BaseSampleBins and BaseVarCut params
+        if( fDoAdvBaselineSub ) SubtractBaselineAdv(holder);
+
+        CandidateROIVec candROIVec;
+        fROITool->FindROIs( holder, digit.Channel(), candROIVec);//calculates ROI and returns it to roiVec.
+        recob::Wire::RegionsOfInterest_t roiVec;
+
+        //looping over roiVec to make a RegionOfInterest_t object.
+        for(auto const& CandidateROI: candROIVec){
+          size_t roiStart = CandidateROI.first;
+          size_t roiStop = CandidateROI.second;
+          std::vector<float> roiHolder(holder.begin() + roiStart, holder.begin() + roiStop + 1);
+          roiVec.add_range(roiStart, std::move(roiHolder));
+        }
+        wires[blockStart + iBlock] = recob::WireCreator(std::move(roiVec),digit).move();
+      }
+    }
+  }
+ 
+  void CalWireSBND::SubtractBaseline(std::vector<float>& holder, DeconWorkspace& ws) const
+  {
+    if (fUseRollingMedian) {
+      // slowly drifting baseline: median of a window around each sample
+      ws.baselineEstimator.RollingMedian(holder.data(), holder.size(), fBaseMedianWindow, ws.baseline);
+      for(size_t bin = 0; bin < holder.size(); bin++) holder[bin] -= ws.baseline[bin];
+      return;
+    }
+
     // Robust baseline calculation that effectively ignores outlier 
     // samples from large pulses:
-    //   (1) fill a histogram with every sample's value,
+    //   (1) histogram every sample's value,
     //   (2) find mode (bin with most entries),
     //   (3) calculate the mean along the entire waveform using
     //       only samples with values close to this mode.
+    float const ped = ws.baselineEstimator.ModeMean(holder);
+    if (fBaseValidationTol > 0.) {
+      float const histPed = HistogramBaseline(holder);
+      if (fabs(ped - histPed) > fBaseValidationTol) {
+        mf::LogWarning("CalWireSBND") << "Baseline " << ped << " differs from the TH1F baseline "
+          << histPed << " by more than " << fBaseValidationTol;
+      }
+    }
+    for(size_t bin = 0; bin < holder.size(); bin++) holder[bin] -= ped;
+  }
+
+  // the original TH1F implementation of the mode-based baseline, for validation
+  float CalWireSBND::HistogramBaseline(std::vector<float> const& holder) const
+  {
     unsigned int bin(0);  
     float min = 0, max = 0;
     for(bin = 0; bin < holder.size(); bin++){
@@ -315,25 +403,26 @@ namespace caldata {
       if (holder[bin] < min) min = holder[bin];
     }
     int nbin = max - min;
-    if (nbin > 0) {
-      TH1F h("h","h",nbin,min,max);
-      for(bin = 0; bin < holder.size(); bin++) h.Fill(holder[bin]);
-      float x_max = h.GetXaxis()->GetBinCenter(h.GetMaximumBin());
-      float ped   = x_max;
-      float sum   = 0;
-      int ncount  = 0;
-      for(bin = 0; bin < holder.size(); bin++){
-        if( fabs(holder[bin]-x_max) < 2. ) {
-          sum += holder[bin];
-          ncount++; 
-        }
+    if (nbin <= 0) return 0.;
+    std::lock_guard<std::mutex> lock(fHistogramMutex);
+    TH1F h("h","h",nbin,min,max);
+    h.SetDirectory(nullptr);
+    for(bin = 0; bin < holder.size(); bin++) h.Fill(holder[bin]);
+    float x_max = h.GetXaxis()->GetBinCenter(h.GetMaximumBin());
+    float ped   = x_max;
+    float sum   = 0;
+    int ncount  = 0;
+    for(bin = 0; bin < holder.size(); bin++){
+      if( fabs(holder[bin]-x_max) < 2. ) {
+        sum += holder[bin];
+        ncount++; 
       }
-      if (ncount) ped = sum/ncount;
-      for(bin = 0; bin < holder.size(); bin++) holder[bin] -= ped;
     }
+    if (ncount) ped = sum/ncount;
+    return ped;
   }
  
-  void CalWireSBND::SubtractBaselineAdv(std::vector<float>& holder)
+  void CalWireSBND::SubtractBaselineAdv(std::vector<float>& holder) const
   {
       // Subtract baseline using linear interpolation between regions defined
       // by the datasize and fBaseSampleBins
@@ -13,6 +13,7 @@
 #ifndef IROIFinder_H
 #define IROIFinder_H
 #include "fhiclcpp/ParameterSet.h"
+#include "sbndcode/Calibration/TruncatedRMS.h"
 namespace art
 {
   class TFileDirectory;
@@ -37,6 +38,15 @@ namespace sbnd_tool
         
       // Find the ROI's
       virtual void FindROIs(const Waveform&, size_t, CandidateROIVec&) const = 0;
+
+    protected:
+      // Truncated RMS of the waveform noise, with scratch space private to
+      // the calling thread (FindROIs is const and may run concurrently)
+      static double localRMS(const Waveform& waveform)
+      {
+        thread_local TruncatedRMS truncatedRMS;
+        return truncatedRMS(waveform);
+      }
     };
 }
 #endif
@@ -195,25 +195,8 @@ namespace sbnd_tool
 
   double ROIFinderStandardSBND::calculateLocalRMS(const Waveform& waveform) const
   {
-    // do rms calculation - the old fashioned way and over all adc values                                                                                            
-    std::vector<float> locWaveform = waveform;
-
-    // sort in ascending order so we can truncate the sume                                                                                                           
-    std::sort(locWaveform.begin(), locWaveform.end(),[](const auto& left, const auto& right){return std::fabs(left) < std::fabs(right);});
-
-    // Get the mean of the waveform we're checking...                                                                                                                
-    float sumWaveform  = std::accumulate(locWaveform.begin(),locWaveform.begin() + locWaveform.size()/2, 0.);
-    float meanWaveform = sumWaveform / float(locWaveform.size()/2);
-
-    std::vector<float> locWaveformDiff(locWaveform.size()/2);
-    std::transform(locWaveform.begin(),locWaveform.begin() + locWaveform.size()/2,locWaveformDiff.begin(), std::bind(std::minus<float>(),std::placeholders::_1,meanWaveform));
-
-    double localRMS = std::inner_product(locWaveformDiff.begin(), locWaveformDiff.end(), locWaveformDiff.begin(), 0.);
-
-    localRMS = std::sqrt(std::max(float(0.),float(localRMS) / float(locWaveformDiff.size())));
-    
-    return(localRMS);
-
+    // rms over the half of the adc values closest to zero, found by selection
+    return localRMS(waveform);
   }
 
   void ROIFinderStandardSBND::initializeHistograms(art::TFileDirectory& histDir) const
@@ -0,0 +1,59 @@
+///////////////////////////////////////////////////////////////////////
+///
+/// \file   TruncatedRMS.h
+///
+/// \brief  Noise RMS of a waveform from its samples of smallest magnitude,
+///         for use by the ROI finding tools
+///
+/// The RMS is computed around the mean of the half of the samples with
+/// the smallest absolute value, so that signal pulses do not contribute.
+/// That half is found by selection (std::nth_element, linear on average)
+/// rather than by sorting the waveform, in a scratch buffer which is kept
+/// from call to call: one object per thread, reused for all channels.
+///
+////////////////////////////////////////////////////////////////////////
+#ifndef TruncatedRMS_H
+#define TruncatedRMS_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace sbnd_tool
+{
+    class TruncatedRMS
+    {
+    public:
+      /// RMS of the lower half (by magnitude) of the samples; 0 if fewer than 2
+      double operator()(const std::vector<float>& waveform);
+
+    private:
+      std::vector<float> fScratch;
+    };
+}
+
+//----------------------------------------------------------------------
+inline double sbnd_tool::TruncatedRMS::operator()(const std::vector<float>& waveform)
+{
+    const size_t nHalf = waveform.size() / 2;
+    if (nHalf == 0) return 0.;
+
+    fScratch.assign(waveform.begin(), waveform.end());
+    std::nth_element(fScratch.begin(), fScratch.begin() + nHalf, fScratch.end(),
+                     [](float left, float right){return std::fabs(left) < std::fabs(right);});
+
+    double sumWaveform = 0.;
+    for(size_t idx = 0; idx < nHalf; idx++) sumWaveform += fScratch[idx];
+    const float meanWaveform = float(sumWaveform) / float(nHalf);
+
+    double sumSquares = 0.;
+    for(size_t idx = 0; idx < nHalf; idx++)
+    {
+        const float diff = fScratch[idx] - meanWaveform;
+        sumSquares += diff * diff;
+    }
+
+    return std::sqrt(std::max(float(0.), float(sumSquares) / float(nHalf)));
+}
+
+#endif
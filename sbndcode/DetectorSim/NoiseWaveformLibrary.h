@@ -0,0 +1,223 @@
+////////////////////////////////////////////////////////////////////////
+/// \file   NoiseWaveformLibrary.h
+///
+/// \brief  Pool of pre-generated TPC noise waveforms, reused across events.
+///
+/// Channels are grouped in classes of same view and similar wire length
+/// (the quantities the noise models depend on). At the beginning of the
+/// first run a fixed number of waveforms is generated for one representative
+/// channel of each class; each event then adds to every channel one of the
+/// waveforms of its class, picked at random, rotated by a random number of
+/// ticks and with a random sign. Power spectrum and amplitude distribution
+/// of each channel are preserved; correlations between channels (coherent
+/// noise) are not.
+///
+/// The waveforms are generated in sets of one per class, and the caller
+/// may regenerate the noise model between two sets. Noise services which
+/// draw from per-event arrays (e.g. the coherent noise of the uBooNE
+/// data-driven model, fixed for a channel group within one event) must be
+/// regenerated there: otherwise every waveform of a class carries the same
+/// array, which then shows up, shifted, on all the channels of the class.
+///
+/// The pool can be written to a ROOT file and read back by later jobs.
+/// The file records the FFT size, the number of waveforms per class and the
+/// wire length binning, and is only used if these match; it does not record
+/// the noise service configuration, so it must be removed when that changes.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef NOISEWAVEFORMLIBRARY_H
+#define NOISEWAVEFORMLIBRARY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cetlib_except/exception.h"
+#include "larcorealg/Geometry/GeometryCore.h"
+#include "larcoreobj/SimpleTypesAndConstants/geo_types.h"
+
+#include "CLHEP/Random/RandFlat.h"
+
+#include "TDirectory.h"
+#include "TFile.h"
+#include "TParameter.h"
+#include "TTree.h"
+
+namespace detsim {
+
+  class NoiseWaveformLibrary {
+  public:
+
+    /// Group the channels of geom by view and wire length, in bins of wireLengthBin cm
+    void SetChannelClasses(geo::GeometryCore const& geom, double wireLengthBin);
+
+    /// Same, with the wire length of each channel given by wireLength(channel) in cm
+    /// (e.g. including the jumpers, as seen by the noise model)
+    template <class WireLength>
+    void SetChannelClasses(geo::GeometryCore const& geom, double wireLengthBin, WireLength wireLength);
+
+    /// Generate nWaveforms waveforms of nTicks ticks per class, calling
+    /// gen(channel, waveform) with a zeroed waveform for the representative
+    /// channel; the waveforms are made one per class at a time, and
+    /// newSet() is called between two such sets
+    template <class Generator, class NewSet>
+    void Generate(unsigned int nWaveforms, std::size_t nTicks, Generator gen, NewSet newSet);
+
+    /// Read the pool from fname; false if the file is missing or does not
+    /// match the current classes, nWaveforms and nTicks
+    bool Load(std::string const& fname, unsigned int nWaveforms, std::size_t nTicks);
+
+    /// Write the pool to fname
+    void Save(std::string const& fname) const;
+
+    /// Add the noise of a random pool waveform of the class of chan to noise
+    void AddNoise(unsigned int chan, std::vector<float>& noise, CLHEP::HepRandomEngine& engine) const;
+
+    std::size_t NClasses() const { return fClassChannel.size(); }
+    unsigned int NWaveforms() const { return fNWaveforms; }
+
+  private:
+
+    double fWireLengthBin = 0.;
+    unsigned int fNWaveforms = 0;
+    std::size_t fNTicks = 0;
+    std::vector<unsigned int> fChannelClass;  ///< class of each channel
+    std::vector<unsigned int> fClassChannel;  ///< representative channel of each class
+    std::vector<float> fPool;                 ///< waveforms, by class, then waveform, then tick
+  };
+
+} // namespace detsim
+
+//----------------------------------------------------------------------
+inline void detsim::NoiseWaveformLibrary::SetChannelClasses(geo::GeometryCore const& geom,
+                                                            double wireLengthBin)
+{
+  SetChannelClasses(geom, wireLengthBin,
+    [&geom](unsigned int chan) { return geom.Wire(geom.ChannelToWire(chan).front()).Length(); });
+}
+
+//----------------------------------------------------------------------
+template <class WireLength>
+inline void detsim::NoiseWaveformLibrary::SetChannelClasses(geo::GeometryCore const& geom,
+                                                            double wireLengthBin, WireLength wireLength)
+{
+  if (wireLengthBin <= 0.)
+    throw cet::exception("NoiseWaveformLibrary") << "Invalid wire length bin " << wireLengthBin << "\n";
+  fWireLengthBin = wireLengthBin;
+
+  unsigned int const nChannels = geom.Nchannels();
+  fChannelClass.resize(nChannels);
+  fClassChannel.clear();
+
+  std::map<std::pair<int, int>, unsigned int> classes;
+  for (unsigned int chan = 0; chan < nChannels; ++chan) {
+    int const view = (int) geom.View(chan);
+    int const lengthBin = geom.ChannelToWire(chan).empty()? -1: (int) (wireLength(chan)/fWireLengthBin);
+
+    auto const inserted = classes.emplace(std::make_pair(view, lengthBin), fClassChannel.size());
+    if (inserted.second) fClassChannel.push_back(chan);
+    fChannelClass[chan] = inserted.first->second;
+  }
+}
+
+//----------------------------------------------------------------------
+template <class Generator, class NewSet>
+inline void detsim::NoiseWaveformLibrary::Generate(unsigned int nWaveforms, std::size_t nTicks,
+                                                   Generator gen, NewSet newSet)
+{
+  fNWaveforms = nWaveforms;
+  fNTicks = nTicks;
+  fPool.resize(NClasses()*fNWaveforms*fNTicks);
+
+  std::vector<float> waveform(fNTicks);
+  for (unsigned int k = 0; k < fNWaveforms; ++k) {
+    if (k > 0) newSet();
+    for (std::size_t cls = 0; cls < NClasses(); ++cls) {
+      std::fill(waveform.begin(), waveform.end(), 0.);
+      gen(fClassChannel[cls], waveform);
+      std::copy(waveform.begin(), waveform.end(), fPool.begin() + (cls*fNWaveforms + k)*fNTicks);
+    }
+  }
+}
+
+//----------------------------------------------------------------------
+inline bool detsim::NoiseWaveformLibrary::Load(std::string const& fname, unsigned int nWaveforms,
+                                               std::size_t nTicks)
+{
+  TDirectory::TContext const context; // restores gDirectory when done
+  std::unique_ptr<TFile> in(TFile::Open(fname.c_str(), "READ"));
+  if (!in || in->IsZombie()) return false;
+
+  auto const* pBin = dynamic_cast<TParameter<double>*>(in->Get("WireLengthBin"));
+  auto const* pClasses = dynamic_cast<TParameter<int>*>(in->Get("NClasses"));
+  auto const* pWaveforms = dynamic_cast<TParameter<int>*>(in->Get("NWaveforms"));
+  auto const* pTicks = dynamic_cast<TParameter<int>*>(in->Get("NTicks"));
+  auto* tree = dynamic_cast<TTree*>(in->Get("NoiseLibrary"));
+  if (!pBin || !pClasses || !pWaveforms || !pTicks || !tree) return false;
+  if (pBin->GetVal() != fWireLengthBin || (std::size_t) pClasses->GetVal() != NClasses()
+      || (unsigned int) pWaveforms->GetVal() != nWaveforms || (std::size_t) pTicks->GetVal() != nTicks)
+    return false;
+  if ((std::size_t) tree->GetEntries() != NClasses()*nWaveforms) return false;
+
+  fNWaveforms = nWaveforms;
+  fNTicks = nTicks;
+  fPool.resize(NClasses()*fNWaveforms*fNTicks);
+
+  bool good = true;
+  std::vector<float>* waveform = nullptr;
+  tree->SetBranchAddress("waveform", &waveform);
+  for (Long64_t entry = 0; good && entry < tree->GetEntries(); ++entry) {
+    tree->GetEntry(entry);
+    good = waveform && waveform->size() == fNTicks;
+    if (good) std::copy(waveform->begin(), waveform->end(), fPool.begin() + entry*fNTicks);
+  }
+  tree->ResetBranchAddresses();
+  delete waveform;
+  return good;
+}
+
+//----------------------------------------------------------------------
+inline void detsim::NoiseWaveformLibrary::Save(std::string const& fname) const
+{
+  TDirectory::TContext const context; // restores gDirectory when done
+  std::unique_ptr<TFile> out(TFile::Open(fname.c_str(), "RECREATE"));
+  if (!out || out->IsZombie())
+    throw cet::exception("NoiseWaveformLibrary") << "Can't write noise library file '" << fname << "'\n";
+
+  TParameter<double>("WireLengthBin", fWireLengthBin).Write();
+  TParameter<int>("NClasses", NClasses()).Write();
+  TParameter<int>("NWaveforms", fNWaveforms).Write();
+  TParameter<int>("NTicks", fNTicks).Write();
+
+  TTree tree("NoiseLibrary", "pre-generated noise waveforms, by class");
+  std::vector<float> waveform(fNTicks);
+  std::vector<float>* pWaveform = &waveform;
+  tree.Branch("waveform", &pWaveform);
+  for (std::size_t first = 0; first < fPool.size(); first += fNTicks) {
+    std::copy(fPool.begin() + first, fPool.begin() + first + fNTicks, waveform.begin());
+    tree.Fill();
+  }
+  tree.Write();
+  out->Close();
+}
+
+//----------------------------------------------------------------------
+inline void detsim::NoiseWaveformLibrary::AddNoise(unsigned int chan, std::vector<float>& noise,
+                                                   CLHEP::HepRandomEngine& engine) const
+{
+  std::size_t const k = CLHEP::RandFlat::shootInt(&engine, fNWaveforms);
+  std::size_t const offset = CLHEP::RandFlat::shootInt(&engine, fNTicks);
+  float const sign = (CLHEP::RandFlat::shoot(&engine) < 0.5)? -1.: 1.;
+
+  float const* waveform = fPool.data() + (fChannelClass.at(chan)*fNWaveforms + k)*fNTicks;
+  std::size_t const n = std::min(noise.size(), fNTicks);
+  std::size_t const nFirst = std::min(n, fNTicks - offset);
+  for (std::size_t i = 0; i < nFirst; ++i) noise[i] += sign*waveform[offset + i];
+  for (std::size_t i = nFirst; i < n; ++i) noise[i] += sign*waveform[offset + i - fNTicks];
+}
+
+#endif // NOISEWAVEFORMLIBRARY_H
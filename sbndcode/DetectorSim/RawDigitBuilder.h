@@ -0,0 +1,63 @@
+////////////////////////////////////////////////////////////////////////
+/// \file   RawDigitBuilder.h
+///
+/// \brief  Compress ADC waveforms and hand them to raw::RawDigit without copies.
+///
+/// The builder owns the ADC buffer the digitization writes into. Make()
+/// compresses it and moves it into the new raw::RawDigit, so the only heap
+/// allocation per channel is the digit payload itself: the buffer for the
+/// next channel is allocated (at its final size) when ADCs() is called.
+/// raw::Compress with a compression other than raw::kNone still uses
+/// temporary storage internally.
+///
+/// One builder per thread; it is not safe to share.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef RAWDIGITBUILDER_H
+#define RAWDIGITBUILDER_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "lardataobj/RawData/RawDigit.h"
+#include "lardataobj/RawData/raw.h"
+
+namespace detsim {
+
+  class RawDigitBuilder {
+  public:
+
+    RawDigitBuilder(std::size_t nSamples, raw::Compress_t compression)
+      : fNSamples(nSamples), fCompression(compression) {}
+
+    /// Uncompressed ADC buffer of the next digit, NSamples() long
+    std::vector<short>& ADCs()
+      {
+        if (fADCs.size() != fNSamples) fADCs.resize(fNSamples);
+        return fADCs;
+      }
+
+    /// Compress the buffer and move it into a digit for channel chan
+    raw::RawDigit Make(raw::ChannelID_t chan, float pedestal)
+      {
+        raw::Compress(fADCs, fCompression);
+        raw::RawDigit digit(chan, fNSamples, std::move(fADCs), fCompression);
+        digit.SetPedestal(pedestal);
+        fADCs.clear();
+        return digit;
+      }
+
+    std::size_t NSamples() const { return fNSamples; }
+    raw::Compress_t Compression() const { return fCompression; }
+
+  private:
+
+    std::size_t fNSamples;
+    raw::Compress_t fCompression;
+    std::vector<short> fADCs;
+  };
+
+} // namespace detsim
+
+#endif // RAWDIGITBUILDER_H
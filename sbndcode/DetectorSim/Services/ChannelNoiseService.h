@@ -13,7 +13,9 @@
 #include "sbndcode/DetectorSim/Services/AdcTypes.h"
 #include "art/Framework/Core/EDProducer.h"
 #include "fhiclcpp/ParameterSet.h"
+#include "cetlib_except/exception.h"
 namespace detinfo { class DetectorClocksData; }
+namespace CLHEP { class HepRandomEngine; }
 
 class ChannelNoiseService {
 
@@ -27,10 +29,28 @@ public:
   // Noise is added for all entries in the input vector.
   virtual int addNoise(detinfo::DetectorClocksData const&, Channel chan, AdcSignalVector& sigs) const =0;
 
+  // Add noise to sigs for channel chan, drawing every random number from
+  // engine and touching no other mutable state. Services which support this
+  // return true from canAddNoiseConcurrently(), and the caller may then run
+  // it for several channels at the same time, each with its own engine.
+  virtual bool canAddNoiseConcurrently() const { return false; }
+
+  virtual int addNoise(detinfo::DetectorClocksData const&, Channel chan, AdcSignalVector&,
+                       CLHEP::HepRandomEngine&) const {
+    throw cet::exception("ChannelNoiseService")
+      << "This noise service cannot add noise to channel " << chan
+      << " from an external random engine.\n";
+  }
+
   virtual void generateNoise(detinfo::DetectorClocksData const&){
     return;
   }
 
+  // Wire length in cm the noise of channel chan depends on, if the service
+  // uses one different from the geometry wire length (e.g. including the
+  // jumpers); negative otherwise. Valid after generateNoise() has been called.
+  virtual double noiseWireLength(Channel) const { return -1.; }
+
   // Print parameters.
   virtual std::ostream& print(std::ostream& out =std::cout, std::string prefix ="") const =0;
   
@@ -38,6 +38,11 @@ public:
   // Add noise to a signal array.
   int addNoise(detinfo::DetectorClocksData const& clockData, Channel chan, AdcSignalVector& sigs) const;
 
+  // Nothing to draw, so any number of channels can be handled at once.
+  bool canAddNoiseConcurrently() const override { return true; }
+  int addNoise(detinfo::DetectorClocksData const& clockData, Channel chan, AdcSignalVector& sigs,
+               CLHEP::HepRandomEngine& engine) const override;
+
   // Print the configuration.
   std::ostream& print(std::ostream& out =std::cout, std::string prefix ="") const;
 
@@ -37,6 +37,13 @@ int SBNDNoNoiseService::addNoise(detinfo::DetectorClocksData const&, Channel cha
 
 //**********************************************************************
 
+int SBNDNoNoiseService::addNoise(detinfo::DetectorClocksData const&, Channel chan, AdcSignalVector& sigs,
+                                 CLHEP::HepRandomEngine&) const {
+  return 0;
+}
+
+//**********************************************************************
+
 ostream& SBNDNoNoiseService::print(ostream& out, string prefix) const {
   out << prefix << "SBNDNoNoiseService: " << endl;
   
@@ -74,15 +74,14 @@ int SBNDThermalNoiseServiceInFreq::addNoise(detinfo::DetectorClocksData const&,
                                             Channel chan, AdcSignalVector& sigs) const {
 
   //Get services.
-  art::ServiceHandle<geo::Geometry> geo;
-  art::ServiceHandle<util::SignalShapingServiceSBND> sss;
+  art::ServiceHandle<util::SignalShapingServiceSBND const> sss;
   art::ServiceHandle<util::LArFFT> fFFT;
   
   //Generate Noise:
-  size_t view = (size_t)geo->View(chan);
+  size_t view = (size_t)sss->View(chan);
   
   double noise_factor;
-  auto tempNoiseVec = sss->GetNoiseFactVec();
+  auto const& tempNoiseVec = sss->GetNoiseFactVec();
   double shapingTime = 2.0; //sss->GetShapingTime(chan);
   double asicGain = sss->GetASICGain(chan);
 
@@ -59,10 +59,19 @@ public:
   int addNoise(detinfo::DetectorClocksData const& clockData,
                Channel chan, AdcSignalVector& sigs) const override;
 
+  // Add noise to a signal array, with random numbers from engine.
+  bool canAddNoiseConcurrently() const override { return true; }
+  int addNoise(detinfo::DetectorClocksData const& clockData,
+               Channel chan, AdcSignalVector& sigs,
+               CLHEP::HepRandomEngine& engine) const override;
+
   // Print the configuration.
   std::ostream& print(std::ostream& out =std::cout, std::string prefix ="") const override;
 
 private:
+
+  // Fill sigs with Gaussian noise of the RMS appropriate for chan.
+  void fillNoise(Channel chan, AdcSignalVector& sigs, CLHEP::HepRandomEngine& engine) const;
   
   // General parameters
   unsigned int fNoiseArrayPoints;  ///< number of points in randomly generated noise array
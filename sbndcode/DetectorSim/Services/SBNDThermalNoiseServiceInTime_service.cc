@@ -66,16 +66,32 @@ SBNDThermalNoiseServiceInTime::~SBNDThermalNoiseServiceInTime() {
 
 int SBNDThermalNoiseServiceInTime::addNoise(detinfo::DetectorClocksData const&,
                                             Channel chan, AdcSignalVector& sigs) const {
+  fillNoise(chan, sigs, *fNoiseEngine);
+  return 0;
+}
+
+//**********************************************************************
+
+int SBNDThermalNoiseServiceInTime::addNoise(detinfo::DetectorClocksData const&,
+                                            Channel chan, AdcSignalVector& sigs,
+                                            CLHEP::HepRandomEngine& engine) const {
+  fillNoise(chan, sigs, engine);
+  return 0;
+}
+
+//**********************************************************************
+
+void SBNDThermalNoiseServiceInTime::fillNoise(Channel chan, AdcSignalVector& sigs,
+                                              CLHEP::HepRandomEngine& engine) const {
 
   //Get services.
-  art::ServiceHandle<geo::Geometry> geo;
-  art::ServiceHandle<util::SignalShapingServiceSBND> sss;
+  art::ServiceHandle<util::SignalShapingServiceSBND const> sss;
   
   //Generate Noise:
-  size_t view = (size_t)geo->View(chan);
+  size_t view = (size_t)sss->View(chan);
   
   double noise_factor;
-  auto tempNoiseVec = sss->GetNoiseFactVec();
+  auto const& tempNoiseVec = sss->GetNoiseFactVec();
   double shapingTime = 2.0; //sss->GetShapingTime(chan);
   double asicGain = sss->GetASICGain(chan);
   
@@ -93,7 +109,7 @@ int SBNDThermalNoiseServiceInTime::addNoise(detinfo::DetectorClocksData const&,
       << std::endl;
   }
 
-  CLHEP::RandGaussQ rGauss(*fNoiseEngine, 0.0, noise_factor);
+  CLHEP::RandGaussQ rGauss(engine, 0.0, noise_factor);
     
 
   //In this case fNoiseFact is a value in ADC counts
@@ -104,8 +120,6 @@ int SBNDThermalNoiseServiceInTime::addNoise(detinfo::DetectorClocksData const&,
   for (unsigned int i = 0; i < sigs.size(); i++){
     sigs.at(i) = rGauss.fire();
   }
-
-  return 0;
 }
 
 
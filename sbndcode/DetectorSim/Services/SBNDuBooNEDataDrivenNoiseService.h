@@ -21,6 +21,7 @@
 #define SBNDuBooNEDataDrivenNoiseService_H
 
 #include "sbndcode/DetectorSim/Services/ChannelNoiseService.h"
+#include "sbndcode/Utilities/FFTWorkspaceSBND.h"
 
 #include "art_root_io/TFileService.h"
 #include "lardata/DetectorInfoServices/DetectorPropertiesService.h"
@@ -32,11 +33,14 @@
 #include "CLHEP/Random/RandFlat.h"
 #include "CLHEP/Random/RandGaussQ.h"
 
+#include "TComplex.h"
 #include "TH1F.h"
-#include "TRandom3.h"
-#include "TF1.h"
 #include "TMath.h"
 
+#include "tbb/enumerable_thread_specific.h"
+
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <iostream>
 #include <sstream>
@@ -62,7 +66,18 @@ public:
   // Add noise to a signal array.
   int addNoise(detinfo::DetectorClocksData const& clockData, Channel chan, AdcSignalVector& sigs) const override;
 
+  // Same, drawing the random numbers from engine; safe to call concurrently
+  // once generateNoise() has been called for the event.
+  bool canAddNoiseConcurrently() const override { return true; }
+  int addNoise(detinfo::DetectorClocksData const& clockData, Channel chan, AdcSignalVector& sigs,
+               CLHEP::HepRandomEngine& engine) const override;
+
   void generateNoise(detinfo::DetectorClocksData const& clockData) override;
+
+  // Wire length including the jumpers, as used by the noise model.
+  double noiseWireLength(Channel chan) const override {
+    return chan < fChannelWireLength.size()? fChannelWireLength[chan]: -1.;
+  }
  
   // Print the configuration.
   std::ostream& print(std::ostream& out =std::cout, std::string prefix ="") const override;
@@ -72,20 +87,51 @@ private:
   // Fill the noise vectors.
   //void generateNoise();
   
-  // Fill a noise vector.
+  // Add the noise of channel chan to sigs, drawing from engine.
+  int addNoiseFromEngine(Channel chan, AdcSignalVector& sigs, CLHEP::HepRandomEngine& engine) const;
+
+  // Fill a noise vector from one of the precomputed spectra,
+  // randomizing the amplitude within 10% and the phase.
   // Input vector contents are lost.
-  // The size of the vector is obtained from the FFT service.
-  void generateMicroBooNoise(float wirelength, float ENOB, 
-                     AdcSignalVector& noise, TH1* aNoiseHist) const;
-  void generateGaussianNoise(detinfo::DetectorClocksData const& clockData,
-                             AdcSignalVector& noise, std::vector<float> gausNorm,
-	                    std::vector<float> gausMean, std::vector<float> gausSigma,
-	                    TH1* aNoiseHist) const;
-  void generateCoherentNoise(detinfo::DetectorClocksData const& clockData,
-                             AdcSignalVector& noise, std::vector<float> gausNorm,
-	                    std::vector<float> gausMean, std::vector<float> gausSigma,
-	                    float cohExpNorm, float cohExpWidth, float cohExpOffset, 
-	                    TH1* aNoiseHist) const;
+  // The size of the vector is the FFT size.
+  void generateNoiseFromSpectrum(AdcSignalVector& noise, std::vector<double> const& spectrum,
+                                 TH1* aNoiseHist) const;
+
+  // Noise model cache.
+  // The spectral amplitudes only depend on the configuration, the FFT size
+  // and the sampling rate, so they are tabulated once per job (and again
+  // only if the FFT size or the sampling rate change). The MicroBooNE model
+  // amplitude of channel c in bin i is
+  //   fMicroBooBase[i] + WireLengthTerm(fChannelWireLength[c])*fMicroBooWireDep[i]
+  void buildNoiseModelCache(detinfo::DetectorClocksData const& clockData);
+  double WireLengthTerm(double wirelength) const { return wldparams[0] + wldparams[1]*wirelength; }
+  // Amplitude randomizer of the MicroBooNE model (a Poisson distribution
+  // continued to real values, divided by its mean) at cumulative probability u.
+  double PoissonRandomizer(double u) const;
+
+  unsigned int fCacheNTicks = 0;           ///< FFT size the cache was built for
+  double fCacheSampleRate = 0.;            ///< sampling rate the cache was built for
+  std::vector<double> fMicroBooBase;       ///< wire length independent MicroBooNE amplitude, per frequency bin
+  std::vector<double> fMicroBooWireDep;    ///< MicroBooNE amplitude per unit of wire length term, per frequency bin
+  std::vector<double> fGausSpectrumU;      ///< inherent Gaussian noise amplitude for U, per frequency bin
+  std::vector<double> fGausSpectrumV;      ///< inherent Gaussian noise amplitude for V, per frequency bin
+  std::vector<double> fGausSpectrumZ;      ///< inherent Gaussian noise amplitude for Z, per frequency bin
+  std::vector<double> fCohSpectrum;        ///< coherent noise amplitude, per frequency bin
+  std::vector<double> fChannelWireLength;  ///< wire length (with jumper) of each channel in cm
+  std::vector<geo::View_t> fChannelView;   ///< view of each channel
+  std::vector<double> fPoissonCDF;         ///< cumulative of the randomizer on a uniform grid
+
+  // Per-thread FFT plans and scratch space of the MicroBooNE model.
+  struct NoiseWorkspace {
+    explicit NoiseWorkspace(unsigned int ntick)
+      : fft(ntick), noiseFrequency(ntick/2 + 1), rnd(2*(ntick/2 + 1)), noisevector(ntick) {}
+    util::FFTWorkspaceSBND fft;
+    std::vector<TComplex> noiseFrequency; ///< spectrum, per frequency bin
+    std::vector<double> rnd;              ///< two flat random numbers per frequency bin
+    std::vector<double> noisevector;      ///< waveform, per tick
+  };
+  std::unique_ptr<tbb::enumerable_thread_specific<NoiseWorkspace>> fWorkspaces;
+  mutable std::mutex fHistMutex;           ///< guards the histogram fills of concurrent calls
   
   // Make coherent groups
   void makeCoherentGroupsByOfflineChannel(unsigned int nchpergroup);
@@ -172,18 +218,13 @@ private:
   TH1* fCohNoiseHist;      ///< distribution of noise counts
   TH1* fCohNoiseChanHist;  ///< distribution of accessed noise samples
 
-  TF1* _wld_f;
-  double wldparams[2];
-
-  TF1* _poisson;
+  double wldparams[2];   ///< wire length dependance of the MicroBooNE model
 
 
   // Randomisation.
   bool haveSeed;
   CLHEP::HepRandomEngine* m_pran;
   CLHEP::HepRandomEngine* ConstructRandomEngine(const bool haveSeed);
-  double GetRandomTF1(TF1* func) const;
-  TRandom3* fTRandom3;
 
 
 };
@@ -6,6 +6,9 @@
 #include "sbndcode/DetectorSim/Services/SBNDuBooNEDataDrivenNoiseService.h"
 #include "lardata/DetectorInfoServices/DetectorClocksService.h"
 
+#include <algorithm>
+#include <cmath>
+
 using std::cout;
 using std::ostream;
 using std::endl;
@@ -16,6 +19,8 @@ using CLHEP::HepJamesRandom;
 
 namespace{
   constexpr double kPoissonMean = 3.30762;
+  constexpr double kPoissonMax = 30.;            ///< range [0, kPoissonMax] of the randomizer
+  constexpr unsigned int kPoissonCDFPoints = 3000;
 }
 
 //**********************************************************************
@@ -29,8 +34,7 @@ SBNDuBooNEDataDrivenNoiseService(fhicl::ParameterSet const& pset)
   fMicroBooNoiseChanHist(nullptr),
   fCohNoiseHist(nullptr), fCohNoiseChanHist(nullptr),
   haveSeed(pset.get_if_present<int>("RandomSeed", fRandomSeed)),
-  m_pran(ConstructRandomEngine(haveSeed)),
-  fTRandom3(new TRandom3(m_pran->getSeed()))
+  m_pran(ConstructRandomEngine(haveSeed))
 {
 
   fNoiseArrayPoints  = pset.get<unsigned int>("NoiseArrayPoints");
@@ -86,13 +90,19 @@ SBNDuBooNEDataDrivenNoiseService(fhicl::ParameterSet const& pset)
   //generateNoise(); //This has been replaced by the same function in SimWireSBND. This is so the noise arrays are recalculated for each event.
 
   // Wirelength dependance function
-  _wld_f = new TF1("_wld_f", "[0] + [1]*x", 0.0, 1000);
   wldparams[0] = 0.395;
   wldparams[1] = 0.001304;
-  _wld_f->SetParameters(wldparams);
 
-  _poisson = new TF1("_poisson", "[0]**(x) * exp(-[0]) / ROOT::Math::tgamma(x+1.)", 0, 30);
-  _poisson->SetParameter(0, kPoissonMean); 
+  // Cumulative of the custom poisson [0]**(x) * exp(-[0]) / tgamma(x+1.)
+  // on [0, kPoissonMax], for inverse transform sampling of the randomizer.
+  fPoissonCDF.resize(kPoissonCDFPoints + 1);
+  double const step = kPoissonMax/kPoissonCDFPoints;
+  auto poisson = [](double x){ return std::exp(x*std::log(kPoissonMean) - kPoissonMean - std::lgamma(x + 1.)); };
+  fPoissonCDF[0] = 0.;
+  for ( unsigned int i=1; i<=kPoissonCDFPoints; ++i ) {
+    fPoissonCDF[i] = fPoissonCDF[i-1] + 0.5*step*(poisson((i-1)*step) + poisson(i*step));
+  }
+  for ( double& cdf : fPoissonCDF ) cdf /= fPoissonCDF.back();
 
   if ( fLogLevel > 1 ) print() << endl;
 
@@ -135,27 +145,130 @@ CLHEP::HepRandomEngine* SBNDuBooNEDataDrivenNoiseService::ConstructRandomEngine(
   return m_pran;
 }
 
-double SBNDuBooNEDataDrivenNoiseService::GetRandomTF1(TF1* func) const{
-  TRandom* gRandomTemp = gRandom;
-  gRandom = fTRandom3;
-  double randomVal(func->GetRandom());
-  gRandom = gRandomTemp;
-  return randomVal;
+double SBNDuBooNEDataDrivenNoiseService::PoissonRandomizer(double u) const {
+  // linear interpolation of the inverse cumulative
+  auto const it = std::upper_bound(fPoissonCDF.begin() + 1, fPoissonCDF.end() - 1, u);
+  unsigned int const i = it - fPoissonCDF.begin();
+  double const lo = fPoissonCDF[i-1];
+  double const hi = fPoissonCDF[i];
+  double const frac = (hi > lo)? (u - lo)/(hi - lo): 0.;
+  double const x = (i - 1 + frac)*kPoissonMax/kPoissonCDFPoints;
+  return x/kPoissonMean;
 }
   
 //**********************************************************************
 
-int SBNDuBooNEDataDrivenNoiseService::addNoise(detinfo::DetectorClocksData const& clockData, Channel chan, AdcSignalVector& sigs) const {
-  CLHEP::RandFlat flat(*m_pran);
-  CLHEP::RandGaussQ gaus(*m_pran);
+void SBNDuBooNEDataDrivenNoiseService::buildNoiseModelCache(detinfo::DetectorClocksData const& clockData) {
+  // Fetch sampling rate.
+  float sampleRate = sampling_rate(clockData);
+  // Fetch FFT service and # ticks.
+  art::ServiceHandle<util::LArFFT> pfft;
+  unsigned int ntick = pfft->FFTSize(); //waveform_size
+  if ( ntick == fCacheNTicks && sampleRate == fCacheSampleRate ) return;
+
+  const string myname = "SBNDuBooNEDataDrivenNoiseService::buildNoiseModelCache: ";
+  if ( fLogLevel > 0 ) {
+    cout << myname << "Tabulating noise spectra for " << ntick << " ticks." << endl;
+  }
+  fCacheNTicks = ntick;
+  fCacheSampleRate = sampleRate;
+
+  // width of frequencyBin in kHz
+  double binWidth = 1.0/(ntick*sampleRate*1.0e-6);
+  unsigned nbin = ntick/2 + 1;
+
+  ////////////////////////////// MicroBooNE noise model/////////////////////////////////
+  // gain function in kHz, split in the wire length independent terms and the
+  // term multiplied by the wire length parameter ([6]):
+  // ([0]*1/(x/1000*[8]/2) + ([1]*exp(-0.5*(((x/1000*[8]/2)-[2])/[3])**2)*exp(-0.5*pow(x/1000*[8]/(2*[4]),[5])))*[6]) + [7]
+  // [8] is the uBooNE nticks (9596). Using SBND (or ProtoDUNE) nticks changes
+  // the model significantly, so we stick with the uBooNE nticks.
+  double const uBooNTicks = 9596;
+  fMicroBooBase.resize(nbin);
+  fMicroBooWireDep.resize(nbin);
+  for ( unsigned int i=0; i<nbin; ++i ) {
+    double const x = (i+0.5)*binWidth/1000*uBooNTicks/2;
+    double const g = (x - fNoiseFunctionParameters.at(2))/fNoiseFunctionParameters.at(3);
+    fMicroBooBase[i] = fNoiseFunctionParameters.at(0)/x + fNoiseFunctionParameters.at(7);
+    fMicroBooWireDep[i] = fNoiseFunctionParameters.at(1)*std::exp(-0.5*g*g)
+      *std::exp(-0.5*std::pow(x/fNoiseFunctionParameters.at(4), fNoiseFunctionParameters.at(5)));
+  }
+
+  //--- inherent and coherent Gaussian noise: sum of gaussians (plus exponential) ---
+  auto gausSpectrum = [&](std::vector<double>& spectrum, std::vector<float> const& gausNorm,
+                          std::vector<float> const& gausMean, std::vector<float> const& gausSigma){
+    unsigned int NGausians = std::min({ gausNorm.size(), gausMean.size(), gausSigma.size() });
+    spectrum.assign(nbin, 0.);
+    for ( unsigned int i=0; i<nbin; ++i ) {
+      double const x = (double)i*binWidth;
+      for ( unsigned int g=0; g<NGausians; ++g ) {
+        spectrum[i] += gausNorm[g]*std::exp(-0.5*std::pow((x - gausMean[g])/gausSigma[g], 2));
+      }
+    }
+  };
+  if ( fEnableGaussianNoise ) {
+    gausSpectrum(fGausSpectrumU, fGausNormU, fGausMeanU, fGausSigmaU);
+    gausSpectrum(fGausSpectrumV, fGausNormV, fGausMeanV, fGausSigmaV);
+    gausSpectrum(fGausSpectrumZ, fGausNormZ, fGausMeanZ, fGausSigmaZ);
+  }
+  if ( fEnableCoherentNoise ) {
+    gausSpectrum(fCohSpectrum, fCohGausNorm, fCohGausMean, fCohGausSigma);
+    for ( unsigned int i=0; i<nbin; ++i ) {
+      fCohSpectrum[i] += fCohExpNorm*std::exp(-(double)i*binWidth/fCohExpWidth) + fCohExpOffset;
+    }
+  }
+
+  //--- per-channel wire length and view ---
+  art::ServiceHandle<geo::Geometry> geo;
+  unsigned int const nchan = geo->Nchannels();
+  fChannelWireLength.resize(nchan);
+  fChannelView.resize(nchan);
+  for ( unsigned int chan=0; chan<nchan; ++chan ) {
+    std::vector<geo::WireID> wireIDs = geo->ChannelToWire(chan);
+    unsigned int wireID = wireIDs.front().Wire;
+    unsigned int planeID = wireIDs.front().Plane;
+
+    double wirelength = geo->Wire(wireIDs.front()).Length(); //wirelength in cm.
+    if(fIncludeJumpers){
+      if( (planeID==0 && wireID >= fUFirstJumper && wireID <= fULastJumper) || (planeID==1 && wireID >= fVFirstJumper && wireID <= fVLastJumper) ){ //Add jumper term only for appropriate wires on U and V planes.
+        double jumperLength = (fJumperCapacitance/16.75)*100; //Using wire value of 16.75 pF/m to convert jumper capacitance to equivalent wire length. x100 to convert to cm.
+        wirelength = wirelength + jumperLength;
+      }
+    }
+    fChannelWireLength[chan] = wirelength;
+    fChannelView[chan] = geo->View(chan);
+  }
+
+  fWorkspaces = std::make_unique<tbb::enumerable_thread_specific<NoiseWorkspace>>(ntick);
+}
+
+//**********************************************************************
+
+int SBNDuBooNEDataDrivenNoiseService::addNoise(detinfo::DetectorClocksData const&, Channel chan, AdcSignalVector& sigs) const {
+  return addNoiseFromEngine(chan, sigs, *m_pran);
+}
+
+int SBNDuBooNEDataDrivenNoiseService::addNoise(detinfo::DetectorClocksData const&, Channel chan, AdcSignalVector& sigs,
+                                               CLHEP::HepRandomEngine& engine) const {
+  return addNoiseFromEngine(chan, sigs, engine);
+}
+
+//**********************************************************************
+
+int SBNDuBooNEDataDrivenNoiseService::addNoiseFromEngine(Channel chan, AdcSignalVector& sigs,
+                                                         CLHEP::HepRandomEngine& engine) const {
+  if ( chan >= fChannelWireLength.size() ) {
+    throw cet::exception("SBNDuBooNEDataDrivenNoiseService")
+      << "No noise model for channel " << chan << ": generateNoise() must be called first.\n";
+  }
+  CLHEP::RandFlat flat(engine);
+  CLHEP::RandGaussQ gaus(engine);
 
   unsigned int microbooNoiseChan = flat.fire()*fNoiseArrayPoints;
   if ( microbooNoiseChan == fNoiseArrayPoints ) --microbooNoiseChan;
-  fMicroBooNoiseChanHist->Fill(microbooNoiseChan);
   
   unsigned int gausNoiseChan = flat.fire()*fNoiseArrayPoints;
   if ( gausNoiseChan == fNoiseArrayPoints ) --gausNoiseChan;
-  fGausNoiseChanHist->Fill(gausNoiseChan);
   
   unsigned int cohNoisechan = -999;
   unsigned int groupNum = -999;
@@ -163,118 +276,59 @@ int SBNDuBooNEDataDrivenNoiseService::addNoise(detinfo::DetectorClocksData const
     groupNum = getGroupNumberFromOfflineChannel(chan);
     cohNoisechan = getCohNoiseChanFromGroup(groupNum);
     if ( cohNoisechan == fCohNoiseArrayPoints ) cohNoisechan = fCohNoiseArrayPoints-1;
-    fCohNoiseChanHist->Fill(cohNoisechan);
   }
 
-  art::ServiceHandle<geo::Geometry> geo;
-  std::vector<geo::WireID> wireIDs = geo->ChannelToWire(chan);
-  unsigned int wireID = wireIDs.front().Wire;
-  unsigned int planeID = wireIDs.front().Plane;
-
-  geo::WireGeo const& wire = geo->Wire(wireIDs.front());
-  double wirelength = wire.Length(); //wirelength in cm.
-
-  if(fIncludeJumpers){
-    if( (planeID==0 && wireID >= fUFirstJumper && wireID <= fULastJumper) || (planeID==1 && wireID >= fVFirstJumper && wireID <= fVLastJumper) ){ //Add jumper term only for appropriate wires on U and V planes.
-      double jumperLength = (fJumperCapacitance/16.75)*100; //Using wire value of 16.75 pF/m to convert jumper capacitance to equivalent wire length. x100 to convert to cm.
-      wirelength = wirelength + jumperLength;
-    }
+  {
+    std::lock_guard<std::mutex> lock(fHistMutex);
+    fMicroBooNoiseChanHist->Fill(microbooNoiseChan);
+    fGausNoiseChanHist->Fill(gausNoiseChan);
+    if ( fEnableCoherentNoise ) fCohNoiseChanHist->Fill(cohNoisechan);
   }
-  //include for 0 wirelength tests.
-  //wirelength = 0;
-
-
-  ///This part below has been moved from the generateMicroBooNoise section as it needs to be done differently for SBND due to different wirelengths.
 
   ////////////////////////////// MicroBooNE noise model/////////////////////////////////
-  // vars
-
-  // Fetch sampling rate.
-  float sampleRate = sampling_rate(clockData);
-  // Fetch FFT service and # ticks.
-  art::ServiceHandle<util::LArFFT> pfft;
-  unsigned int ntick = pfft->FFTSize(); //waveform_size
-  // width of frequencyBin in kHz
-  double binWidth = 1.0/(ntick*sampleRate*1.0e-6);
-
-  // Create noise spectrum in frequency.
+  // amplitudes from the cached spectrum of this wire length, randomized by
+  // the poisson randomizer, and random phases; two flat numbers per bin
+  unsigned int const ntick = fCacheNTicks;
   unsigned nbin = ntick/2 + 1;
-  std::vector<TComplex> noiseFrequency(nbin, 0.);
-  double pval = 0.;
-  double phase = 0.;
-  double rnd[3] = {0.};
-
-  std::vector<double> noisevector(ntick,0.0);
-  double fitpar[9] = {0.};
-  
-  // gain function in kHz
-  TF1* _pfn_f1 = new TF1("_pfn_f1", "([0]*1/(x/1000*[8]/2) + ([1]*exp(-0.5*(((x/1000*[8]/2)-[2])/[3])**2)*exp(-0.5*pow(x/1000*[8]/(2*[4]),[5])))*[6]) + [7]", 0.0, 0.5*ntick*binWidth);
-  // set data-driven parameters
- 
-  double wldValue = _wld_f->Eval(wirelength);
-
-  fitpar[0] = fNoiseFunctionParameters.at(0);
-  fitpar[1] = fNoiseFunctionParameters.at(1);
-  fitpar[2] = fNoiseFunctionParameters.at(2);
-  fitpar[3] = fNoiseFunctionParameters.at(3);
-  fitpar[4] = fNoiseFunctionParameters.at(4);
-  fitpar[5] = fNoiseFunctionParameters.at(5);
-  fitpar[6] = wldValue; //wire length parameter
-  fitpar[7] = fNoiseFunctionParameters.at(7); //baseline_noise
-  fitpar[8] = 9596; //uBooNE nticks. Using SBND (or ProtoDUNE) nticks changes the model significantly, so we stick with the uBooNE nticks. 
-
-  _pfn_f1->SetParameters(fitpar);
-  _pfn_f1->SetNpx(1000);
-
-  for ( unsigned int i=0; i<ntick/2+1; ++i ) {
-    //MicroBooNE noise model
-    double pfnf1val = _pfn_f1->Eval((i+0.5)*binWidth);
+  NoiseWorkspace& ws = fWorkspaces->local();
+  std::vector<TComplex>& noiseFrequency = ws.noiseFrequency;
+  std::vector<double>& rnd = ws.rnd;
+  std::vector<double>& noisevector = ws.noisevector;
+
+  double const wldValue = WireLengthTerm(fChannelWireLength[chan]);
+  double const norm = sqrt(ntick);
+  flat.fireArray(2*nbin, rnd.data(), 0, 1);
+  for ( unsigned int i=0; i<nbin; ++i ) {
+    double const pfnf1val = fMicroBooBase[i] + wldValue*fMicroBooWireDep[i];
     // define FFT parameters
-    double randPoisson = GetRandomTF1(_poisson);
-    double randomizer = randPoisson/kPoissonMean;
-    pval = pfnf1val * randomizer;
+    double pval = norm * pfnf1val * PoissonRandomizer(rnd[2*i]);
     // random phase angle
-    flat.fireArray(2, rnd, 0, 1);
-    phase = rnd[1]*2.*TMath::Pi();
-    TComplex tc(pval*cos(phase),pval*sin(phase));
-    noiseFrequency[i] += tc;
+    double phase = rnd[2*i+1]*2.*TMath::Pi();
+    noiseFrequency[i] = TComplex(pval*cos(phase),pval*sin(phase));
   }
 
-
   // Obtain time spectrum from frequency spectrum.
-  std::vector<double> tmpnoise(noisevector.size());
-  pfft->DoInvFFT(noiseFrequency, tmpnoise);
-  noiseFrequency.clear();
-  for ( unsigned int itck=0; itck<noisevector.size(); ++itck ) {
-    noisevector[itck] = sqrt(ntick)*tmpnoise[itck];
+  ws.fft.DoInvFFT(noiseFrequency, noisevector);
+
+  const geo::View_t view = fChannelView[chan];
+  float whiteNoise = 0;
+  AdcSignalVectorVector const* gausNoise = nullptr;
+  AdcSignalVectorVector const* cohNoise = nullptr;
+  if ( view==geo::kU ) {
+    whiteNoise = fWhiteNoiseU; gausNoise = &fGausNoiseU; cohNoise = &fCohNoiseU;
+  } 
+  else if ( view==geo::kV ) {
+    whiteNoise = fWhiteNoiseV; gausNoise = &fGausNoiseV; cohNoise = &fCohNoiseV;
+  } 
+  else {
+    whiteNoise = fWhiteNoiseZ; gausNoise = &fGausNoiseZ; cohNoise = &fCohNoiseZ;
   }
-  // end of moved section.
-
-  _pfn_f1->Delete();
-  
-
-
-  const geo::View_t view = geo->View(chan);
   for ( unsigned int itck=0; itck<sigs.size(); ++itck ) {
     double tnoise = 0;
-    if ( view==geo::kU ) {
-      if(fEnableWhiteNoise)    tnoise += fWhiteNoiseU*gaus.fire();
-      if(fEnableMicroBooNoise) tnoise += noisevector[itck];
-      if(fEnableGaussianNoise) tnoise += fGausNoiseU[gausNoiseChan][itck];
-      if(fEnableCoherentNoise) tnoise += fCohNoiseU[cohNoisechan][itck];
-    } 
-    else if ( view==geo::kV ) {
-      if(fEnableWhiteNoise)    tnoise += fWhiteNoiseV*gaus.fire();
-      if(fEnableMicroBooNoise) tnoise += noisevector[itck];
-      if(fEnableGaussianNoise) tnoise += fGausNoiseV[gausNoiseChan][itck];
-      if(fEnableCoherentNoise) tnoise += fCohNoiseV[cohNoisechan][itck];
-    } 
-    else {
-      if(fEnableWhiteNoise)    tnoise += fWhiteNoiseZ*gaus.fire();
-      if(fEnableMicroBooNoise) tnoise += noisevector[itck];
-      if(fEnableGaussianNoise) tnoise += fGausNoiseZ[gausNoiseChan][itck];
-      if(fEnableCoherentNoise) tnoise += fCohNoiseZ[cohNoisechan][itck];
-    }      
+    if(fEnableWhiteNoise)    tnoise += whiteNoise*gaus.fire();
+    if(fEnableMicroBooNoise) tnoise += noisevector[itck];
+    if(fEnableGaussianNoise) tnoise += (*gausNoise)[gausNoiseChan][itck];
+    if(fEnableCoherentNoise) tnoise += (*cohNoise)[cohNoisechan][itck];
     sigs[itck] += tnoise;
   }
   return 0;
@@ -356,40 +410,13 @@ ostream& SBNDuBooNEDataDrivenNoiseService::print(ostream& out, string prefix) co
 //**********************************************************************
 
 void SBNDuBooNEDataDrivenNoiseService::
-generateGaussianNoise(detinfo::DetectorClocksData const& clockData,
-                      AdcSignalVector& noise, std::vector<float> gausNorm,
-	                    std::vector<float> gausMean, std::vector<float> gausSigma,
-	                    TH1* aNoiseHist) const {
-  const string myname = "SBNDuBooNEDataDrivenNoiseService::generateGaussianNoise: ";
+generateNoiseFromSpectrum(AdcSignalVector& noise, std::vector<double> const& spectrum,
+                          TH1* aNoiseHist) const {
+  const string myname = "SBNDuBooNEDataDrivenNoiseService::generateNoiseFromSpectrum: ";
   if ( fLogLevel > 1 ) {
-    cout << myname << "Generating Gaussian noise." << endl;  
+    cout << myname << "Generating noise from a tabulated spectrum." << endl;  
   }
-  //--- get number of gaussians ---  
-  int a = gausNorm.size();
-  int b = gausMean.size();
-  int c = gausSigma.size();
-  int NGausians = a<b?a:b;
-  NGausians = NGausians<c?NGausians:c;
-  //--- set function formula ---
-  std::stringstream  name;
-  name.str("");
-  for(int i=0;i<NGausians;i++) {
-  	name<<"["<<3*i<<"]*exp(-0.5*pow((x-["<<3*i+1<<"])/["<<3*i+2<<"],2))+";
-  }
-  name<<"0";
-  TF1 *funcGausNoise = new TF1("funcGausInhNoise",name.str().c_str(), 0, 1200);
-  funcGausNoise->SetNpx(12000);
-  for(int i=0;i<NGausians;i++) {
-    funcGausNoise->SetParameter(3*i, gausNorm.at(i));	
-    funcGausNoise->SetParameter(3*i+1, gausMean.at(i));	
-    funcGausNoise->SetParameter(3*i+2, gausSigma.at(i));	
-  }
-  
-  // Fetch sampling rate.
-  float sampleRate = sampling_rate(clockData);
-  // Fetch FFT service and # ticks.
-  art::ServiceHandle<util::LArFFT> pfft;
-  unsigned int ntick = pfft->FFTSize();
+  unsigned int ntick = fCacheNTicks;
   CLHEP::RandFlat flat(*m_pran);
   // Create noise spectrum in frequency.
   unsigned nbin = ntick/2 + 1;
@@ -397,107 +424,17 @@ generateGaussianNoise(detinfo::DetectorClocksData const& clockData,
   double pval = 0.;
   double phase = 0.;
   double rnd[2] = {0.};
-  // width of frequencyBin in kHz
-  double binWidth = 1.0/(ntick*sampleRate*1.0e-6);
-  for ( unsigned int i=0; i<ntick/2+1; ++i ) {
-    // coherent noise spectrum 
-    pval = funcGausNoise->Eval((double)i*binWidth);
+  for ( unsigned int i=0; i<nbin; ++i ) {
+    pval = spectrum[i];
     // randomize amplitude within 10%
     flat.fireArray(2, rnd, 0, 1);
     pval *= 0.9 + 0.2*rnd[0];
     // randomize phase angle
     phase = rnd[1]*2.*TMath::Pi();
-    TComplex tc(pval*cos(phase),pval*sin(phase));
-    noiseFrequency[i] += tc;
-  }
-  // Obtain time spectrum from frequency spectrum.
-  noise.clear();
-  noise.resize(ntick,0.0);
-  std::vector<double> tmpnoise(noise.size());
-  pfft->DoInvFFT(noiseFrequency, tmpnoise);
-  noiseFrequency.clear();
-  
-  for ( unsigned int itck=0; itck<noise.size(); ++itck ) {
-    noise[itck] = sqrt(ntick)*tmpnoise[itck];
-  }
-  for ( unsigned int itck=0; itck<noise.size(); ++itck ) {
-    aNoiseHist->Fill(noise[itck]);
-  }
-  
-  //free memory
-  delete funcGausNoise; funcGausNoise = 0;
-}
-////**********************************************************************
-
-void SBNDuBooNEDataDrivenNoiseService::generateCoherentNoise(detinfo::DetectorClocksData const& clockData,
-                      AdcSignalVector& noise, std::vector<float> gausNorm,
-	                    std::vector<float> gausMean, std::vector<float> gausSigma,
-	                    float cohExpNorm, float cohExpWidth, float cohExpOffset, 
-	                    TH1* aNoiseHist) const {
-  const string myname = "SBNDuBooNEDataDrivenNoiseService::generateCoherentGaussianNoise: ";
-  if ( fLogLevel > 1 ) {
-    cout << myname << "Generating Coherent Gaussian noise." << endl;  
-  }
-  //--- get number of gaussians ---  
-  int a = gausNorm.size();
-  int b = gausMean.size();
-  int c = gausSigma.size();
-  int NGausians = a<b?a:b;
-  NGausians = NGausians<c?NGausians:c;
-  //--- set function formula ---
-  std::stringstream  name;
-  name.str("");
-  for(int i=0;i<NGausians;i++) {
-  	name<<"["<<3*i<<"]*exp(-0.5*pow((x-["<<3*i+1<<"])/["<<3*i+2<<"],2))+";
-  }
-  name<<"["<<3*NGausians<<"]*exp(-x/["<<3*NGausians+1<<"]) + ["<<3*NGausians+2<<"]";
-  TF1 *funcCohNoise = new TF1("funcGausCohsNoise",name.str().c_str(), 0, 1200);
-  funcCohNoise->SetNpx(12000);
-  for(int i=0;i<NGausians;i++) {
-    funcCohNoise->SetParameter(3*i, gausNorm.at(i));	
-    funcCohNoise->SetParameter(3*i+1, gausMean.at(i));	
-    funcCohNoise->SetParameter(3*i+2, gausSigma.at(i));	
-  }
-  funcCohNoise->SetParameter(3*NGausians, cohExpNorm);
-  funcCohNoise->SetParameter(3*NGausians+1, cohExpWidth);
-  funcCohNoise->SetParameter(3*NGausians+2, cohExpOffset);
-  
-  // custom poisson  
-  TF1* _poisson = new TF1("_poisson", "[0]**(x) * exp(-[0]) / ROOT::Math::tgamma(x+1.)", 0, 30);
-  // poisson mean
-  double params[1] = {0.};
-  params[0] = 4; // hard-coded for now. To be updated with data
-  _poisson->SetParameters(params);
-  // Fetch sampling rate.
-  float sampleRate = sampling_rate(clockData);
-  // Fetch FFT service and # ticks.
-  art::ServiceHandle<util::LArFFT> pfft;
-  unsigned int ntick = pfft->FFTSize();
-  CLHEP::RandFlat flat(*m_pran);
-  // Create noise spectrum in frequency.
-  unsigned nbin = ntick/2 + 1;
-  std::vector<TComplex> noiseFrequency(nbin, 0.);
-  double pval = 0.;
-  double phase = 0.;
-  double rnd[2] = {0.};
-  // width of frequencyBin in kHz
-  double binWidth = 1.0/(ntick*sampleRate*1.0e-6);
-  for ( unsigned int i=0; i<ntick/2+1; ++i ) {
-    // coherent noise spectrum 
-    pval = funcCohNoise->Eval((double)i*binWidth);
-    // randomize amplitude within 10%
-    flat.fireArray(2, rnd, 0, 1);
-    pval *= 0.9 + 0.2*rnd[0];
-    phase = rnd[1]*2.*TMath::Pi(); 
-    TComplex tc(pval*cos(phase),pval*sin(phase));
-    noiseFrequency[i] += tc;
+    noiseFrequency[i] = TComplex(pval*cos(phase),pval*sin(phase));
   }
   // Obtain time spectrum from frequency spectrum.
-  noise.clear();
-  noise.resize(ntick,0.0);
-  std::vector<double> tmpnoise(noise.size());
-  pfft->DoInvFFT(noiseFrequency, tmpnoise);
-  noiseFrequency.clear();
+  fWorkspaces->local().fft.DoInvFFT(noiseFrequency, noise);
   
   // Note: Assume that the frequency function is obtained from a fit 
   // of the foward FFT spectrum. In LArSoft, the forward
@@ -508,15 +445,11 @@ void SBNDuBooNEDataDrivenNoiseService::generateCoherentNoise(detinfo::DetectorCl
   // (scaled with 1./sqrt(Nticks)).
   // Therefore, after InvFFT, the waveform must be nomalized with sqrt(Nticks).
   
+  double const norm = sqrt(ntick);
   for ( unsigned int itck=0; itck<noise.size(); ++itck ) {
-    noise[itck] = sqrt(ntick)*tmpnoise[itck];
-  }
-  for ( unsigned int itck=0; itck<noise.size(); ++itck ) {
+    noise[itck] *= norm;
     aNoiseHist->Fill(noise[itck]);
   }
-  
-  //free memory
-  delete funcCohNoise; funcCohNoise = 0;
 }
 
 //**********************************************************************
@@ -555,15 +488,17 @@ unsigned int SBNDuBooNEDataDrivenNoiseService::getCohNoiseChanFromGroup(unsigned
 //**********************************************************************
 
 void SBNDuBooNEDataDrivenNoiseService::generateNoise(detinfo::DetectorClocksData const& clockData){
+
+  buildNoiseModelCache(clockData);
     
   if(fEnableGaussianNoise) {
     fGausNoiseU.resize(fNoiseArrayPoints);
     fGausNoiseV.resize(fNoiseArrayPoints);
     fGausNoiseZ.resize(fNoiseArrayPoints);
     for ( unsigned int i=0; i<fNoiseArrayPoints; ++i ) {
-      generateGaussianNoise(clockData, fGausNoiseU[i], fGausNormU, fGausMeanU, fGausSigmaU, fGausNoiseHistU);
-      generateGaussianNoise(clockData, fGausNoiseV[i], fGausNormV, fGausMeanV, fGausSigmaV, fGausNoiseHistV);
-      generateGaussianNoise(clockData, fGausNoiseZ[i], fGausNormZ, fGausMeanZ, fGausSigmaZ, fGausNoiseHistZ);
+      generateNoiseFromSpectrum(fGausNoiseU[i], fGausSpectrumU, fGausNoiseHistU);
+      generateNoiseFromSpectrum(fGausNoiseV[i], fGausSpectrumV, fGausNoiseHistV);
+      generateNoiseFromSpectrum(fGausNoiseZ[i], fGausSpectrumZ, fGausNoiseHistZ);
     }
   }
   
@@ -572,28 +507,21 @@ void SBNDuBooNEDataDrivenNoiseService::generateNoise(detinfo::DetectorClocksData
     makeCoherentGroupsByOfflineChannel(fNChannelsPerCoherentGroup[0]);
     fCohNoiseU.resize(fCohNoiseArrayPoints); 
     for ( unsigned int i=0; i<fCohNoiseArrayPoints; ++i ) {
-      generateCoherentNoise(clockData, fCohNoiseU[i], fCohGausNorm, fCohGausMean, fCohGausSigma, 
-                            fCohExpNorm, fCohExpWidth, fCohExpOffset, 
-                            fCohNoiseHist);
+      generateNoiseFromSpectrum(fCohNoiseU[i], fCohSpectrum, fCohNoiseHist);
     }
     
     // V plane
     makeCoherentGroupsByOfflineChannel(fNChannelsPerCoherentGroup[1]);
     fCohNoiseV.resize(fCohNoiseArrayPoints);
     for ( unsigned int i=0; i<fCohNoiseArrayPoints; ++i ) {
-      generateCoherentNoise(clockData, fCohNoiseV[i], fCohGausNorm, fCohGausMean, fCohGausSigma, 
-                            fCohExpNorm, fCohExpWidth, fCohExpOffset, 
-                            fCohNoiseHist);
+      generateNoiseFromSpectrum(fCohNoiseV[i], fCohSpectrum, fCohNoiseHist);
     }
 
     // Z plane
     makeCoherentGroupsByOfflineChannel(fNChannelsPerCoherentGroup[2]);
     fCohNoiseZ.resize(fCohNoiseArrayPoints);
     for ( unsigned int i=0; i<fCohNoiseArrayPoints; ++i ) {
-
-      generateCoherentNoise(clockData, fCohNoiseZ[i], fCohGausNorm, fCohGausMean, fCohGausSigma, 
-                            fCohExpNorm, fCohExpWidth, fCohExpOffset, 
-                            fCohNoiseHist);
+      generateNoiseFromSpectrum(fCohNoiseZ[i], fCohSpectrum, fCohNoiseHist);
     }
   }
 }
@@ -0,0 +1,99 @@
+////////////////////////////////////////////////////////////////////////
+/// \file   SimChannelRasterizer.h
+///
+/// \brief  Scatter the charge of a sim::SimChannel onto the TPC tick grid.
+///
+/// Looking up sim::SimChannel::Charge() for every tick costs a search of
+/// the TDC map per tick, even when the channel has a handful of TDCs.
+/// The rasterizer converts ticks to TDCs once (per event, since the clock
+/// data may change), and then walks each channel's TDC -> IDE map once,
+/// writing the charge into the ticks which read out that TDC.
+///
+/// The result is identical to
+///
+///     for (t = 0; t < nTicks; ++t) {
+///       int tdc = clockData.TPCTick2TDC(t);
+///       if (tdc >= 0) chargeWork[t] = sc.Charge(tdc);
+///     }
+///
+/// on a zeroed buffer, at a cost of O(TDCs) per channel.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SIMCHANNELRASTERIZER_H
+#define SIMCHANNELRASTERIZER_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "lardataalg/DetectorInfo/DetectorClocksData.h"
+#include "lardataobj/Simulation/SimChannel.h"
+
+namespace detsim {
+
+  class SimChannelRasterizer {
+  public:
+
+    /// Precompute which ticks of [0, nTicks) read out each TDC
+    SimChannelRasterizer(detinfo::DetectorClocksData const& clockData, std::size_t nTicks);
+
+    std::size_t NTicks() const { return fNTicks; }
+
+    /// Write the charge of sc into chargeWork, which must hold NTicks()
+    /// zeroed entries; ticks whose TDC has no charge are not touched
+    void Fill(sim::SimChannel const& sc, std::vector<double>& chargeWork) const;
+
+  private:
+
+    std::size_t fNTicks;
+    long fFirstTDC = 0;   ///< TDC of the first tick with non-negative TDC
+    long fLastTDC = -1;   ///< TDC of the last tick
+    std::vector<std::pair<std::size_t, std::size_t>> fTickRange; ///< [first, last) ticks, by TDC - fFirstTDC
+  };
+
+} // namespace detsim
+
+//----------------------------------------------------------------------
+inline detsim::SimChannelRasterizer::SimChannelRasterizer(detinfo::DetectorClocksData const& clockData,
+                                                          std::size_t nTicks)
+  : fNTicks(nTicks)
+{
+  // the tick to TDC conversion is linear, so the ticks reading out
+  // a given TDC are contiguous and TDCs increase with the tick
+  bool first = true;
+  for (std::size_t t = 0; t < fNTicks; ++t) {
+    int const tdc = clockData.TPCTick2TDC(t);
+    if (tdc < 0) continue;
+    if (first) {
+      fFirstTDC = tdc;
+      first = false;
+    }
+    fLastTDC = tdc;
+    if ((std::size_t)(fLastTDC - fFirstTDC) >= fTickRange.size())
+      fTickRange.resize(fLastTDC - fFirstTDC + 1, { t, t });
+    auto& range = fTickRange[tdc - fFirstTDC];
+    if (range.first == range.second) range.first = t;
+    range.second = t + 1;
+  }
+}
+
+//----------------------------------------------------------------------
+inline void detsim::SimChannelRasterizer::Fill(sim::SimChannel const& sc,
+                                               std::vector<double>& chargeWork) const
+{
+  for (auto const& tdcide : sc.TDCIDEMap()) {
+    long const tdc = tdcide.first;
+    if (tdc < fFirstTDC || tdc > fLastTDC) continue;
+
+    auto const& range = fTickRange[tdc - fFirstTDC];
+    if (range.first == range.second) continue;
+
+    // same summation as sim::SimChannel::Charge()
+    double charge = 0.;
+    for (auto const& ide : tdcide.second) charge += ide.numElectrons;
+
+    for (std::size_t t = range.first; t < range.second; ++t) chargeWork[t] = charge;
+  }
+}
+
+#endif // SIMCHANNELRASTERIZER_H
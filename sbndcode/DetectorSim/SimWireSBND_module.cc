@@ -15,6 +15,8 @@
 #include <sstream>
 #include <fstream>
 #include <bitset>
+#include <memory>
+#include <tuple>
 
 extern "C" {
 #include <sys/types.h>
@@ -26,6 +28,7 @@ extern "C" {
 #include "art/Framework/Core/EDProducer.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
+#include "art/Framework/Principal/Run.h"
 #include "art/Framework/Services/Registry/ServiceHandle.h"
 #include "art_root_io/TFileService.h"
 #include "art_root_io/TFileDirectory.h"
@@ -57,8 +60,17 @@ extern "C" {
 
 #include "CLHEP/Random/RandFlat.h"
 #include "CLHEP/Random/RandGaussQ.h"
+#include "CLHEP/Random/MixMaxRng.h"
+
+#include "tbb/blocked_range.h"
+#include "tbb/enumerable_thread_specific.h"
+#include "tbb/parallel_for.h"
 
 #include "sbndcode/DetectorSim/Services/ChannelNoiseService.h"
+#include "sbndcode/DetectorSim/SimChannelRasterizer.h"
+#include "sbndcode/DetectorSim/NoiseWaveformLibrary.h"
+#include "sbndcode/DetectorSim/RawDigitBuilder.h"
+#include "sbndcode/Utilities/FFTWorkspaceSBND.h"
 
 ///Detector simulation of raw signals on wires
 namespace detsim {
@@ -74,6 +86,7 @@ public:
   // read/write access to event
   void produce (art::Event& evt);
   void beginJob();
+  void beginRun(art::Run& run);
   void endJob();
   void reconfigure(fhicl::ParameterSet const& p);
 
@@ -82,6 +95,31 @@ private:
   void GenNoiseInTime(std::vector<float> &noise, double noise_factor) const;
   void GenNoiseInFreq(std::vector<float> &noise, double noise_factor) const;
 
+  /// Channel-sharded digitization of all channels (ParallelDigitization)
+  void ProduceParallel(detinfo::DetectorClocksData const& clockData,
+                       SimChannelRasterizer const& rasterizer,
+                       std::vector<const sim::SimChannel*> const& channels,
+                       std::vector<raw::RawDigit>& digcol);
+
+  /// Fill the noise library, from NoiseLibraryFile if it matches the configuration
+  void BuildNoiseLibrary();
+
+  /// Pedestal and pre-amplifier saturation of a channel, in ADC
+  std::pair<float, float> PedestalAndSaturation(geo::SigType_t sigtype) const;
+
+  /// Combine signal, noise and pedestal into saturated ADC counts
+  void FillADC(std::vector<double> const& chargeWork, std::vector<float> const& noisetmp,
+               float ped_mean, float preamp_sat, std::vector<short>& adcvec) const;
+
+  /// Per-thread buffers for the parallel digitization
+  struct ChannelWorkspace {
+    ChannelWorkspace(size_t nTicks, size_t nSamples, raw::Compress_t compression)
+      : fft(nTicks), digitBuilder(nSamples, compression) {}
+    util::FFTWorkspaceSBND fft;
+    RawDigitBuilder        digitBuilder;
+    CLHEP::MixMaxRng       engine;
+  };
+
   std::string            fDriftEModuleLabel;///< module making the ionization electrons
   raw::Compress_t        fCompression;      ///< compression type to use
 
@@ -100,6 +138,12 @@ private:
   bool fGetNoiseFromHisto;                  ///< if True -> Noise from Histogram of Freq. spectrum
   bool fGenNoiseInTime;                     ///< if True -> Noise with Gaussian dsitribution in Time-domain
   bool fGenNoise;                           ///< if True -> Gen Noise. if False -> Skip noise generation entierly
+  bool fParallelDigitization;               ///< if True -> digitize channels concurrently, with per-channel random streams
+  unsigned int fParallelGrainSize;          ///< number of channels per task in parallel digitization
+  bool fUseNoiseLibrary;                    ///< if True -> add noise from a pool of waveforms generated at the first beginRun
+  unsigned int fNoiseLibrarySize;           ///< number of pool waveforms per view and wire length class
+  double fNoiseLibraryWireLengthBin;        ///< wire length bin of the noise library classes (cm)
+  std::string fNoiseLibraryFile;            ///< file to read the pool from, or to save it to; empty for none
 
   art::ServiceHandle<ChannelNoiseService> noiseserv;
 
@@ -116,6 +160,17 @@ private:
 
   //CLHEP::HepRandomEngine& fNoiseEngine;
   CLHEP::HepRandomEngine& fPedestalEngine;
+  CLHEP::HepRandomEngine* fDigitizationEngine = nullptr; ///< seeds the per-channel streams of parallel digitization
+  CLHEP::HepRandomEngine* fNoiseLibraryEngine = nullptr; ///< picks the noise library waveforms in serial digitization
+
+  NoiseWaveformLibrary fNoiseLibrary;
+  bool fNoiseLibraryBuilt = false;
+
+  std::unique_ptr<tbb::enumerable_thread_specific<ChannelWorkspace>> fWorkspaces;
+  std::unique_ptr<util::FFTWorkspaceSBND> fFFTWorkspace; ///< FFT plans and scratch of the serial digitization
+
+  /// Channels held in memory at once when noise has to be added serially
+  static constexpr unsigned int kParallelBlockSize{512};
 
 }; // class SimWireSBND
 
@@ -131,6 +186,16 @@ SimWireSBND::SimWireSBND(fhicl::ParameterSet const& pset)
 {
   this->reconfigure(pset);
 
+  // created only when needed, so that the seeds of the other engines are unchanged
+  if (fParallelDigitization) {
+    fDigitizationEngine = &art::ServiceHandle<rndm::NuRandomService>{}
+      ->createEngine(*this, "HepJamesRandom", "digitization", pset, "SeedDigitization");
+  }
+  else if (fUseNoiseLibrary) {
+    fNoiseLibraryEngine = &art::ServiceHandle<rndm::NuRandomService>{}
+      ->createEngine(*this, "HepJamesRandom", "noiselibrary", pset, "SeedNoiseLibrary");
+  }
+
   produces< std::vector<raw::RawDigit>   >();
 
   fCompression = raw::kNone;
@@ -154,6 +219,12 @@ void SimWireSBND::reconfigure(fhicl::ParameterSet const& p)
   fGetNoiseFromHisto = p.get< bool                >("GetNoiseFromHisto");
   fGenNoiseInTime    = p.get< bool                >("GenNoiseInTime");
   fGenNoise          = p.get< bool                >("GenNoise");
+  fParallelDigitization = p.get< bool             >("ParallelDigitization", false);
+  fParallelGrainSize = p.get< unsigned int        >("ParallelGrainSize", 16);
+  fUseNoiseLibrary   = p.get< bool                >("UseNoiseLibrary", false);
+  fNoiseLibrarySize  = p.get< unsigned int        >("NoiseLibrarySize", 100);
+  fNoiseLibraryWireLengthBin = p.get< double      >("NoiseLibraryWireLengthBin", 25.);
+  fNoiseLibraryFile  = p.get< std::string         >("NoiseLibraryFile", "");
   fCollectionPed     = p.get< float               >("CollectionPed",690.);
   fInductionPed      = p.get< float               >("InductionPed",2100.);
   fCollectionSat     = p.get< float               >("CollectionSat",2922.);
@@ -222,6 +293,15 @@ void SimWireSBND::beginJob()
     mf::LogError("SimWireSBND") << "Cannot have number of readout samples "
                                  << "greater than FFTSize!";
 
+  if (fParallelDigitization) {
+    fWorkspaces = std::make_unique<tbb::enumerable_thread_specific<ChannelWorkspace>>(fNTicks, fNTimeSamples, fCompression);
+    mf::LogInfo("SimWireSBND") << "Digitizing channels in parallel, "
+                               << fParallelGrainSize << " channels per task; noise "
+                               << (fUseNoiseLibrary || noiseserv->canAddNoiseConcurrently()? "in parallel": "serially");
+  }
+  else
+    fFFTWorkspace = std::make_unique<util::FFTWorkspaceSBND>(fNTicks, fFFT->FFTOptions());
+
   return;
 
 }
@@ -235,7 +315,7 @@ void SimWireSBND::produce(art::Event& evt)
   auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(evt);
 
   //Generate gaussian and coherent noise if doing uBooNE noise model. For other models it does nothing.
-  noiseserv->generateNoise(clockData);
+  if (!fUseNoiseLibrary) noiseserv->generateNoise(clockData);
 
   // get the geometry to be able to figure out signal types and chan -> plane mappings
   art::ServiceHandle<geo::Geometry> geo;
@@ -258,19 +338,28 @@ void SimWireSBND::produce(art::Event& evt)
 
   const auto NChannels = geo->Nchannels();
 
-  // vectors for working
-  std::vector<short>    adcvec(fNTimeSamples, 0);
-  std::vector<double>   chargeWork(fNTicks, 0.);
-
-
+  // tick <-> TDC correspondence, shared by all channels
+  SimChannelRasterizer const rasterizer(clockData, fNTicks);
 
   // make a unique_ptr of sim::SimDigits that allows ownership of the produced
   // digits to be transferred to the art::Event after the put statement below
   std::unique_ptr< std::vector<raw::RawDigit>> digcol(new std::vector<raw::RawDigit>);
+
+  if (fParallelDigitization) {
+    ProduceParallel(clockData, rasterizer, channels, *digcol);
+    evt.put(std::move(digcol));
+    return;
+  }
+
+  // vectors for working, reused for all channels; the ADC buffer of each
+  // channel is moved into its digit
+  std::vector<double>   chargeWork(fNTicks, 0.);
+  std::vector<float>    noisetmp(fNTicks, 0.);
+  RawDigitBuilder       digitBuilder(fNTimeSamples, fCompression);
+
   digcol->reserve(NChannels);
 
   unsigned int chan = 0;
-  art::ServiceHandle<util::LArFFT> fFFT;
      
   //LOOP OVER ALL CHANNELS
   std::map<int, double>::iterator mapIter;
@@ -281,23 +370,14 @@ void SimWireSBND::produce(art::Event& evt)
     std::fill(chargeWork.begin(), chargeWork.end(), 0.);
     if ( sc ) {
 
-      // loop over the tdcs and grab the number of electrons for each
-      for (int t = 0; t < (int)(chargeWork.size()); ++t) {
-
-        int tdc = clockData.TPCTick2TDC(t);
-
-        // continue if tdc < 0
-        if ( tdc < 0 ) continue;
-
-        chargeWork.at(t) = sc->Charge(tdc);
-
-      }
+      // grab the number of electrons for each tick
+      rasterizer.Fill(*sc, chargeWork);
 
       // Convolve charge with appropriate response function
-      sss->Convolute(clockData, chan, chargeWork);
+      sss->Convolute(clockData, chan, chargeWork, *fFFTWorkspace);
 
     }
-    std::vector<float> noisetmp(fNTicks, 0.);
+    std::fill(noisetmp.begin(), noisetmp.end(), 0.);
     /*
     //If not using new noise, use old method.
     if(fUseNewNoise==false) {
@@ -346,63 +426,202 @@ void SimWireSBND::produce(art::Event& evt)
 
 */
     // Add noise to channel.
-    noiseserv->addNoise(clockData, chan,noisetmp);
+    if (fUseNoiseLibrary) fNoiseLibrary.AddNoise(chan, noisetmp, *fNoiseLibraryEngine);
+    else noiseserv->addNoise(clockData, chan,noisetmp);
 
     //Pedestal determination
-    float ped_mean = fCollectionPed;
-    float preamp_sat=fCollectionSat;
-    geo::SigType_t sigtype = geo->SignalType(chan);
-    if (sigtype == geo::kInduction) {
-      ped_mean = fInductionPed;
-      preamp_sat = fInductionSat;
-    }
-    else if (sigtype == geo::kCollection) {    
-      ped_mean = fCollectionPed;
-      preamp_sat=fCollectionSat;
-    }
+    float ped_mean, preamp_sat;
+    std::tie(ped_mean, preamp_sat) = PedestalAndSaturation(geo->SignalType(chan));
     //slight variation on ped on order of RMS of baseline variation
-    CLHEP::RandGaussQ rGaussPed(fPedestalEngine, 0.0, fBaselineRMS);
-    ped_mean += rGaussPed.fire();
+    ped_mean += CLHEP::RandGaussQ::shoot(&fPedestalEngine, 0.0, fBaselineRMS);
+
+    FillADC(chargeWork, noisetmp, ped_mean, preamp_sat, digitBuilder.ADCs());
+
+    //Add Noise to NoiseDist Histogram
+    for (unsigned int i = 0; i < fNTimeSamples; i += 100)
+      fNoiseDist->Fill(noisetmp.at(i));
 
-    for (unsigned int i = 0; i < fNTimeSamples; ++i) {
+    // compress the adc vector using the desired compression scheme,
+    // if raw::kNone is selected nothing happens to it,
+    // and add this digit to the collection
+    digcol->push_back(digitBuilder.Make(chan, ped_mean));
 
-      float chargecontrib = chargeWork.at(i);
-      if (chargecontrib>preamp_sat) chargecontrib=preamp_sat;
+  }// end loop over channels
 
-      float adcval = noisetmp.at(i) + chargecontrib + ped_mean;
+  evt.put(std::move(digcol));
+}
 
-      //Add Noise to NoiseDist Histogram
-      if (i % 100 == 0)
+//-------------------------------------------------
+// Digitize the channels in blocks of kParallelBlockSize. Within a block,
+// charge, convolution, pedestal and (if the service allows it) noise are
+// computed concurrently; each channel draws from its own random stream,
+// seeded from the event draw of fDigitizationEngine and the channel number,
+// so the output does not depend on the number of threads or on how the
+// channels are scheduled. Noise services which cannot run concurrently are
+// called serially in channel order on each block. Digits are stored at
+// their channel index, in the same order as the serial digitization.
+void SimWireSBND::ProduceParallel(detinfo::DetectorClocksData const& clockData,
+                                  SimChannelRasterizer const& rasterizer,
+                                  std::vector<const sim::SimChannel*> const& channels,
+                                  std::vector<raw::RawDigit>& digcol)
+{
+  art::ServiceHandle<geo::Geometry const> geo;
+  art::ServiceHandle<util::SignalShapingServiceSBND const> sss;
+  ChannelNoiseService const& noise = *noiseserv;
+  bool const concurrentNoise = fUseNoiseLibrary || noise.canAddNoiseConcurrently();
+
+  long const eventSeeds[2] = {
+    CLHEP::RandFlat::shootInt(fDigitizationEngine, 0x7FFFFFFFL),
+    CLHEP::RandFlat::shootInt(fDigitizationEngine, 0x7FFFFFFFL)
+  };
+
+  unsigned int const NChannels = channels.size();
+  digcol.resize(NChannels);
+
+  unsigned int const blockSize = std::min(kParallelBlockSize, NChannels);
+  std::vector<std::vector<double>> blockCharge(blockSize, std::vector<double>(fNTicks, 0.));
+  std::vector<std::vector<float>>  blockNoise(blockSize, std::vector<float>(fNTicks, 0.));
+  std::vector<float>               blockPed(blockSize, 0.);
+
+  for (unsigned int first = 0; first < NChannels; first += blockSize) {
+    unsigned int const last = std::min(first + blockSize, NChannels);
+
+    // signal, pedestal and, if possible, noise
+    tbb::parallel_for(tbb::blocked_range<unsigned int>(first, last, fParallelGrainSize),
+      [&](tbb::blocked_range<unsigned int> const& range) {
+        ChannelWorkspace& ws = fWorkspaces->local();
+        for (unsigned int chan = range.begin(); chan != range.end(); ++chan) {
+          unsigned int const i = chan - first;
+
+          long const seeds[3] = { eventSeeds[0], eventSeeds[1], (long) chan };
+          ws.engine.setSeeds(seeds, 3);
+
+          std::vector<double>& chargeWork = blockCharge[i];
+          std::fill(chargeWork.begin(), chargeWork.end(), 0.);
+          if (sim::SimChannel const* sc = channels[chan]) {
+            rasterizer.Fill(*sc, chargeWork);
+            sss->Convolute(clockData, chan, chargeWork, ws.fft);
+          }
+
+          blockPed[i] = CLHEP::RandGaussQ::shoot(&ws.engine, 0.0, fBaselineRMS);
+
+          std::vector<float>& noisetmp = blockNoise[i];
+          std::fill(noisetmp.begin(), noisetmp.end(), 0.);
+          if (fUseNoiseLibrary) fNoiseLibrary.AddNoise(chan, noisetmp, ws.engine);
+          else if (concurrentNoise) noise.addNoise(clockData, chan, noisetmp, ws.engine);
+        }
+      });
+
+    if (!concurrentNoise) {
+      for (unsigned int chan = first; chan < last; ++chan)
+        noiseserv->addNoise(clockData, chan, blockNoise[chan - first]);
+    }
+
+    // ADC conversion and compression
+    tbb::parallel_for(tbb::blocked_range<unsigned int>(first, last, fParallelGrainSize),
+      [&](tbb::blocked_range<unsigned int> const& range) {
+        RawDigitBuilder& digitBuilder = fWorkspaces->local().digitBuilder;
+        for (unsigned int chan = range.begin(); chan != range.end(); ++chan) {
+          unsigned int const i = chan - first;
+
+          float ped_mean, preamp_sat;
+          std::tie(ped_mean, preamp_sat) = PedestalAndSaturation(geo->SignalType(chan));
+          ped_mean += blockPed[i];
+
+          FillADC(blockCharge[i], blockNoise[i], ped_mean, preamp_sat, digitBuilder.ADCs());
+          digcol[chan] = digitBuilder.Make(chan, ped_mean);
+        }
+      });
+
+    //Add Noise to NoiseDist Histogram
+    for (unsigned int chan = first; chan < last; ++chan) {
+      std::vector<float> const& noisetmp = blockNoise[chan - first];
+      for (unsigned int i = 0; i < fNTimeSamples; i += 100)
         fNoiseDist->Fill(noisetmp.at(i));
+    }
 
-      //allow for ADC saturation
-      if ( adcval > adcsaturation )
-        adcval = adcsaturation;
-      //don't allow for "negative" saturation
-      if ( adcval < 0 )
-        adcval = 0;
+  }// end loop over blocks
+}
 
-      adcvec.at(i) = (unsigned short)(adcval+0.5);
+//-------------------------------------------------
+// The noise library is built here rather than in beginJob(): the noise
+// services take the electronics response from SignalShapingServiceSBND,
+// which fills its channel tables at the beginning of the run.
+void SimWireSBND::beginRun(art::Run&)
+{
+  if (fUseNoiseLibrary && !fNoiseLibraryBuilt) {
+    BuildNoiseLibrary();
+    fNoiseLibraryBuilt = true;
+  }
+}
 
-    }// end loop over signal size
+//-------------------------------------------------
+// The noise service is called for one channel of each view and wire length
+// class, NoiseLibrarySize times; its noise arrays are regenerated for each
+// of these sets, as they would be for each event, so that no array (e.g. a
+// coherent noise one) is shared by the waveforms of a class.
+void SimWireSBND::BuildNoiseLibrary()
+{
+  auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataForJob();
+  noiseserv->generateNoise(clockData);
 
-    // resize the adcvec to be the correct number of time samples,
-    // just drop the extra samples
-    //adcvec.resize(fNTimeSamples);
+  // classes by the wire length the noise model sees, if it has its own
+  art::ServiceHandle<geo::Geometry const> geo;
+  fNoiseLibrary.SetChannelClasses(*geo, fNoiseLibraryWireLengthBin,
+    [&](unsigned int chan) {
+      double const length = noiseserv->noiseWireLength(chan);
+      return (length >= 0.)? length: geo->Wire(geo->ChannelToWire(chan).front()).Length();
+    });
+
+  if (!fNoiseLibraryFile.empty()) {
+    struct stat sb;
+    if (stat(fNoiseLibraryFile.c_str(), &sb) == 0
+        && fNoiseLibrary.Load(fNoiseLibraryFile, fNoiseLibrarySize, fNTicks)) {
+      mf::LogInfo("SimWireSBND") << "Read " << fNoiseLibrary.NWaveforms() << " noise waveforms for each of "
+                                 << fNoiseLibrary.NClasses() << " channel classes from '" << fNoiseLibraryFile << "'";
+      return;
+    }
+  }
 
-    // compress the adc vector using the desired compression scheme,
-    // if raw::kNone is selected nothing happens to adcvec
-    // This shrinks adcvec, if fCompression is not kNone.
-    raw::Compress(adcvec, fCompression);
+  fNoiseLibrary.Generate(fNoiseLibrarySize, fNTicks,
+    [&](unsigned int chan, std::vector<float>& waveform) {
+      noiseserv->addNoise(clockData, chan, waveform);
+    },
+    [&]() { noiseserv->generateNoise(clockData); });
+  mf::LogInfo("SimWireSBND") << "Generated " << fNoiseLibrary.NWaveforms() << " noise waveforms for each of "
+                             << fNoiseLibrary.NClasses() << " channel classes";
 
-    // add this digit to the collection
-    raw::RawDigit rd(chan, fNTimeSamples, adcvec, fCompression);
-    rd.SetPedestal(ped_mean);
-    digcol->push_back(rd);
+  if (!fNoiseLibraryFile.empty()) fNoiseLibrary.Save(fNoiseLibraryFile);
+}
 
-  }// end loop over channels
+//-------------------------------------------------
+std::pair<float, float> SimWireSBND::PedestalAndSaturation(geo::SigType_t sigtype) const
+{
+  if (sigtype == geo::kInduction) return { fInductionPed, fInductionSat };
+  return { fCollectionPed, fCollectionSat };
+}
 
-  evt.put(std::move(digcol));
+//-------------------------------------------------
+void SimWireSBND::FillADC(std::vector<double> const& chargeWork, std::vector<float> const& noisetmp,
+                          float ped_mean, float preamp_sat, std::vector<short>& adcvec) const
+{
+  for (unsigned int i = 0; i < fNTimeSamples; ++i) {
+
+    float chargecontrib = chargeWork.at(i);
+    if (chargecontrib>preamp_sat) chargecontrib=preamp_sat;
+
+    float adcval = noisetmp.at(i) + chargecontrib + ped_mean;
+
+    //allow for ADC saturation
+    if ( adcval > adcsaturation )
+      adcval = adcsaturation;
+    //don't allow for "negative" saturation
+    if ( adcval < 0 )
+      adcval = 0;
+
+    adcvec[i] = (unsigned short)(adcval+0.5);
+
+  }// end loop over signal size
 }
 
 
@@ -33,6 +33,7 @@
 #include "lardataobj/RecoBase/OpFlash.h"
 #include "lardataobj/AnalysisBase/T0.h"
 #include "lardata/Utilities/AssociationUtil.h"
+#include "larcore/CoreUtils/ServiceUtil.h"
 #include "larcore/Geometry/Geometry.h"
 #include "larcorealg/Geometry/GeometryCore.h"
 #include "larcorealg/Geometry/WireGeo.h"
@@ -49,7 +50,7 @@
 #include "TH1.h"
 
 #include "sbndcode/OpDetSim/OpT0FinderTypes.h"
-#include "sbndcode/OpDetSim/sbndPDMapAlg.hh"
+#include "sbndcode/OpDetSim/PDTypeTableServiceSBND.h"
 
 // turn the warnings back on
 #pragma GCC diagnostic pop
@@ -98,7 +99,26 @@ private:
   static const size_t nMaxTPCs = 2; // ICARUS has 4 TPCs, however they need to be run independently
   std::array<flashana::QCluster_t, nMaxTPCs> qClusterInTPC;
 
-  void computeFlashMetrics(size_t idtpc, std::vector<recob::OpHit> const& OpHitSubset);
+  // optical channel properties used by the flash reconstruction
+  struct OpChannelInfo {
+    double x = 0., y = 0., z = 0.;  // center of the optical detector
+    int tpc = -1;                   // TPC of fCryostat the detector views, -1 if none
+    bool valid = false;             // channel in the geometry
+    bool inCryostat = false;        // detector in fCryostat
+    opdet::PDType type = opdet::PDType::kUnknown;
+  };
+  // optical hit in the beam window
+  struct LiteOpHit {
+    unsigned int channel;
+    double time;  // us
+    double pe;
+  };
+  using LiteOpHitIt = std::vector<LiteOpHit>::const_iterator;
+
+  void fillOpChannelTable();
+  OpChannelInfo const& opChannel(unsigned int ch) const;
+  bool findFlashTime(double& flashTime); // false if there is no flash
+  void computeFlashMetrics(size_t idtpc, LiteOpHitIt begin, LiteOpHitIt end);
   ::flashana::Flash_t GetFlashPESpectrum(const recob::OpFlash& opflash);
   void CollectDownstreamPFParticles(const lar_pandora::PFParticleMap &pfParticleMap,
                                     const art::Ptr<recob::PFParticle> &particle,
@@ -109,18 +129,45 @@ private:
   void AddDaughters(const art::Ptr<recob::PFParticle>& pfp_ptr,
                     const art::ValidHandle<std::vector<recob::PFParticle> >& pfp_h,
                     std::vector<art::Ptr<recob::PFParticle> > &pfp_v);
-  bool isPDInCryoTPC(double pd_x, int icryo, size_t itpc, std::string detector);
-  bool isPDInCryoTPC(int pdChannel, int icryo, size_t itpc, std::string detector);
-  bool isChargeInCryoTPC(double qp_x, int icryo, int itpc, std::string detector);
-
+  bool isPDInCryoTPC(double pd_x, int icryo, size_t itpc, std::string const& detector) const;
+  bool isChargeInCryoTPC(double qp_x, int icryo, int itpc, std::string const& detector) const;
+
+  // wire plane properties used by the charge reconstruction
+  struct WirePlaneInfo {
+    bool collection = false;
+    std::vector<double> wireX;  // x of the center of each wire, collection planes only
+  };
+  // collection plane charge of a spacepoint
+  struct ChargePoint {
+    size_t tpc;
+    double x, y, z;  // x is the distance from the wire plane
+    double q;
+  };
+
+  void fillWirePlaneTable();
+  WirePlaneInfo const& wirePlane(geo::PlaneID const& pid) const;
+  void fillChargeIndex(std::vector<recob::SpacePoint> const& spacepoints,
+                       art::FindManyP<recob::Hit> const& spacepoint_hit_assn_v);
   int icountPE = 0;
   const art::ServiceHandle<geo::Geometry> geometry;
-  opdet::sbndPDMapAlg pdMap; // SBND opdets map
+  opdet::sbndPDTypeTable const* fPDTypes = nullptr; // SBND opdets types, null for ICARUS
+
+  std::vector<OpChannelInfo> fOpChannels; // by channel, filled at beginJob
+  std::vector<WirePlaneInfo> fWirePlanes; // by (cryostat, TPC, plane), filled at beginJob
+  size_t fMaxTPCs, fMaxPlanes;
+  // charge of the spacepoints of the event: the points of spacepoint i
+  // are fChargePoints[fSpacePointCharge[i], fSpacePointCharge[i+1])
+  std::vector<size_t> fSpacePointCharge;
+  std::vector<ChargePoint> fChargePoints;
+  std::vector<LiteOpHit> fOpHits;         // hits of the event in the beam window, by time
+  // flash time: PE of the coated PMT hits in bins of fTimeBinWidth (2 ns)
+  // over the beam window; only the occupied bins are kept
+  int fNTimeBins;
+  double fTimeBinWidth;
+  std::vector<std::pair<int, double>> fTimeBinPE; // (bin, PE)
 
   // root stuff
   TTree* _flashmatch_nuslice_tree;
-  TH1D *ophittime;
-  TH1D *ophittime2;
 
   // Tree variables
   std::vector<double> _pe_reco_v, _pe_hypo_v;
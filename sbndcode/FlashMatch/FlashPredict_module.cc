@@ -49,13 +49,12 @@ FlashPredict::FlashPredict(fhicl::ParameterSet const& p)
                                                << "Check Detector and Cryostat parameter." << std::endl;
   }
 
+  if (fDetector == "SBND") fPDTypes = lar::providerFrom<opdet::PDTypeTableServiceSBND>();
+
   art::ServiceHandle<art::TFileService> tfs;
 
-  int time_bins = int(500 * (fBeamWindowEnd - fBeamWindowStart));
-  ophittime = tfs->make<TH1D>("ophittime", "ophittime", time_bins, fBeamWindowStart, fBeamWindowEnd); // in us
-  ophittime->SetOption("HIST");
-  ophittime2 = tfs->make<TH1D>("ophittime2", "ophittime2", 5 * time_bins, -5.0, +10.0); // in us
-  ophittime2->SetOption("HIST");
+  fNTimeBins = int(500 * (fBeamWindowEnd - fBeamWindowStart));
+  fTimeBinWidth = (fBeamWindowEnd - fBeamWindowStart) / fNTimeBins; // in us
 
   if (fMakeTree) {
     _flashmatch_nuslice_tree = tfs->make<TTree>("nuslicetree", "nu FlashPredict tree");
@@ -218,7 +217,6 @@ void FlashPredict::produce(art::Event & e)
     mf::LogWarning("FlashPredict") << "nTPC can't be larger than 2, resizing.";
     nTPCs = 2;
   }
-  geo::CryostatGeo geo_cryo = geometry->Cryostat(fCryostat);
 
   // grab PFParticles in event
   auto const& pfp_h = e.getValidHandle<std::vector<recob::PFParticle> >(fPandoraProducer);
@@ -248,65 +246,48 @@ void FlashPredict::produce(art::Event & e)
     e.put(std::move(pfp_t0_assn_v));
     return;
   }
-  std::vector<recob::OpHit> const& OpHitCollection(*ophit_h);
-  std::vector<recob::OpHit> OpHitSubset(OpHitCollection.size());
-
-  // copy ophits that are inside the time window and with PEs
-  auto it = std::copy_if(OpHitCollection.begin(), OpHitCollection.end(), OpHitSubset.begin(),
-                         [this](const recob::OpHit& oph)-> bool
-                           { return ((oph.PeakTime() > fBeamWindowStart) &&
-                                     (oph.PeakTime() < fBeamWindowEnd)   &&
-                                     (oph.PE() > 0)); });
-  OpHitSubset.resize(std::distance(OpHitSubset.begin(), it));
-  // TODO: release OpHitCollection memory now
+  // copy the ophits that are inside the time window and with PEs,
+  // sorted by time
+  fOpHits.clear();
+  for (auto const& oph : *ophit_h) {
+    if ((oph.PeakTime() > fBeamWindowStart) &&
+        (oph.PeakTime() < fBeamWindowEnd)   &&
+        (oph.PE() > 0))
+      fOpHits.push_back({ (unsigned int)oph.OpChannel(), oph.PeakTime(), oph.PE() });
+  }
+  std::sort(fOpHits.begin(), fOpHits.end(),
+            [](LiteOpHit const& a, LiteOpHit const& b) { return a.time < b.time; });
 
   _pfpmap.clear();
   for (size_t p=0; p<pfp_h->size(); p++) _pfpmap[pfp_h->at(p).Self()] = p;
 
   // get flash time
-  ophittime->Reset();
-  ophittime2->Reset();
-  for(auto const& oph : OpHitSubset) {
-    double PMTxyz[3];
-    geometry->OpDetGeoFromOpChannel(oph.OpChannel()).GetCenter(PMTxyz);
-    if (fDetector == "SBND" && pdMap.isPDType(oph.OpChannel(), "pmt_uncoated"))
-      ophittime2->Fill(oph.PeakTime(), fPEscale * oph.PE());
-    if (fDetector == "SBND" && !pdMap.isPDType(oph.OpChannel(), "pmt_coated")) continue; // use only coated PMTs for SBND for flash_time
-    if (!geo_cryo.ContainsPosition(PMTxyz)) continue;   // use only PMTs in the specified cryostat for ICARUS
-    //    std::cout << "op hit " << j << " channel " << oph.OpChannel() << " time " << oph.PeakTime() << " pe " << fPEscale*oph.PE() << std::endl;
-
-    ophittime->Fill(oph.PeakTime(), fPEscale * oph.PE());
-    // double thisPE = fPEscale*oph.PE();
-    // if (thisPE>1) ophittime->Fill(oph.PeakTime(),thisPE);
-  }
-
-  if (ophittime->GetEntries() <= 0 || ophittime->Integral() < fMinFlashPE) {
+  if (!findFlashTime(_flash_time)) {
     e.put(std::move(T0_v));
     e.put(std::move(pfp_t0_assn_v));
     return;
   }
 
-  auto ibin =  ophittime->GetMaximumBin();
-  _flash_time = (ibin * 0.002) + fBeamWindowStart; // in us
   double lowedge = _flash_time + fLightWindowStart;
   double highedge = _flash_time + fLightWindowEnd;
   mf::LogDebug("FlashPredict") << "light window " << lowedge << " " << highedge << std::endl;
 
   // only use optical hits around the flash time
-  OpHitSubset.erase(std::remove_if(OpHitSubset.begin(), OpHitSubset.end(),
-                                   [lowedge, highedge](const recob::OpHit& oph)-> bool
-                                     { return ((oph.PeakTime() < lowedge) || (oph.PeakTime() > highedge)); }),
-                    OpHitSubset.end());
+  auto const lightBegin = std::lower_bound(fOpHits.cbegin(), fOpHits.cend(), lowedge,
+                                           [](LiteOpHit const& oph, double t) { return oph.time < t; });
+  auto const lightEnd = std::upper_bound(lightBegin, fOpHits.cend(), highedge,
+                                         [](double t, LiteOpHit const& oph) { return t < oph.time; });
 
   // check if the TPC has OpHits
   bool lightInTPC[nMaxTPCs] = {false};
-  for (size_t t=0; t<nMaxTPCs; t++){
-    auto it = std::find_if (OpHitSubset.begin(), OpHitSubset.end(),
-                            [t, this](const recob::OpHit& oph)-> bool
-                              { return isPDInCryoTPC(oph.OpChannel(), fCryostat, t, fDetector); });
-    lightInTPC[t] = (it != OpHitSubset.end());
+  for (auto oph = lightBegin; oph != lightEnd; ++oph) {
+    int const tpc = opChannel(oph->channel).tpc;
+    if (tpc >= 0) lightInTPC[tpc] = true;
   }
 
+  // resolve the charge of all the spacepoints at once
+  fillChargeIndex(*spacepoint_h, spacepoint_hit_assn_v);
+
   // Loop over pandora pfp particles
   for (unsigned int p=0; p<pfp_h->size(); p++) {
     auto const& pfp = pfp_h->at(p);
@@ -319,16 +300,15 @@ void FlashPredict::produce(art::Event & e)
     for (size_t t=0; t<nMaxTPCs; t++) qClusterInTPC[t].clear();
 
     const art::Ptr<recob::PFParticle> pfp_ptr(pfp_h, p);
-    std::vector<recob::PFParticle> pfp_v;
     std::vector<art::Ptr<recob::PFParticle> > pfp_ptr_v;
     AddDaughters(pfp_ptr, pfp_h, pfp_ptr_v);
+    // the charge to photons factor is the one of the primary PFParticle
+    const double chargeToNPhotons = lar_pandora::LArPandoraHelper::IsTrack(pfp_ptr)
+      ? fChargeToNPhotonsTrack : fChargeToNPhotonsShower;
 
     //  loop over all mothers and daughters, fill qCluster
     for (size_t i=0; i<pfp_ptr_v.size(); i++) {
-      const art::Ptr<recob::PFParticle> pfp_ptr(pfp_h, p);
       auto key = pfp_ptr_v.at(i).key();
-      recob::PFParticle pfp = *pfp_ptr_v.at(i);
-      pfp_v.push_back(pfp);
 
       /*
         if ( fUseCalo && lar_pandora::LArPandoraHelper::IsTrack(pfp_ptr)) {
@@ -361,35 +341,14 @@ void FlashPredict::produce(art::Event & e)
         else { // this is a shower
       */
 
+      // the collection plane charge of the spacepoints is in fChargePoints
       auto const& spacepoint_ptr_v = pfp_spacepoint_assn_v.at(key);
-      std::vector< art::Ptr<recob::Hit> > hit_ptr_v;
-      // TODO: refactor this loop over spacepoints so that it's not
-      // necessary to query the wire position every time.
-      // There's just two different X wire positions on any given
-      // cryostat for the collection wires.
-      for (size_t sp=0; sp<spacepoint_ptr_v.size(); sp++) {
-        auto SP = spacepoint_ptr_v[sp];
+      for (auto const& SP : spacepoint_ptr_v) {
         auto const& spkey = SP.key();
-        const std::vector< art::Ptr<recob::Hit> > this_hit_ptr_v = spacepoint_hit_assn_v.at( spkey );
-        for (size_t h=0; h<this_hit_ptr_v.size(); h++) {
-          auto hit = this_hit_ptr_v.at( h );
-          // Only use hits from the collection plane
-          geo::WireID wid = hit->WireID();
-          if (geometry->SignalType(wid) != geo::kCollection) continue;
-          // Add the charged point to the vector
-          const auto &position(SP->XYZ());
-          const auto tpcindex = wid.TPC;
-          // throw the charge coming from another TPC
-          if (!isChargeInCryoTPC(position[0], fCryostat, tpcindex, fDetector)) continue;
-          const auto charge(hit->Integral());
-          double Wxyz[3];
-          geometry->WireIDToWireGeo(wid).GetCenter(Wxyz);
-          // xpos is the distance from the wire planes.
-          double xpos = std::abs(position[0] - Wxyz[0]);
-          qClusterInTPC[tpcindex].emplace_back(xpos, position[1], position[2],
-                                               charge * (lar_pandora::LArPandoraHelper::IsTrack(pfp_ptr)
-                                                         ? fChargeToNPhotonsTrack : fChargeToNPhotonsShower));
-        } // for all hits associated to this spacepoint
+        for (size_t c=fSpacePointCharge.at(spkey); c<fSpacePointCharge.at(spkey+1); ++c) {
+          auto const& qp = fChargePoints[c];
+          qClusterInTPC[qp.tpc].emplace_back(qp.x, qp.y, qp.z, qp.q * chargeToNPhotons);
+        }
       } // for all spacepoints
       //      }  // if track or shower
     } // for all pfp pointers
@@ -400,10 +359,7 @@ void FlashPredict::produce(art::Event & e)
       if (!lightInTPC[itpc]) continue;
       double xave = 0.0; double yave = 0.0; double zave = 0.0; double norm = 0.0;
       _charge_q = 0;
-      // TODO: use accumulators instead of this for loop
-      for (size_t i=0; i<qClusterInTPC[itpc].size(); ++i) {
-        flashana::QCluster_t this_cl = qClusterInTPC[itpc];
-        flashana::QPoint_t qp = this_cl[i];
+      for (auto const& qp : qClusterInTPC[itpc]) {
         xave += 0.001 * qp.q * qp.x;
         yave += 0.001 * qp.q * qp.y;
         zave += 0.001 * qp.q * qp.z;
@@ -419,7 +375,7 @@ void FlashPredict::produce(art::Event & e)
       _charge_z = zave / norm;
       // charge[itpc] = _charge_q; //TODO: Use this
 
-      computeFlashMetrics(itpc, OpHitSubset);
+      computeFlashMetrics(itpc, lightBegin, lightEnd);
 
       // calculate match score here, put association on the event
       double slice = _charge_x;
@@ -503,10 +459,49 @@ void FlashPredict::produce(art::Event & e)
 
 }// end of producer module
 
-void FlashPredict::computeFlashMetrics(size_t itpc, std::vector<recob::OpHit> const& OpHitSubset)
+bool FlashPredict::findFlashTime(double& flashTime)
+{
+  // PE of the coated PMTs (all the PMTs for ICARUS) in the cryostat, by
+  // time bin; the hits are sorted by time, so are their bins
+  fTimeBinPE.clear();
+  size_t nEntries = 0;
+  for (auto const& oph : fOpHits) {
+    auto const& pd = opChannel(oph.channel);
+    if (pd.type != opdet::PDType::kPMTCoated) continue; // use only coated PMTs for SBND for flash_time
+    if (!pd.inCryostat) continue;   // use only PMTs in the specified cryostat for ICARUS
+    ++nEntries;
+    // bin numbering of the former TH1 (1 to fNTimeBins, 0 and
+    // fNTimeBins+1 for underflow and overflow)
+    int bin;
+    if (oph.time < fBeamWindowStart) bin = 0;
+    else if (!(oph.time < fBeamWindowEnd)) bin = fNTimeBins + 1;
+    else bin = 1 + int(fNTimeBins * (oph.time - fBeamWindowStart) / (fBeamWindowEnd - fBeamWindowStart));
+    if (bin < 1 || bin > fNTimeBins) continue;
+    if (fTimeBinPE.empty() || fTimeBinPE.back().first != bin) fTimeBinPE.emplace_back(bin, 0.);
+    fTimeBinPE.back().second += fPEscale * oph.pe;
+  }
+  if (nEntries == 0) return false;
+
+  // earliest bin with the largest PE
+  double integral = 0.;
+  double maxPE = 0.;
+  int maxBin = 0;
+  for (auto const& binPE : fTimeBinPE) {
+    integral += binPE.second;
+    if (maxBin == 0 || binPE.second > maxPE) {
+      maxPE = binPE.second;
+      maxBin = binPE.first;
+    }
+  }
+  if (integral < fMinFlashPE) return false;
+
+  flashTime = fBeamWindowStart + maxBin * fTimeBinWidth; // in us
+  return true;
+}
+
+void FlashPredict::computeFlashMetrics(size_t itpc, LiteOpHitIt begin, LiteOpHitIt end)
 {
   // store PMT photon counts in the tree as well
-  double PMTxyz[3];
   double unpe_tot = 0;
   double pnorm = 0;
   double sum =    0;
@@ -515,39 +510,37 @@ void FlashPredict::computeFlashMetrics(size_t itpc, std::vector<recob::OpHit> co
   double sum_By = 0; double sum_Bz = 0;
   double sum_Cy = 0; double sum_Cz = 0;
   double sum_D =  0;
-  // TODO: change this next loop, such that it only loops
-  // through channels in the current fCryostat
-  for(auto const& oph : OpHitSubset) {
-    std::string op_type = "pmt"; // the label ICARUS has
-    if (fDetector == "SBND") op_type = pdMap.pdType(oph.OpChannel());
-    geometry->OpDetGeoFromOpChannel(oph.OpChannel()).GetCenter(PMTxyz);
+  for(auto oph = begin; oph != end; ++oph) {
+    auto const& pd = opChannel(oph->channel);
+    const opdet::PDType op_type = pd.type;
     // check cryostat and tpc
-    if (!isPDInCryoTPC(PMTxyz[0], fCryostat, itpc, fDetector)) continue;
+    if (pd.tpc != (int)itpc) continue;
     // only use PMTs for SBND
-    if (op_type == "pmt_coated" || op_type == "pmt") {
+    if (op_type == opdet::PDType::kPMTCoated) {
       // Add up the position, weighting with PEs
-      _flash_x = PMTxyz[0];
+      const double pe = oph->pe;
+      _flash_x = pd.x;
       sum     += 1.0;
-      pnorm   += oph.PE();
-      sumy    += oph.PE() * PMTxyz[1];
-      sumz    += oph.PE() * PMTxyz[2];
-      sum_By  += PMTxyz[1];
-      sum_Bz  += PMTxyz[2];
-      sum_Ay  += oph.PE() * PMTxyz[1] * oph.PE() * PMTxyz[1];
-      sum_Az  += oph.PE() * PMTxyz[2] * oph.PE() * PMTxyz[2];
-      sum_D   += oph.PE() * oph.PE();
-      sum_Cy  += oph.PE() * oph.PE() * PMTxyz[1];
-      sum_Cz  += oph.PE() * oph.PE() * PMTxyz[2];
+      pnorm   += pe;
+      sumy    += pe * pd.y;
+      sumz    += pe * pd.z;
+      sum_By  += pd.y;
+      sum_Bz  += pd.z;
+      sum_Ay  += pe * pd.y * pe * pd.y;
+      sum_Az  += pe * pd.z * pe * pd.z;
+      sum_D   += pe * pe;
+      sum_Cy  += pe * pe * pd.y;
+      sum_Cz  += pe * pe * pd.z;
     }
-    else if ( op_type == "pmt_uncoated") {
-      unpe_tot += oph.PE();
+    else if ( op_type == opdet::PDType::kPMTUncoated) {
+      unpe_tot += oph->pe;
     }
-    else if ( (op_type == "arapuca_vuv" || op_type == "arapuca_vis") ) {
+    else if ( (op_type == opdet::PDType::kArapucaVUV || op_type == opdet::PDType::kArapucaVIS) ) {
       //TODO: Use ARAPUCA
       // arape_tot+=oph.PE();
       continue;
     }
-    else if ( op_type == "xarapuca_vuv" || op_type == "xarapuca_vis")  {
+    else if ( op_type == opdet::PDType::kXArapucaVUV || op_type == opdet::PDType::kXArapucaVIS)  {
       //TODO: Use XARAPUCA
       // xarape_tot+=oph.PE();
       continue;
@@ -571,7 +564,7 @@ void FlashPredict::computeFlashMetrics(size_t itpc, std::vector<recob::OpHit> co
   else {
     mf::LogWarning("FlashPredict") << "Really odd that I landed here, this shouldn't had happen.\n"
                                    << "pnorm:\t" << pnorm << "\n"
-                                   << "OpHitSubset.size():\t" << OpHitSubset.size() << "\n";
+                                   << "Hits in light window:\t" << std::distance(begin, end) << "\n";
     _flash_y = 0;
     _flash_z = 0;
     _flash_r = 0;
@@ -687,15 +680,9 @@ void FlashPredict::AddDaughters(
 
 // TODO: no hardcoding
 // TODO: collapse with the next
-bool FlashPredict::isPDInCryoTPC(double pd_x, int icryo, size_t itpc, std::string detector)
+bool FlashPredict::isPDInCryoTPC(double pd_x, int icryo, size_t itpc, std::string const& detector) const
 {
   // check whether this optical detector views the light inside this tpc.
-  std::ostringstream lostPDMessage;
-  lostPDMessage << "\nThere's an " << detector << "photo detector that belongs nowhere. \n"
-                << "icryo: " << icryo << "\n"
-                << "itpc:  " << itpc <<  "\n"
-                << "pd_x:  " << pd_x <<  std::endl;
-
   if (detector == "ICARUS") {
     if (icryo == 0) {
       if (itpc == 0 && -400 < pd_x && pd_x < -300 ) return true;
@@ -718,26 +705,102 @@ bool FlashPredict::isPDInCryoTPC(double pd_x, int icryo, size_t itpc, std::strin
   return false;
 }
 
-bool FlashPredict::isPDInCryoTPC(int pdChannel, int icryo, size_t itpc, std::string detector)
+void FlashPredict::fillOpChannelTable()
 {
-  // check whether this optical detector views the light inside this tpc.
-  double dummy[3];
-  geometry->OpDetGeoFromOpChannel(pdChannel).GetCenter(dummy);
-  double pd_x = dummy[0];
-  return isPDInCryoTPC(pd_x, icryo, itpc, detector);
+  geo::CryostatGeo const& geo_cryo = geometry->Cryostat(fCryostat);
+  fOpChannels.assign(geometry->MaxOpChannel(), OpChannelInfo{});
+  for (unsigned int ch=0; ch<fOpChannels.size(); ++ch) {
+    auto& pd = fOpChannels[ch];
+    // ICARUS has only PMTs, all used as the SBND coated ones
+    pd.type = (fPDTypes)? fPDTypes->type(ch): opdet::PDType::kPMTCoated;
+    if (!geometry->IsValidOpChannel(ch)) continue;
+    pd.valid = true;
+    double PMTxyz[3];
+    geometry->OpDetGeoFromOpChannel(ch).GetCenter(PMTxyz);
+    pd.x = PMTxyz[0];
+    pd.y = PMTxyz[1];
+    pd.z = PMTxyz[2];
+    pd.inCryostat = geo_cryo.ContainsPosition(PMTxyz);
+    for (size_t t=0; t<nMaxTPCs; t++) {
+      if (isPDInCryoTPC(pd.x, fCryostat, t, fDetector)) {
+        pd.tpc = t;
+        break;
+      }
+    }
+  }
+}
+
+void FlashPredict::fillWirePlaneTable()
+{
+  fMaxTPCs = geometry->MaxTPCs();
+  fMaxPlanes = geometry->MaxPlanes();
+  fWirePlanes.assign(geometry->Ncryostats() * fMaxTPCs * fMaxPlanes, WirePlaneInfo{});
+  for (unsigned int c=0; c<geometry->Ncryostats(); ++c) {
+    for (unsigned int t=0; t<geometry->NTPC(c); ++t) {
+      for (unsigned int pl=0; pl<geometry->Nplanes(t, c); ++pl) {
+        const geo::PlaneID pid(c, t, pl);
+        auto& plane = fWirePlanes[(c * fMaxTPCs + t) * fMaxPlanes + pl];
+        plane.collection = (geometry->SignalType(pid) == geo::kCollection);
+        if (!plane.collection) continue;
+        plane.wireX.resize(geometry->Nwires(pid));
+        for (unsigned int w=0; w<plane.wireX.size(); ++w) {
+          double Wxyz[3];
+          geometry->WireIDToWireGeo(geo::WireID(pid, w)).GetCenter(Wxyz);
+          plane.wireX[w] = Wxyz[0];
+        }
+      }
+    }
+  }
+}
+
+FlashPredict::WirePlaneInfo const& FlashPredict::wirePlane(geo::PlaneID const& pid) const
+{
+  const size_t index = (pid.Cryostat * fMaxTPCs + pid.TPC) * fMaxPlanes + pid.Plane;
+  if (pid.TPC >= fMaxTPCs || pid.Plane >= fMaxPlanes || index >= fWirePlanes.size()) {
+    throw cet::exception("FlashPredict") << "Wire plane " << pid
+                                         << " is not in the geometry.\n";
+  }
+  return fWirePlanes[index];
+}
+
+void FlashPredict::fillChargeIndex(std::vector<recob::SpacePoint> const& spacepoints,
+                                   art::FindManyP<recob::Hit> const& spacepoint_hit_assn_v)
+{
+  fSpacePointCharge.assign(1, 0);
+  fSpacePointCharge.reserve(spacepoints.size() + 1);
+  fChargePoints.clear();
+  for (size_t sp=0; sp<spacepoints.size(); sp++) {
+    const auto &position(spacepoints[sp].XYZ());
+    for (auto const& hit : spacepoint_hit_assn_v.at(sp)) {
+      // Only use hits from the collection plane
+      geo::WireID wid = hit->WireID();
+      auto const& plane = wirePlane(wid);
+      if (!plane.collection) continue;
+      const auto tpcindex = wid.TPC;
+      // throw the charge coming from another TPC
+      if (!isChargeInCryoTPC(position[0], fCryostat, tpcindex, fDetector)) continue;
+      // xpos is the distance from the wire planes.
+      double xpos = std::abs(position[0] - plane.wireX.at(wid.Wire));
+      fChargePoints.push_back({ tpcindex, xpos, position[1], position[2], hit->Integral() });
+    } // for all hits associated to this spacepoint
+    fSpacePointCharge.push_back(fChargePoints.size());
+  } // for all spacepoints
+}
+
+FlashPredict::OpChannelInfo const& FlashPredict::opChannel(unsigned int ch) const
+{
+  if (ch >= fOpChannels.size() || !fOpChannels[ch].valid) {
+    throw cet::exception("FlashPredict") << "Optical channel " << ch
+                                         << " is not in the geometry.\n";
+  }
+  return fOpChannels[ch];
 }
 
 // TODO: no hardcoding
 // TODO: collapse with the previous
 // TODO: figure out what to do with the charge that falls into the crevices
-bool FlashPredict::isChargeInCryoTPC(double qp_x, int icryo, int itpc, std::string detector)
+bool FlashPredict::isChargeInCryoTPC(double qp_x, int icryo, int itpc, std::string const& detector) const
 {
-  std::ostringstream lostChargeMessage;
-  lostChargeMessage << "\nThere's " << detector << " charge that belongs nowhere. \n"
-                    << "icryo: " << icryo << "\n"
-                    << "itpc: "  << itpc << "\n"
-                    << "qp_x: " << qp_x << std::endl;
-
   if (detector == "ICARUS") {
     if (icryo == 0) {
       if (itpc == 0 && -368.49 <= qp_x && qp_x <= -220.29 ) return true;
@@ -762,11 +825,8 @@ bool FlashPredict::isChargeInCryoTPC(double qp_x, int icryo, int itpc, std::stri
 
 void FlashPredict::beginJob()
 {
-  // Implementation of optional member function here.
-
-
-
-
+  fillOpChannelTable();
+  fillWirePlaneTable();
 }
 
 void FlashPredict::endJob()
@@ -12,10 +12,37 @@
 #include "messagefacility/MessageLogger/MessageLogger.h"
 #include "art_root_io/TFileService.h"
 #include "larcore/Geometry/Geometry.h"
+#include "larcore/CoreUtils/ServiceUtil.h"
+#include "sbndcode/OpDetSim/PDTypeTableServiceSBND.h"
 #include "FlashFinderFMWKInterface.h"
+#include <mutex>
 
 namespace lightana {
 
+  namespace {
+    std::mutex _geo_cache_mutex;
+    std::shared_ptr<const OpDetGeoCache> _geo_cache;
+
+    std::shared_ptr<const OpDetGeoCache> MakeOpDetGeoCache() {
+      opdet::sbndPDTypeTable const* pd_types = nullptr;
+      if(::art::ServiceRegistry::isAvailable<opdet::PDTypeTableServiceSBND>())
+        pd_types = lar::providerFrom<opdet::PDTypeTableServiceSBND>();
+      return std::make_shared<const OpDetGeoCache>(*lar::providerFrom<geo::Geometry>(), pd_types);
+    }
+  }
+
+  std::shared_ptr<const OpDetGeoCache> GetOpDetGeoCache() {
+    std::lock_guard<std::mutex> lock(_geo_cache_mutex);
+    if(!_geo_cache) _geo_cache = MakeOpDetGeoCache();
+    return _geo_cache;
+  }
+
+  void UpdateOpDetGeoCache() {
+    auto geo_cache = MakeOpDetGeoCache();
+    std::lock_guard<std::mutex> lock(_geo_cache_mutex);
+    _geo_cache = std::move(geo_cache);
+  }
+
   std::vector<size_t> ListOpChannels(int cryostat) {
     std::vector<size_t> res;
     ::art::ServiceHandle<geo::Geometry> geo;
@@ -71,19 +98,8 @@ namespace lightana {
         res.push_back(opch);
       }
     }else{
-      // auto const& bbox = geo->TPC(tpc).BoundingBox();
-      for(size_t opch=0; opch<geo->MaxOpChannel(); ++opch) {
-        if(!geo->IsValidOpChannel(opch)) continue;
-        auto const& pt = geo->OpDetGeoFromOpChannel(opch).GetCenter();
-        // std::cout << "pt: " << pt.X() << ", " << pt.Y() << ", " << pt.Z() << std::endl;
-        // if(!bbox.ContainsPosition(pt)) continue;
-        if(pt.X() < 0 && tpc == 0) {   
-          res.push_back(opch);
-        }
-        if(pt.X() > 0 && tpc == 1) {   
-          res.push_back(opch);
-        }
-      }
+      auto const& opch_v = GetOpDetGeoCache()->OpChannelsByTPC(tpc);
+      res.assign(opch_v.begin(), opch_v.end());
     }
     return res;
   }
@@ -104,13 +120,12 @@ namespace lightana {
   }
 
   size_t OpDetFromOpChannel(size_t opch) {
-    ::art::ServiceHandle<geo::Geometry> geo;
-    return geo->OpDetFromOpChannel(opch);
+    return GetOpDetGeoCache()->OpChannel(opch).opdet;
   }
 
   void OpDetCenterFromOpChannel(size_t opch, double *xyz) {
-    ::art::ServiceHandle<geo::Geometry> geo;
-    geo->OpDetGeoFromOpChannel(opch).GetCenter(xyz); 
+    auto const& center = GetOpDetGeoCache()->OpChannel(opch).center;
+    xyz[0] = center[0]; xyz[1] = center[1]; xyz[2] = center[2];
   }
 
 }
@@ -5,6 +5,8 @@
 #include "fhiclcpp/ParameterSet.h"
 #include "larcore/Geometry/Geometry.h"
 #include "sbndcode/OpDetSim/sbndPDMapAlg.hh"
+#include "OpDetGeoCache.h"
+#include <memory>
 #include <stdlib.h>
 
 namespace lightana {
@@ -26,6 +28,13 @@ namespace lightana {
 
   void OpDetCenterFromOpChannel(size_t opch, double *xyz);
 
+  /// Optical geometry of the job, built from the geometry on first use;
+  /// hold the returned pointer for the duration of the computation
+  std::shared_ptr<const OpDetGeoCache> GetOpDetGeoCache();
+
+  /// Rebuild the optical geometry from the current geometry (e.g. at beginRun)
+  void UpdateOpDetGeoCache();
+
 }
 #endif
 
@@ -0,0 +1,63 @@
+#ifndef OPDETGEOCACHE_CXX
+#define OPDETGEOCACHE_CXX
+
+#include "OpDetGeoCache.h"
+#include "larcorealg/Geometry/GeometryCore.h"
+#include "larcorealg/Geometry/OpDetGeo.h"
+#include <iostream>
+
+namespace lightana {
+
+  OpDetGeoCache::OpDetGeoCache(geo::GeometryCore const& geom,
+                               opdet::sbndPDTypeTable const* pd_types)
+    : _tpc_opch_v(2)
+  {
+    size_t const nopch = geom.MaxOpChannel();
+    _opch_v.resize(nopch);
+    _center_y_v.resize(nopch, 0.);
+    _center_z_v.resize(nopch, 0.);
+
+    for(size_t opch=0; opch<nopch; ++opch) {
+      auto& info = _opch_v[opch];
+      if(pd_types) info.pd_type = pd_types->type(opch);
+      if(!geom.IsValidOpChannel(opch)) continue;
+
+      info.valid = true;
+      info.opdet = geom.OpDetFromOpChannel(opch);
+      geom.OpDetGeoFromOpChannel(opch).GetCenter(info.center);
+      _center_y_v[opch] = info.center[1];
+      _center_z_v[opch] = info.center[2];
+
+      // the detectors sit behind the anode planes, facing the cathode at x = 0
+      if(info.center[0] < 0) {
+        info.tpc = 0;
+        info.normal[0] = 1.;
+      }
+      else if(info.center[0] > 0) {
+        info.tpc = 1;
+        info.normal[0] = -1.;
+      }
+      if(info.tpc >= 0) _tpc_opch_v[info.tpc].push_back(opch);
+    }
+  }
+
+  const OpChannelGeo_t& OpDetGeoCache::OpChannel(size_t opch) const
+  {
+    if(opch >= _opch_v.size()) {
+      std::cerr << "OpChannel " << opch << " is out of the optical geometry ("
+                << _opch_v.size() << " channels)!" << std::endl;
+      throw std::exception();
+    }
+    return _opch_v[opch];
+  }
+
+  const std::vector<size_t>& OpDetGeoCache::OpChannelsByTPC(int tpc) const
+  {
+    static const std::vector<size_t> empty;
+    if(tpc < 0 || tpc >= (int)(_tpc_opch_v.size())) return empty;
+    return _tpc_opch_v[tpc];
+  }
+
+}
+
+#endif
@@ -0,0 +1,74 @@
+/**
+ * \file OpDetGeoCache.h
+ *
+ * \brief Class def header for a class OpDetGeoCache
+ *
+ * Channel-indexed table of the optical detector geometry used by the flash
+ * finder (center, opdet, TPC, PD type, normal), read once from the geometry
+ * so that per-flash computations are array lookups and reductions.
+ *
+ * The table is immutable: it is shared (see GetOpDetGeoCache() in
+ * FlashFinderFMWKInterface.h) and rebuilt, not modified, when the geometry
+ * may have changed.
+ */
+#ifndef OPDETGEOCACHE_H
+#define OPDETGEOCACHE_H
+
+#include <vector>
+#include "sbndcode/OpDetSim/sbndPDTypeTable.hh"
+
+namespace geo {
+  class GeometryCore;
+}
+
+namespace lightana {
+
+  struct OpChannelGeo_t {
+    bool   valid;        ///< the channel is in the geometry
+    size_t opdet;        ///< optical detector of the channel
+    double center[3];    ///< center of the optical detector [cm]
+    double normal[3];    ///< unit vector towards the cathode (null if no TPC)
+    int    tpc;          ///< TPC the detector faces: 0 for x < 0, 1 for x > 0, -1 otherwise
+    opdet::PDType pd_type;
+    OpChannelGeo_t() : valid(false), opdet(0),
+                       center{0.,0.,0.}, normal{0.,0.,0.},
+                       tpc(-1), pd_type(opdet::PDType::kUnknown)
+    {}
+  };
+
+  /**
+     \class OpDetGeoCache
+     Optical detector geometry of the channels [0, MaxOpChannel).
+     The PD types are left unknown if no type table is given.
+  */
+  class OpDetGeoCache {
+
+  public:
+
+    OpDetGeoCache(geo::GeometryCore const& geom,
+                  opdet::sbndPDTypeTable const* pd_types = nullptr);
+
+    size_t NOpChannels() const { return _opch_v.size(); }
+
+    /// Geometry of the channel opch (throws if out of range)
+    const OpChannelGeo_t& OpChannel(size_t opch) const;
+
+    /// Valid channels facing the TPC tpc, in increasing order
+    const std::vector<size_t>& OpChannelsByTPC(int tpc) const;
+
+    /// Center coordinates of all the channels, for reductions over
+    /// channel-indexed arrays (0 for the channels not in the geometry)
+    const std::vector<double>& CenterY() const { return _center_y_v; }
+    const std::vector<double>& CenterZ() const { return _center_z_v; }
+
+  private:
+
+    std::vector<OpChannelGeo_t> _opch_v;
+    std::vector<std::vector<size_t> > _tpc_opch_v;  // channels of TPC 0 and 1
+    std::vector<double> _center_y_v;
+    std::vector<double> _center_z_v;
+
+  };
+}
+#endif
+/** @} */ // end of doxygen group
@@ -4,6 +4,7 @@
 #include "SimpleFlashAlgo.h"
 #include <set>
 #include <algorithm>
+#include <iterator>
 
 namespace lightana{
     
@@ -11,6 +12,7 @@ namespace lightana{
     
     SimpleFlashAlgo::SimpleFlashAlgo(const std::string name)
     : FlashAlgoBase(name)
+    , _nbins(0)
     {}
     
     void SimpleFlashAlgo::Configure(const Config_t &p)
@@ -124,16 +126,25 @@ namespace lightana{
     SimpleFlashAlgo::~SimpleFlashAlgo()
     {}
     
+    std::vector<SimpleFlashAlgo::TimeBin_t>::const_iterator SimpleFlashAlgo::FirstBin(size_t bin) const
+    {
+        return std::lower_bound(_bin_v.begin(), _bin_v.end(), bin,
+                                [](TimeBin_t const& b, size_t t) { return b.bin < t; });
+    }
+
+    std::vector<double> SimpleFlashAlgo::PESumArray() const
+    {
+        std::vector<double> pesum_v(_nbins, 0);
+        for(auto const& b : _bin_v) pesum_v[b.bin] = b.pe;
+        return pesum_v;
+    }
+    
     LiteOpFlashArray_t SimpleFlashAlgo::RecoFlash(const LiteOpHitArray_t ophits) {
         
         Reset();
         size_t max_ch = _opch_to_index_v.size() - 1;
         size_t NOpDet = _index_to_opch_v.size();
         
-        //static std::vector<double> pesum_v;
-        static std::vector<double> mult_v;  //< this is not strictly a multiplicity of PMTs, but multiplicity of hits
-        static std::vector<std::vector<double> > pespec_v;
-        static std::vector<std::vector<unsigned int> > hitidx_v;
         double min_time=1.1e20;
         double max_time=1.1e20;
         for(auto const& oph : ophits) {
@@ -145,19 +156,10 @@ namespace lightana{
         if(_debug)
             std::cout << "T span: " << min_time << " => " << max_time << " ... " << (size_t)((max_time - min_time) / _time_res) << std::endl;
         
-        size_t nbins_pesum_v = (size_t)((max_time - min_time) / _time_res) + 1;
-        if(_pesum_v.size() < nbins_pesum_v) _pesum_v.resize(nbins_pesum_v,0);
-        if(mult_v.size()   < nbins_pesum_v) mult_v.resize(nbins_pesum_v,0);
-        if(pespec_v.size() < nbins_pesum_v) pespec_v.resize(nbins_pesum_v,std::vector<double>(NOpDet));
-        if(hitidx_v.size() < nbins_pesum_v) hitidx_v.resize(nbins_pesum_v,std::vector<unsigned int>());
-        for(size_t i=0; i<_pesum_v.size(); ++i) {
-            _pesum_v[i] = 0;
-            mult_v[i]  = 0;
-            hitidx_v[i].clear();
-            for(auto& v : pespec_v[i]) v=0;
-        }
+        _nbins = (size_t)((max_time - min_time) / _time_res) + 1;
         
-        // Fill _pesum_v
+        // Collect the used hits, ordered by time bin (and by hit index within a bin)
+        _hit_v.clear();
         for(size_t hitidx = 0; hitidx < ophits.size(); ++hitidx) {
             auto const& oph = ophits[hitidx];
             if(oph.channel > max_ch || _opch_to_index_v[oph.channel] < 0) {
@@ -169,81 +171,96 @@ namespace lightana{
                 continue;
             }
             size_t index = (size_t)((oph.peak_time - min_time) / _time_res);
-            // std::cout << "Ophit from ch " << oph.channel << " at time " << oph.peak_time << " with PE " << oph.pe << ", index " << index << std::endl;
-            _pesum_v[index] += oph.pe;
-            mult_v[index] += 1;
-            pespec_v[index][_opch_to_index_v[oph.channel]] += oph.pe;
-            hitidx_v[index].push_back(hitidx);
+            _hit_v.emplace_back(index, hitidx);
         }
+        std::sort(_hit_v.begin(), _hit_v.end());
         
-        // Order by pe (above threshold)
-        std::map<double,size_t> pesum_idx_map;
-        for(size_t idx=0; idx<nbins_pesum_v; ++idx) {
-            // std::cout <<  "    _pesum_v at " << idx << " is " << _pesum_v[idx] << ", _min_pe_coinc is " << _min_pe_coinc << std::endl;
-            if(_pesum_v[idx] < _min_pe_coinc   ) continue;
-            // std::cout <<  "    mult_v at " << idx << " is " << mult_v[idx] << ", _min_mult_coinc is " << _min_mult_coinc << std::endl;
-            if(mult_v[idx]  < _min_mult_coinc ) continue;
-            pesum_idx_map[1./(_pesum_v[idx])] = idx;
+        // PE sum and multiplicity of the occupied time bins
+        _bin_v.clear();
+        for(size_t i = 0; i < _hit_v.size(); ++i) {
+            auto const index = _hit_v[i].first;
+            if(_bin_v.empty() || _bin_v.back().bin != index)
+                _bin_v.push_back(TimeBin_t{index, 0., 0, i, i});
+            auto& b = _bin_v.back();
+            b.pe += ophits[_hit_v[i].second].pe;
+            b.mult += 1;
+            b.last_hit = i + 1;
         }
         
+        // Order by pe (above threshold): largest PE first; among time bins
+        // with the same 1/PE key only the latest one is a candidate
+        auto const later_key = [](Candidate_t const& a, Candidate_t const& b)
+            { return (a.key != b.key) ? (a.key > b.key) : (a.bin < b.bin); };
+        _candidate_v.clear();
+        for(auto const& b : _bin_v) {
+            if(b.pe   < _min_pe_coinc   ) continue;
+            if(b.mult < _min_mult_coinc ) continue;
+            _candidate_v.push_back(Candidate_t{1./(b.pe), b.bin});
+        }
+        if(0. >= _min_pe_coinc && 0. >= _min_mult_coinc) {
+            // empty time bins are candidates too: the latest one stands for all
+            size_t bin = _nbins;
+            for(auto b = _bin_v.rbegin(); b != _bin_v.rend() && b->bin + 1 == bin; ++b) bin = b->bin;
+            if(bin > 0) _candidate_v.push_back(Candidate_t{1./0., bin - 1});
+        }
+        std::make_heap(_candidate_v.begin(), _candidate_v.end(), later_key);
+        
         // Get candidate flash times
-        std::vector<std::pair<size_t,size_t> > flash_period_v;
-        std::vector<size_t> flash_time_v;
+        _flash_start_v.clear();
+        _flash_period_v.clear();
+        _flash_time_v.clear();
         size_t veto_ctr = (size_t)(_veto_time / _time_res);
         size_t default_integral_ctr = (size_t)(_integral_time / _time_res);
         size_t precount = (size_t)(_pre_sample / _time_res);
-        flash_period_v.reserve(pesum_idx_map.size());
-        flash_time_v.reserve(pesum_idx_map.size());
         
         double sum_baseline = 0;
         //for(auto const& v : _pe_baseline_v) sum_baseline += v;
 
-        for(auto const& pe_idx : pesum_idx_map) {
-                        
-          //auto const& pe  = 1./(pe_idx.first);
-            auto const& idx = pe_idx.second;
+        bool first_candidate = true;
+        double last_key = 0;
+        while(!_candidate_v.empty()) {
+            
+            std::pop_heap(_candidate_v.begin(), _candidate_v.end(), later_key);
+            auto const cand = _candidate_v.back();
+            _candidate_v.pop_back();
+            if(!first_candidate && cand.key == last_key) continue;
+            first_candidate = false;
+            last_key = cand.key;
+            
+            auto const& idx = cand.bin;
             
             size_t start_time = idx;
             if(start_time < precount) start_time = 0;
             else start_time = idx - precount;
             
-            // see if this idx can be used
-            bool skip=false;
-            size_t integral_ctr = default_integral_ctr;
-            for(auto const& used_period : flash_period_v) {
-                if( start_time <= used_period.first && (start_time + veto_ctr) > used_period.first ) {
-                    skip=true;
-                    break;
-                }
-                if( used_period.first <= start_time && start_time < (used_period.first + veto_ctr) ) {
-                    skip=true;
-                    break;
-                }
-                if( used_period.first >= start_time && used_period.first < (start_time + integral_ctr) ) {
-                    if(_debug) std::cout << "Truncating flash @ " << start_time
-                        << " (previous flash @ " << used_period.first
-                        << ") ... integral ctr change: " << integral_ctr
-                        << " => " << used_period.first - start_time << std::endl;
-                    
-                    integral_ctr = used_period.first - start_time;
-                }
-                if(_debug) {
-                    std::cout << "Flash @ " << min_time + used_period.first * _time_res
-                    << " => " << min_time + (used_period.first + used_period.second) * _time_res
-                    << " does not interfare with THIS flash @ " << min_time + start_time * _time_res
-                    << " => " << min_time + (start_time + integral_ctr) * _time_res << std::endl;
-                }
-            }
-            if(skip) {
-                if(_debug) std::cout << "Skipping a candidate @ " << min_time + start_time * _time_res << " as it is in a veto window!" <<std::endl;
+            // see if this idx can be used: no claimed flash may start
+            // within the veto window around it
+            auto used_start = std::lower_bound(_flash_start_v.begin(), _flash_start_v.end(),
+                                               (start_time + 1 > veto_ctr) ? (start_time + 1 - veto_ctr) : 0);
+            if(used_start != _flash_start_v.end() && veto_ctr > 0 && *used_start < start_time + veto_ctr) {
+                if(_debug) std::cout << "Skipping a candidate @ " << min_time + start_time * _time_res
+                    << " as it is in a veto window of the flash @ " << min_time + (*used_start) * _time_res << std::endl;
                 continue;
             }
             
+            // stop the integral at the next claimed flash (which may start at
+            // start_time itself, before used_start, when there is no veto)
+            size_t integral_ctr = default_integral_ctr;
+            used_start = std::lower_bound(_flash_start_v.begin(), _flash_start_v.end(), start_time);
+            if(used_start != _flash_start_v.end() && *used_start < start_time + integral_ctr) {
+                if(_debug) std::cout << "Truncating flash @ " << start_time
+                    << " (previous flash @ " << *used_start
+                    << ") ... integral ctr change: " << integral_ctr
+                    << " => " << *used_start - start_time << std::endl;
+                
+                integral_ctr = *used_start - start_time;
+            }
+            
             // See if this flash is declarable
             double pesum = 0;
-            for(size_t i=start_time; i<std::min(nbins_pesum_v,(start_time+integral_ctr)); ++i)
+            for(auto b = FirstBin(start_time); b != _bin_v.end() && b->bin < start_time + integral_ctr; ++b)
                 
-                pesum += _pesum_v[i];
+                pesum += b->pe;
             
             if(pesum < (_min_pe_flash + sum_baseline)) {
                 if(_debug) std::cout << "Skipping a candidate @ " << start_time  << " => " << start_time + integral_ctr
@@ -252,24 +269,40 @@ namespace lightana{
                 continue;
             }
             
-            flash_period_v.push_back(std::pair<size_t,size_t>(start_time,integral_ctr));
-            flash_time_v.push_back(idx);
+            _flash_start_v.insert(std::upper_bound(_flash_start_v.begin(), _flash_start_v.end(), start_time), start_time);
+            _flash_period_v.push_back(std::pair<size_t,size_t>(start_time,integral_ctr));
+            _flash_time_v.push_back(idx);
         }
         
         // Construct flash
         LiteOpFlashArray_t res;
-        for(size_t flash_idx=0; flash_idx<flash_period_v.size(); ++flash_idx) {
+        res.reserve(_flash_period_v.size());
+        _opdet_pe_v.assign(NOpDet, 0);
+        for(size_t flash_idx=0; flash_idx<_flash_period_v.size(); ++flash_idx) {
+            
+            auto const& start  = _flash_period_v[flash_idx].first;
+            auto const& period = _flash_period_v[flash_idx].second;
+            auto const& time   = _flash_time_v[flash_idx];
             
-            auto const& start  = flash_period_v[flash_idx].first;
-            auto const& period = flash_period_v[flash_idx].second;
-            auto const& time   = flash_time_v[flash_idx];
+            auto const first_bin = FirstBin(start);
+            auto last_bin = first_bin;
+            while(last_bin != _bin_v.end() && last_bin->bin < start + period) ++last_bin;
             
+            // opdet PE summed bin by bin
             std::vector<double> pe_v(max_ch+1,0);
-            for(size_t index=start; index<(start+period) && index<pespec_v.size(); ++index) {
+            for(auto b = first_bin; b != last_bin; ++b) {
                 
-                for(size_t pmt_index=0; pmt_index<NOpDet; ++pmt_index)
-                    
-                    pe_v[_index_to_opch_v[pmt_index]] += pespec_v[index][pmt_index];
+                _opdet_touched_v.clear();
+                for(size_t i = b->first_hit; i < b->last_hit; ++i) {
+                    auto const& oph = ophits[_hit_v[i].second];
+                    size_t const pmt_index = _opch_to_index_v[oph.channel];
+                    if(_opdet_pe_v[pmt_index] == 0) _opdet_touched_v.push_back(pmt_index);
+                    _opdet_pe_v[pmt_index] += oph.pe;
+                }
+                for(auto const& pmt_index : _opdet_touched_v) {
+                    pe_v[_index_to_opch_v[pmt_index]] += _opdet_pe_v[pmt_index];
+                    _opdet_pe_v[pmt_index] = 0;
+                }
                 
             }
             
@@ -284,9 +317,10 @@ namespace lightana{
             }
             
             std::vector<unsigned int> asshit_v;
-            for(size_t index=start; index<(start+period) && index<pespec_v.size(); ++index) {
-                for(auto const& idx : hitidx_v[index])
-                    asshit_v.push_back(idx);
+            if(first_bin != last_bin) {
+                asshit_v.reserve(std::prev(last_bin)->last_hit - first_bin->first_hit);
+                for(size_t i = first_bin->first_hit; i < std::prev(last_bin)->last_hit; ++i)
+                    asshit_v.push_back(_hit_v[i].second);
             }
             
             if(_debug) {
@@ -310,5 +344,3 @@ namespace lightana{
     
 }
 #endif
-
-
@@ -4,6 +4,7 @@
 #include "FlashAlgoBase.h"
 #include "FlashAlgoFactory.h"
 #include <map>
+#include <vector>
 
 namespace lightana
 {
@@ -22,7 +23,8 @@ namespace lightana
 
     bool Veto(double t) const;
 
-    const std::vector<double>& PESumArray() const { return _pesum_v; }
+    /// PE sum of each time bin of the last RecoFlash call (dense, built on request)
+    std::vector<double> PESumArray() const;
 
     const double TimeRes() const { return _time_res; }
 
@@ -37,7 +39,6 @@ namespace lightana
     double _time_res;       // time resolution of pe sum
     double _pre_sample;     // time pre-sample
 
-    std::vector<double> _pesum_v;        // pw aum array
     std::vector<double> _pe_baseline_v;  // calibration: PEs to be subtracted from each opdet
 
     std::map<double,double> _flash_veto_range_m;  // veto window start
@@ -47,7 +48,35 @@ namespace lightana
     // list of opchannel to use
     std::vector<int> _opch_to_index_v;
     std::vector<int> _index_to_opch_v;
-                             
+
+    //
+    // Scratch of RecoFlash, owned by the instance (no static state) and
+    // reused across calls: only the occupied time bins are stored.
+    //
+    struct TimeBin_t {
+      size_t bin;        // time bin index
+      double pe;         // PE sum of the bin
+      size_t mult;       // number of hits in the bin
+      size_t first_hit;  // range of the bin in _hit_v
+      size_t last_hit;
+    };
+    struct Candidate_t {
+      double key;        // 1/PE, the candidate ordering key
+      size_t bin;
+    };
+    size_t _nbins;                                  // time bins of the last call
+    std::vector<std::pair<size_t,unsigned int> > _hit_v; // (time bin, hit index) of the used hits, sorted
+    std::vector<TimeBin_t>   _bin_v;                // occupied time bins, sorted
+    std::vector<Candidate_t> _candidate_v;          // heap of the flash candidates
+    std::vector<size_t>      _flash_start_v;        // start of the claimed flashes, sorted
+    std::vector<std::pair<size_t,size_t> > _flash_period_v; // (start, length) of the claimed flashes
+    std::vector<size_t>      _flash_time_v;         // time bin of the claimed flashes
+    std::vector<double>      _opdet_pe_v;           // PE of each opdet within a time bin
+    std::vector<size_t>      _opdet_touched_v;      // opdet index with PE in _opdet_pe_v
+
+    /// Iterator to the first occupied time bin not before bin
+    std::vector<TimeBin_t>::const_iterator FirstBin(size_t bin) const;
+
   };
 
   /**
@@ -12,14 +12,16 @@
 #include "art/Framework/Principal/Handle.h"
 #include "art/Framework/Principal/Run.h"
 #include "art/Framework/Principal/SubRun.h"
+#include "art/Persistency/Common/PtrMaker.h"
 #include "canvas/Utilities/InputTag.h"
 #include "fhiclcpp/ParameterSet.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 
 #include "lardataobj/RecoBase/OpHit.h"
 #include "lardataobj/RecoBase/OpFlash.h"
-#include "lardata/Utilities/AssociationUtil.h"
+#include "cetlib_except/exception.h"
 
+#include <cmath>
 #include <memory>
 #include <string>
 #include "sbndcode/OpDetReco/OpFlash/FlashFinder/FlashFinderManager.h"
@@ -44,6 +46,7 @@ namespace opdet{
 
     // Required functions.
     void produce(art::Event & e) override;
+    void beginRun(art::Run & r) override;
 
   private:
 
@@ -51,7 +54,8 @@ namespace opdet{
     ::lightana::PECalib _pecalib;
     std::vector<std::string> _hit_producers;
 
-    void GetFlashLocation(std::vector<double>, double&, double&, double&, double&);
+    void GetFlashLocation(std::vector<double> const&, ::lightana::OpDetGeoCache const&,
+                          double&, double&, double&, double&) const;
 
   };
 
@@ -72,6 +76,12 @@ namespace opdet{
     produces< art::Assns <recob::OpHit, recob::OpFlash> >();
   }
 
+  void SBNDFlashFinder::beginRun(art::Run &)
+  {
+    // the geometry may change between runs
+    ::lightana::UpdateOpDetGeoCache();
+  }
+
   void SBNDFlashFinder::produce(art::Event & e)
   {
 
@@ -82,6 +92,8 @@ namespace opdet{
 
     std::vector<art::Ptr<recob::OpHit>> ophit_v;
 
+    auto const geo_cache = ::lightana::GetOpDetGeoCache();
+
     ::lightana::LiteOpHitArray_t ophits;
     double trigger_time=1.1e20;
 
@@ -107,7 +119,7 @@ namespace opdet{
       if(trigger_time > 1.e20) trigger_time = oph->PeakTimeAbs() - oph->PeakTime();
       loph.peak_time = oph->PeakTime();
 
-      size_t opdet = ::lightana::OpDetFromOpChannel(oph->OpChannel());
+      size_t opdet = geo_cache->OpChannel(oph->OpChannel()).opdet;
       loph.pe = _pecalib.Calibrate(opdet,oph->Area());
       loph.channel = oph->OpChannel();
       ophits.emplace_back(std::move(loph));
@@ -115,10 +127,13 @@ namespace opdet{
 
     auto const flash_v = _mgr.RecoFlash(ophits);
 
+    art::PtrMaker<recob::OpFlash> makeFlashPtr(e);
+    opflashes->reserve(flash_v.size());
+
     for(const auto& lflash :  flash_v) {
 
       double Ycenter, Zcenter, Ywidth, Zwidth;
-      GetFlashLocation(lflash.channel_pe, Ycenter, Zcenter, Ywidth, Zwidth);
+      GetFlashLocation(lflash.channel_pe, *geo_cache, Ycenter, Zcenter, Ywidth, Zwidth);
       recob::OpFlash flash(lflash.time, lflash.time_err, trigger_time + lflash.time,
                          (trigger_time + lflash.time) / 1600., lflash.channel_pe,
                          0, 0, 1, // this are just default values
@@ -126,38 +141,47 @@ namespace opdet{
       opflashes->emplace_back(std::move(flash));
 
 
-      for(auto const& hitidx : lflash.asshit_idx) {
-        const art::Ptr<recob::OpHit> hit_ptr(ophit_v.at(hitidx));
-        util::CreateAssn(*this, e, *opflashes, hit_ptr, *flash2hit_assn_v);
-      }
+      // all the hits of the flash point to the same flash pointer
+      const art::Ptr<recob::OpFlash> flash_ptr = makeFlashPtr(opflashes->size() - 1);
+      for(auto const& hitidx : lflash.asshit_idx)
+        flash2hit_assn_v->addSingle(ophit_v.at(hitidx), flash_ptr);
     }
 
     e.put(std::move(opflashes));
     e.put(std::move(flash2hit_assn_v));
   }
 
-  void SBNDFlashFinder::GetFlashLocation(std::vector<double> pePerOpChannel,
+  void SBNDFlashFinder::GetFlashLocation(std::vector<double> const& pePerOpChannel,
+                                         ::lightana::OpDetGeoCache const& geo_cache,
                                          double& Ycenter,
                                          double& Zcenter,
                                          double& Ywidth,
-                                         double& Zwidth)
+                                         double& Zwidth) const
   {
 
     // Reset variables
     Ycenter = Zcenter = 0.;
     Ywidth  = Zwidth  = -999.;
+    if (pePerOpChannel.size() > geo_cache.NOpChannels()) {
+      throw cet::exception("SBNDFlashFinder") << "Flash with " << pePerOpChannel.size()
+        << " channels, the optical geometry has " << geo_cache.NOpChannels() << "\n";
+    }
+
+    // PE-weighted moments of the opdet positions, from the channel-indexed
+    // center coordinates (channels out of the geometry are at 0)
+    double const* pe = pePerOpChannel.data();
+    double const* y  = geo_cache.CenterY().data();
+    double const* z  = geo_cache.CenterZ().data();
     double totalPE = 0.;
     double sumy = 0., sumz = 0., sumy2 = 0., sumz2 = 0.;
-    for (unsigned int opch = 0; opch < pePerOpChannel.size(); opch++) {
-      // Get physical detector location for this opChannel
-      double PMTxyz[3];
-      ::lightana::OpDetCenterFromOpChannel(opch, PMTxyz);
-      // Add up the position, weighting with PEs
-      sumy    += pePerOpChannel[opch]*PMTxyz[1];
-      sumy2   += pePerOpChannel[opch]*PMTxyz[1]*PMTxyz[1];
-      sumz    += pePerOpChannel[opch]*PMTxyz[2];
-      sumz2   += pePerOpChannel[opch]*PMTxyz[2]*PMTxyz[2];
-      totalPE += pePerOpChannel[opch];
+    for (size_t opch = 0; opch < pePerOpChannel.size(); opch++) {
+      double const wy = pe[opch]*y[opch];
+      double const wz = pe[opch]*z[opch];
+      sumy    += wy;
+      sumy2   += wy*y[opch];
+      sumz    += wz;
+      sumz2   += wz*z[opch];
+      totalPE += pe[opch];
     }
 
     Ycenter = sumy/totalPE;
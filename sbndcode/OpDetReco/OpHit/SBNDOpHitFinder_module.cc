@@ -8,6 +8,12 @@
 // by Ben Jones, MIT, 2013
 //
 // Ported to SBND by Marco Del Tutto, March 2018
+//
+// The waveforms are read in place from the event products (the selected
+// ones are referenced, not copied) and, with NThreads > 1, the channels
+// are processed in a TBB task arena, each thread with its own instances
+// of the pulse reconstruction algorithms; the hits are stored in the
+// order of the waveforms whatever the number of threads.
 
 // LArSoft includes
 #include "larcore/Geometry/Geometry.h"
@@ -38,6 +44,12 @@
 #include "fhiclcpp/ParameterSet.h"
 #include "art/Framework/Principal/Handle.h"
 #include "canvas/Utilities/Exception.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include "tbb/blocked_range.h"
+#include "tbb/enumerable_thread_specific.h"
+#include "tbb/parallel_for.h"
+#include "tbb/task_arena.h"
 
 #include "sbndcode/OpDetSim/sbndPDMapAlg.hh"
 // #include "sbndcode/OpDetReco/OpFlash/FlashFinder/FlashFinderFMWKInterface.h"
@@ -69,6 +81,23 @@ namespace opdet {
     std::vector< double > GetSPEShifts();
     std::vector<int> PDNamesToList(std::vector<std::string>);
 
+    // pulse reconstruction chain; the algorithms keep the pulses of the
+    // last waveform, so each thread needs its own
+    struct PulseRecoAlgs {
+      std::unique_ptr<pmtana::PMTPulseRecoBase> threshAlg;
+      std::unique_ptr<pmtana::PMTPedestalBase>  pedAlg;
+      pmtana::PulseRecoManager                  mgr;
+    };
+    std::unique_ptr<PulseRecoAlgs> MakePulseRecoAlgs() const;
+
+    // reconstruct the pulses of wf and append its hits to hits
+    void FindHits(PulseRecoAlgs& algs,
+                  raw::OpDetWaveform const& wf,
+                  geo::GeometryCore const& geometry,
+                  detinfo::DetectorClocksData const& clockData,
+                  calib::IPhotonCalibrator const& calibrator,
+                  std::vector< recob::OpHit >& hits) const;
+
 
     // The parameters we'll read from the .fcl file.
     std::string fInputModule; // Input tag for OpDetWaveform collection
@@ -77,10 +106,19 @@ namespace opdet {
     std::set< unsigned int > fChannelMasks;
     std::vector<std::string> _pd_to_use; ///< PDS to use (ex: "pmt", "barepmt")
     std::vector<int> _opch_to_use; ///< List of of opch (will be infered from _pd_to_use)
+    std::vector<bool> _use_opch; ///< Whether each opch passes the masks and the PD list
+
+    fhicl::ParameterSet fHitAlgPset;
+    fhicl::ParameterSet fPedAlgPset;
+    std::unique_ptr<PulseRecoAlgs> fAlgs; // used by the main thread
+
+    unsigned fNThreads;
+    tbb::task_arena fArena;
+    tbb::enumerable_thread_specific< std::unique_ptr<PulseRecoAlgs> > fThreadAlgs;
 
-    pmtana::PulseRecoManager  fPulseRecoMgr;
-    pmtana::PMTPulseRecoBase* fThreshAlg;
-    pmtana::PMTPedestalBase*  fPedAlg;
+    // waveforms to process, in the event products
+    std::vector< raw::OpDetWaveform const* > fWaveforms;
+    std::vector< std::vector< recob::OpHit > > fWaveformHits; // by waveform, threaded mode
 
     Float_t  fHitThreshold;
     unsigned int fMaxOpChannel;
@@ -101,8 +139,7 @@ namespace opdet {
   //----------------------------------------------------------------------------
   // Constructor
   SBNDOpHitFinder::SBNDOpHitFinder(const fhicl::ParameterSet & pset):
-  EDProducer{pset},
-  fPulseRecoMgr()
+  EDProducer{pset}
   {
     // Indicate that the Input Module comes from .fcl
     fInputModule   = pset.get< std::string >("InputModule");
@@ -122,6 +159,24 @@ namespace opdet {
     auto const& geometry(*lar::providerFrom< geo::Geometry >());
     fMaxOpChannel = geometry.MaxOpChannel();
 
+    for (int ch : _opch_to_use) {
+      if (ch < 0) continue;
+      if ((unsigned) ch >= _use_opch.size()) _use_opch.resize(ch + 1, false);
+      _use_opch[ch] = true;
+    }
+    for (auto const& ch : fChannelMasks) {
+      if (ch < _use_opch.size()) _use_opch[ch] = false;
+    }
+
+    fNThreads = pset.get< unsigned >("NThreads", 1);
+    if (fNThreads == 0) fNThreads = tbb::this_task_arena::max_concurrency();
+    if (fNThreads == 0) fNThreads = 1;
+    if (fNThreads > 1) {
+      // TBB does not run more threads than art allows, whatever the arena size
+      fArena.initialize(fNThreads);
+      mf::LogInfo("SBNDOpHitFinder") << "Finding hits on n threads: " << fNThreads;
+    }
+
     if (useCalibrator) {
       // If useCalibrator, get it from ART
       fCalib = lar::providerFrom<calib::IPhotonCalibratorService>();
@@ -145,49 +200,79 @@ namespace opdet {
     }
 
     // Initialize the hit finder algorithm
-    auto const hit_alg_pset = pset.get< fhicl::ParameterSet >("HitAlgoPset");
-    std::string threshAlgName = hit_alg_pset.get< std::string >("Name");
+    fHitAlgPset = pset.get< fhicl::ParameterSet >("HitAlgoPset");
+    fPedAlgPset = pset.get< fhicl::ParameterSet >("PedAlgoPset");
+    fAlgs = MakePulseRecoAlgs();
+
+    produces< std::vector< recob::OpHit > >();
+
+  }
+
+  //----------------------------------------------------------------------------
+  // Destructor
+  SBNDOpHitFinder::~SBNDOpHitFinder()
+  {
+  }
+
+  //----------------------------------------------------------------------------
+  std::unique_ptr<SBNDOpHitFinder::PulseRecoAlgs> SBNDOpHitFinder::MakePulseRecoAlgs() const
+  {
+    auto algs = std::make_unique<PulseRecoAlgs>();
+
+    std::string threshAlgName = fHitAlgPset.get< std::string >("Name");
     if      (threshAlgName == "Threshold")
-      fThreshAlg = new pmtana::AlgoThreshold(hit_alg_pset);
+      algs->threshAlg = std::make_unique<pmtana::AlgoThreshold>(fHitAlgPset);
     else if (threshAlgName == "SiPM")
-      fThreshAlg = new pmtana::AlgoSiPM(hit_alg_pset);
+      algs->threshAlg = std::make_unique<pmtana::AlgoSiPM>(fHitAlgPset);
     else if (threshAlgName == "SlidingWindow")
-      fThreshAlg = new pmtana::AlgoSlidingWindow(hit_alg_pset);
+      algs->threshAlg = std::make_unique<pmtana::AlgoSlidingWindow>(fHitAlgPset);
     else if (threshAlgName == "FixedWindow")
-      fThreshAlg = new pmtana::AlgoFixedWindow(hit_alg_pset);
+      algs->threshAlg = std::make_unique<pmtana::AlgoFixedWindow>(fHitAlgPset);
     else if (threshAlgName == "CFD" )
-      fThreshAlg = new pmtana::AlgoCFD(hit_alg_pset);
+      algs->threshAlg = std::make_unique<pmtana::AlgoCFD>(fHitAlgPset);
     else throw art::Exception(art::errors::UnimplementedFeature)
       << "Cannot find implementation for "
     << threshAlgName << " algorithm.\n";
 
-    auto const ped_alg_pset = pset.get< fhicl::ParameterSet >("PedAlgoPset");
-    std::string pedAlgName = ped_alg_pset.get< std::string >("Name");
+    std::string pedAlgName = fPedAlgPset.get< std::string >("Name");
     if      (pedAlgName == "Edges")
-      fPedAlg = new pmtana::PedAlgoEdges(ped_alg_pset);
+      algs->pedAlg = std::make_unique<pmtana::PedAlgoEdges>(fPedAlgPset);
     else if (pedAlgName == "RollingMean")
-      fPedAlg = new pmtana::PedAlgoRollingMean(ped_alg_pset);
+      algs->pedAlg = std::make_unique<pmtana::PedAlgoRollingMean>(fPedAlgPset);
     else if (pedAlgName == "UB"   )
-      fPedAlg = new pmtana::PedAlgoUB(ped_alg_pset);
+      algs->pedAlg = std::make_unique<pmtana::PedAlgoUB>(fPedAlgPset);
     else throw art::Exception(art::errors::UnimplementedFeature)
       << "Cannot find implementation for "
     << pedAlgName << " algorithm.\n";
 
-    produces< std::vector< recob::OpHit > >();
-
-    fPulseRecoMgr.AddRecoAlgo(fThreshAlg);
-    fPulseRecoMgr.SetDefaultPedAlgo(fPedAlg);
+    algs->mgr.AddRecoAlgo(algs->threshAlg.get());
+    algs->mgr.SetDefaultPedAlgo(algs->pedAlg.get());
 
+    return algs;
   }
 
   //----------------------------------------------------------------------------
-  // Destructor
-  SBNDOpHitFinder::~SBNDOpHitFinder()
+  // Same as opdet::RunHitFinder() for a single waveform
+  void SBNDOpHitFinder::FindHits(PulseRecoAlgs& algs,
+                                 raw::OpDetWaveform const& wf,
+                                 geo::GeometryCore const& geometry,
+                                 detinfo::DetectorClocksData const& clockData,
+                                 calib::IPhotonCalibrator const& calibrator,
+                                 std::vector< recob::OpHit >& hits) const
   {
+    const int channel = static_cast< int >(wf.ChannelNumber());
+    if (!geometry.IsValidOpChannel(channel)) {
+      mf::LogError("OpHitFinder") << "Error! unrecognized channel number "
+                                  << channel << ". Ignoring pulse";
+      return;
+    }
 
-    delete fThreshAlg;
-    delete fPedAlg;
+    algs.mgr.Reconstruct(wf);
 
+    const double timeStamp = wf.TimeStamp();
+    for (auto const& pulse : algs.threshAlg->GetPulses())
+      ConstructHit(fHitThreshold, channel, timeStamp, pulse, hits,
+                   clockData, calibrator);
   }
 
   //----------------------------------------------------------------------------
@@ -215,7 +300,8 @@ namespace opdet {
     // Get the pulses from the event
     //
 
-    // Load pulses into WaveformVector
+    // Reference the pulses to process, without copying them
+    fWaveforms.clear();
     if(fChannelMasks.empty() && _opch_to_use.empty() && fInputLabels.size()<2) {
       art::Handle< std::vector< raw::OpDetWaveform > > wfHandle;
       if(fInputLabels.empty())
@@ -223,29 +309,10 @@ namespace opdet {
       else
         evt.getByLabel(fInputModule, fInputLabels.front(), wfHandle);
       assert(wfHandle.isValid());
-      RunHitFinder(*wfHandle,
-                   *HitPtr,
-                   fPulseRecoMgr,
-                   *fThreshAlg,
-                   geometry,
-                   fHitThreshold,
-                   clockData,
-                   calibrator);
+      fWaveforms.reserve(wfHandle->size());
+      for(auto const& wf : *wfHandle) fWaveforms.push_back(&wf);
     } else {
 
-      // Reserve a large enough array
-      int totalsize = 0;
-      for (auto label : fInputLabels)
-      {
-        art::Handle< std::vector< raw::OpDetWaveform > > wfHandle;
-        evt.getByLabel(fInputModule, label, wfHandle);
-        if (!wfHandle.isValid()) continue; // Skip non-existent collections
-        totalsize += wfHandle->size();
-      }
-
-      std::vector< raw::OpDetWaveform > WaveformVector;
-      WaveformVector.reserve(totalsize);
-
       for (auto label : fInputLabels)
       {
         art::Handle< std::vector< raw::OpDetWaveform > > wfHandle;
@@ -254,26 +321,41 @@ namespace opdet {
 
         for(auto const& wf : *wfHandle)
         {
-          // If this channel is in the channel mask, ingore it
-          if ( fChannelMasks.find(wf.ChannelNumber()) != fChannelMasks.end() ) continue;
-          // If this PDS in not in the list of PDS to use, ingore it
-          if ( std::find(_opch_to_use.begin(), _opch_to_use.end(), wf.ChannelNumber()) == _opch_to_use.end() ) continue;
+          // If this channel is in the channel mask or its PDS is not in
+          // the list of PDS to use, ignore it
+          const unsigned int ch = wf.ChannelNumber();
+          if ( ch >= _use_opch.size() || !_use_opch[ch] ) continue;
 
-          WaveformVector.push_back(wf);
+          fWaveforms.push_back(&wf);
         }
       }
+    }
 
-      RunHitFinder(WaveformVector,
-                   *HitPtr,
-                   fPulseRecoMgr,
-                   *fThreshAlg,
-                   geometry,
-                   fHitThreshold,
-                   clockData,
-                   calibrator);
-      // for (auto h : *HitPtr)
-      //   std::cout << "> ophit time " << h.PeakTime() << ", area " << h.Area() << ", pe " << h.PE() << std::endl;
+    if (fNThreads <= 1) {
+      for (auto const* wf : fWaveforms)
+        FindHits(*fAlgs, *wf, geometry, clockData, calibrator, *HitPtr);
     }
+    else {
+      // hits of each waveform in their own vector, then merged in order
+      if (fWaveformHits.size() < fWaveforms.size()) fWaveformHits.resize(fWaveforms.size());
+      fArena.execute([&]{
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, fWaveforms.size()),
+          [&](tbb::blocked_range<size_t> const& range) {
+            std::unique_ptr<PulseRecoAlgs>& algs = fThreadAlgs.local();
+            if (!algs) algs = MakePulseRecoAlgs();
+            for (size_t i = range.begin(); i != range.end(); ++i) {
+              fWaveformHits[i].clear();
+              FindHits(*algs, *fWaveforms[i], geometry, clockData, calibrator, fWaveformHits[i]);
+            }
+          });
+      });
+      size_t nHits = 0;
+      for (size_t i = 0; i < fWaveforms.size(); ++i) nHits += fWaveformHits[i].size();
+      HitPtr->reserve(nHits);
+      for (size_t i = 0; i < fWaveforms.size(); ++i)
+        HitPtr->insert(HitPtr->end(), fWaveformHits[i].begin(), fWaveformHits[i].end());
+    }
+
     // Store results into the event
     evt.put(std::move(HitPtr));
 
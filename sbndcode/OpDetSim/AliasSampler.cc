@@ -0,0 +1,76 @@
+#include "sbndcode/OpDetSim/AliasSampler.hh"
+
+#include "CLHEP/Random/RandomEngine.h"
+#include "cetlib_except/exception.h"
+
+namespace opdet {
+
+  AliasSampler::AliasSampler(double const* pdf, std::size_t n)
+    : fN(n)
+    , fProbability(n, 1.0)
+    , fAlias(n)
+  {
+    if (n == 0) {
+      throw cet::exception("AliasSampler") << "Can't sample a distribution with no bins\n";
+    }
+
+    double total = 0.;
+    for (std::size_t i = 0; i < n; i++) {
+      if (pdf[i] > 0.) total += pdf[i];
+    }
+
+    // weights scaled so that their average is 1
+    std::vector<double> scaled(n, 1.0);
+    if (total > 0.) {
+      for (std::size_t i = 0; i < n; i++) scaled[i] = (pdf[i] > 0.)? pdf[i] * n / total: 0.;
+    }
+
+    // Vose: each column is filled by one bin below average and, for the
+    // rest, by one above average
+    std::vector<std::size_t> small, large;
+    for (std::size_t i = 0; i < n; i++) {
+      fAlias[i] = i;
+      ((scaled[i] < 1.0)? small: large).push_back(i);
+    }
+    while (!small.empty() && !large.empty()) {
+      const std::size_t s = small.back(), l = large.back();
+      small.pop_back();
+      fProbability[s] = scaled[s];
+      fAlias[s] = l;
+      scaled[l] -= 1.0 - scaled[s];
+      if (scaled[l] < 1.0) {
+        large.pop_back();
+        small.push_back(l);
+      }
+    }
+    // what is left is at average, up to rounding
+    for (std::size_t i : small) fProbability[i] = 1.0;
+    for (std::size_t i : large) fProbability[i] = 1.0;
+  }
+
+
+  double AliasSampler::fire(CLHEP::HepRandomEngine& engine) const
+  {
+    const double u1 = engine.flat();
+    return Sample(u1, engine.flat());
+  }
+
+
+  void AliasSampler::fireArray(CLHEP::HepRandomEngine& engine, std::size_t n, double* values)
+  {
+    fUniform.resize(2 * n);
+    engine.flatArray(2 * n, fUniform.data());
+    for (std::size_t i = 0; i < n; i++) values[i] = Sample(fUniform[2 * i], fUniform[2 * i + 1]);
+  }
+
+
+  double AliasSampler::BinProbability(std::size_t i) const
+  {
+    double p = fProbability[i];
+    for (std::size_t j = 0; j < fN; j++) {
+      if (fAlias[j] == i && j != i) p += 1.0 - fProbability[j];
+    }
+    return p / fN;
+  }
+
+} // namespace opdet
@@ -0,0 +1,70 @@
+////////////////////////////////////////////////////////////////////////
+// File:        AliasSampler.hh
+//
+// Sampling of a binned distribution in constant time with the alias
+// method of Walker (table construction of Vose), as a drop-in
+// replacement of CLHEP::RandGeneral with the default (continuous)
+// interpolation: the values are in [0, 1), uniform inside each of the
+// n bins of width 1/n, and a bin is drawn with a probability
+// proportional to its (non-negative) weight.
+//
+// CLHEP::RandGeneral searches the cumulative distribution for every
+// value; here a value takes two uniform numbers and two table lookups,
+// and fireArray draws all the uniform numbers from the engine at once.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBND_OPDETSIM_ALIASSAMPLER_HH
+#define SBND_OPDETSIM_ALIASSAMPLER_HH
+
+#include <cstddef>
+#include <vector>
+
+namespace CLHEP {
+  class HepRandomEngine;
+}
+
+namespace opdet {
+
+  class AliasSampler {
+
+  public:
+
+    // weights of the n bins; negative weights are taken as 0 and, if all
+    // the weights are 0, the distribution is flat (as CLHEP::RandGeneral)
+    AliasSampler(double const* pdf, std::size_t n);
+    explicit AliasSampler(std::vector<double> const& pdf)
+      : AliasSampler(pdf.data(), pdf.size()) {}
+
+    // value from two uniform numbers in [0, 1)
+    double Sample(double u1, double u2) const
+      {
+        const double x = u1 * fN;
+        std::size_t bin = static_cast<std::size_t>(x);
+        if (bin >= fN) bin = fN - 1;
+        if (x - bin >= fProbability[bin]) bin = fAlias[bin];
+        return (bin + u2) / fN;
+      }
+
+    double fire(CLHEP::HepRandomEngine& engine) const;
+
+    // fill values[0, n) with n values
+    void fireArray(CLHEP::HepRandomEngine& engine, std::size_t n, double* values);
+
+    std::size_t NBins() const { return fN; }
+
+    // probability of drawing bin i, from the tables
+    double BinProbability(std::size_t i) const;
+
+  private:
+
+    std::size_t fN;
+    std::vector<double> fProbability; // of keeping the bin of the column
+    std::vector<std::size_t> fAlias;  // bin drawn otherwise
+
+    std::vector<double> fUniform; // buffer for fireArray
+
+  }; // class AliasSampler
+
+} // namespace opdet
+
+#endif // SBND_OPDETSIM_ALIASSAMPLER_HH
@@ -38,21 +38,17 @@ namespace opdet {
     // TPB emission time histogram for visible (x)arapucas
     std::vector<double>* timeTPB_p;
     file->GetObject("timeTPB", timeTPB_p);
-    fTimeTPB = std::make_unique<CLHEP::RandGeneral>
-      (*fEngine, timeTPB_p->data(), timeTPB_p->size());
+    fTimeTPB = std::make_unique<AliasSampler>(*timeTPB_p);
 
     std::vector<double>* TimeArapucaVUV_p;
     file->GetObject("TimeArapucaVUV", TimeArapucaVUV_p);
-    fTimeArapucaVUV = std::make_unique<CLHEP::RandGeneral>
-      (*fEngine, TimeArapucaVUV_p->data(), TimeArapucaVUV_p->size());
+    fTimeArapucaVUV = std::make_unique<AliasSampler>(*TimeArapucaVUV_p);
     std::vector<double>* TimeArapucaVIS_p;
     file->GetObject("TimeArapucaVIS", TimeArapucaVIS_p);
-    fTimeArapucaVIS = std::make_unique<CLHEP::RandGeneral>
-      (*fEngine, TimeArapucaVIS_p->data(), TimeArapucaVIS_p->size());
+    fTimeArapucaVIS = std::make_unique<AliasSampler>(*TimeArapucaVIS_p);
     std::vector<double>* TimeXArapucaVUV_p;
     file->GetObject("TimeXArapucaVUV", TimeXArapucaVUV_p);
-    fTimeXArapucaVUV = std::make_unique<CLHEP::RandGeneral>
-      (*fEngine, TimeXArapucaVUV_p->data(), TimeXArapucaVUV_p->size());
+    fTimeXArapucaVUV = std::make_unique<AliasSampler>(*TimeXArapucaVUV_p);
 
     fSampling = fSampling / 1000; //in GHz to cancel with ns
     pulsesize = fParams.PulseLength * fSampling;
@@ -69,193 +65,163 @@ namespace opdet {
   void DigiArapucaSBNDAlg::ConstructWaveform(
     int ch,
     sim::SimPhotons const& simphotons,
-    std::vector<short unsigned int>& waveform,
+    std::vector<raw::ADC_Count_t>& waveform,
     std::string pdtype,
     double start_time,
     unsigned n_samples)
   {
-    std::vector<double> waves(n_samples, fParams.Baseline);
-    CreatePDWaveform(simphotons, start_time, waves, pdtype);
-    waveform = std::vector<short unsigned int> (waves.begin(), waves.end());
+    fWave.assign(n_samples, fParams.Baseline);
+    CreatePDWaveform(simphotons, start_time, fWave, pdtype);
+    Digitize(fWave, waveform);
   }
 
 
   void DigiArapucaSBNDAlg::ConstructWaveformLite(
     int ch,
-    sim::SimPhotonsLite const& litesimphotons,
-    std::vector<short unsigned int>& waveform,
+    PhotonLiteStore::Bins const& litesimphotons,
+    std::vector<raw::ADC_Count_t>& waveform,
     std::string pdtype,
     double start_time,
     unsigned n_samples)
   {
-    std::vector<double> waves(n_samples, fParams.Baseline);
-    std::map<int, int> const& photonMap = litesimphotons.DetectedPhotons;
-    CreatePDWaveformLite(photonMap, start_time, waves, pdtype);
-    waveform = std::vector<short unsigned int> (waves.begin(), waves.end());
+    fWave.assign(n_samples, fParams.Baseline);
+    CreatePDWaveformLite(litesimphotons, start_time, fWave, pdtype);
+    Digitize(fWave, waveform);
   }
 
 
   void DigiArapucaSBNDAlg::CreatePDWaveform(
     sim::SimPhotons const& simphotons,
     double t_min,
-    std::vector<double>& wave,
+    std::vector<float>& wave,
     std::string pdtype)
   {
-    int nCT = 1;
-    double tphoton;
-    size_t timeBin;
     if(pdtype == "arapuca_vuv") {
-      for(size_t i = 0; i < simphotons.size(); i++) {
-        if((CLHEP::RandFlat::shoot(fEngine, 1.0)) < fArapucaVUVEff) { //Sample a random subset according to Arapuca's efficiency
-          tphoton = (fTimeArapucaVUV->fire());
-          tphoton += simphotons[i].Time - t_min;
-          if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
-          if(fParams.CrossTalk > 0.0 && (CLHEP::RandFlat::shoot(fEngine, 1.0)) < fParams.CrossTalk) nCT = 2;
-          else nCT = 1;
-          timeBin = std::floor(tphoton * fSampling);
-          if(timeBin < wave.size()) AddSPE(timeBin, wave, nCT);
-        }
-      }
+      SelectPhotons(simphotons, fArapucaVUVEff);
+      DelayPhotons(*fTimeArapucaVUV);
     }
     else if(pdtype == "arapuca_vis") {
-      for(size_t i = 0; i < simphotons.size(); i++) {
-        if((CLHEP::RandFlat::shoot(fEngine, 1.0)) < fArapucaVISEff) { //Sample a random subset according to Arapuca's efficiency.
-          tphoton = (fTimeArapucaVIS->fire());
-          tphoton += simphotons[i].Time - t_min;
-          tphoton +=fTimeTPB->fire();
-          if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
-          if(fParams.CrossTalk > 0.0 && (CLHEP::RandFlat::shoot(fEngine, 1.0)) < fParams.CrossTalk) nCT = 2;
-          else nCT = 1;
-          timeBin = std::floor(tphoton * fSampling);
-          if(timeBin < wave.size()) AddSPE(timeBin, wave, nCT);
-        }
-      }
+      SelectPhotons(simphotons, fArapucaVISEff);
+      DelayPhotons(*fTimeArapucaVIS);
+      AddTPBDelays();
     }
     else if(pdtype == "xarapuca_vuv") {
-      for(size_t i = 0; i < simphotons.size(); i++) {
-        if((CLHEP::RandFlat::shoot(fEngine, 1.0)) < fXArapucaVUVEff) {
-          tphoton = (fTimeXArapucaVUV->fire());
-          tphoton += simphotons[i].Time - t_min;
-          if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
-          if(fParams.CrossTalk > 0.0 && (CLHEP::RandFlat::shoot(fEngine, 1.0)) < fParams.CrossTalk) nCT = 2;
-          else nCT = 1;
-          timeBin = std::floor(tphoton * fSampling);
-          if(timeBin < wave.size()) AddSPE(timeBin, wave, nCT);
-        }
-      }
+      SelectPhotons(simphotons, fXArapucaVUVEff);
+      DelayPhotons(*fTimeXArapucaVUV);
     }
     else if(pdtype == "xarapuca_vis") {
-      for(size_t i = 0; i < simphotons.size(); i++) {
-        if((CLHEP::RandFlat::shoot(fEngine, 1.0)) < fXArapucaVISEff) {
-          tphoton = (CLHEP::RandExponential::shoot(fEngine, 8.5)); //decay time of EJ280 in ns
-          tphoton += simphotons[i].Time - t_min;
-          tphoton +=fTimeTPB->fire();
-          if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
-          if(fParams.CrossTalk > 0.0 && (CLHEP::RandFlat::shoot(fEngine, 1.0)) < fParams.CrossTalk) nCT = 2;
-          else nCT = 1;
-          timeBin = std::floor(tphoton * fSampling);
-          if(timeBin < wave.size()) AddSPE(timeBin, wave, nCT);
-        }
-      }
+      SelectPhotons(simphotons, fXArapucaVISEff);
+      DelayPhotons(8.5); //decay time of EJ280 in ns
+      AddTPBDelays();
     }
     else{
       throw cet::exception("DigiARAPUCASBNDAlg") << "Wrong pdtype: " << pdtype << std::endl;
     }
+    AddPhotonPulses(t_min, wave);
     if(fParams.BaselineRMS > 0.0) AddLineNoise(wave);
     if(fParams.DarkNoiseRate > 0.0) AddDarkNoise(wave);
-    CreateSaturation(wave);
   }
 
 
   void DigiArapucaSBNDAlg::CreatePDWaveformLite(
-    std::map<int, int> const& photonMap,
+    PhotonLiteStore::Bins const& photonBins,
     double t_min,
-    std::vector<double>& wave,
+    std::vector<float>& wave,
     std::string pdtype)
   {
     if(pdtype == "xarapuca_vuv"){
-      SinglePDWaveformCreatorLite(fXArapucaVUVEff, fTimeXArapucaVUV, wave, photonMap, t_min);
+      SelectPhotonsLite(photonBins, fXArapucaVUVEff);
+      DelayPhotons(*fTimeXArapucaVUV);
     }
     else if(pdtype == "xarapuca_vis"){
-      // creating the waveforms for xarapuca_vis is different than the rest
-      // so there's an overload for that which lacks the timeHisto
-      SinglePDWaveformCreatorLite(fXArapucaVISEff, wave, photonMap, t_min);
+      // creating the waveforms for xarapuca_vis is different than the rest:
+      // no time histogram, but the decay time of the wavelength shifter
+      SelectPhotonsLite(photonBins, fXArapucaVISEff);
+      DelayPhotons(fParams.DecayTXArapucaVIS);
     }
     else if(pdtype == "arapuca_vuv"){
-      SinglePDWaveformCreatorLite(fArapucaVUVEff, fTimeArapucaVUV, wave, photonMap, t_min);
+      SelectPhotonsLite(photonBins, fArapucaVUVEff);
+      DelayPhotons(*fTimeArapucaVUV);
     }
     else if(pdtype == "arapuca_vis"){
-      SinglePDWaveformCreatorLite(fArapucaVISEff, fTimeArapucaVIS, wave, photonMap, t_min);
+      SelectPhotonsLite(photonBins, fArapucaVISEff);
+      DelayPhotons(*fTimeArapucaVIS);
     }
     else{
       throw cet::exception("DigiARAPUCASBNDAlg") << "Wrong pdtype: " << pdtype << std::endl;
     }
+    AddPhotonPulses(t_min, wave);
     if(fParams.BaselineRMS > 0.0) AddLineNoise(wave);
     if(fParams.DarkNoiseRate > 0.0) AddDarkNoise(wave);
-    CreateSaturation(wave);
   }
 
 
-  void DigiArapucaSBNDAlg::SinglePDWaveformCreatorLite(
-    double effT,
-    std::unique_ptr<CLHEP::RandGeneral>& timeHisto,
-    std::vector<double>& wave,
-    std::map<int, int> const& photonMap,
-    double const& t_min
-    )
+  void DigiArapucaSBNDAlg::SelectPhotons(
+    sim::SimPhotons const& simphotons,
+    double eff)
   {
-    // TODO: check that this new approach of not using the last
-    // (1-accepted_photons) doesn't introduce some bias
-    double meanPhotons;
-    size_t acceptedPhotons;
-    double tphoton;
-    int nCT;
-    size_t timeBin;
-    for (auto const& photonMember : photonMap) {
-      // TODO: check that this new approach of not using the last
-      // (1-accepted_photons) doesn't introduce some bias
-      meanPhotons = photonMember.second*effT;
-      acceptedPhotons = CLHEP::RandPoissonQ::shoot(fEngine, meanPhotons);
-      for(size_t i = 0; i < acceptedPhotons; i++) {
-        tphoton = timeHisto->fire();
-        tphoton += photonMember.first - t_min;
-        if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
-        if(fParams.CrossTalk > 0.0 &&
-           (CLHEP::RandFlat::shoot(fEngine, 1.0)) < fParams.CrossTalk) nCT = 2;
-        else nCT = 1;
-        timeBin = std::floor(tphoton * fSampling);
-        if(timeBin < wave.size()) AddSPE(timeBin, wave, nCT);
-      }
+    // one uniform number per photon, drawn in a single call
+    const size_t n = simphotons.size();
+    fRandom.resize(n);
+    CLHEP::RandFlat::shootArray(fEngine, n, fRandom.data());
+    fPhotonTimes.clear();
+    for(size_t i = 0; i < n; i++) {
+      if(fRandom[i] < eff) fPhotonTimes.push_back(simphotons[i].Time); //Sample a random subset according to Arapuca's efficiency
     }
   }
 
 
-  void DigiArapucaSBNDAlg::SinglePDWaveformCreatorLite(
-    double effT,
-    std::vector<double>& wave,
-    std::map<int, int> const& photonMap,
-    double const& t_min
-    )
+  void DigiArapucaSBNDAlg::SelectPhotonsLite(
+    PhotonLiteStore::Bins const& photonBins,
+    double eff)
   {
-    double meanPhotons;
-    size_t acceptedPhotons;
-    double tphoton;
-    int nCT;
-    size_t timeBin;
-    for (auto const& photonMember : photonMap) {
+    fPhotonTimes.clear();
+    for (PhotonLiteBin const& photons : photonBins) {
       // TODO: check that this new approach of not using the last
       // (1-accepted_photons) doesn't introduce some bias
-      meanPhotons = photonMember.second*effT;
-      acceptedPhotons = CLHEP::RandPoissonQ::shoot(fEngine, meanPhotons);
-      for(size_t i = 0; i < acceptedPhotons; i++) {
-        tphoton = (CLHEP::RandExponential::shoot(fEngine, fParams.DecayTXArapucaVIS));
-        tphoton += photonMember.first - t_min;
-        if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
-        if(fParams.CrossTalk > 0.0 && (CLHEP::RandFlat::shoot(fEngine, 1.0)) < fParams.CrossTalk) nCT = 2;
-        else nCT = 1;
-        timeBin = std::floor(tphoton * fSampling);
-        if(timeBin < wave.size()) AddSPE(timeBin, wave, nCT);
-      }
+      const size_t acceptedPhotons = CLHEP::RandPoissonQ::shoot(fEngine, photons.count*eff);
+      fPhotonTimes.insert(fPhotonTimes.end(), acceptedPhotons, photons.time);
+    }
+  }
+
+
+  void DigiArapucaSBNDAlg::DelayPhotons(AliasSampler& timeHisto)
+  {
+    fDelays.resize(fPhotonTimes.size());
+    timeHisto.fireArray(*fEngine, fDelays.size(), fDelays.data());
+  }
+
+
+  void DigiArapucaSBNDAlg::DelayPhotons(double decayTime)
+  {
+    fDelays.resize(fPhotonTimes.size());
+    CLHEP::RandExponential::shootArray(fEngine, fDelays.size(), fDelays.data(), decayTime);
+  }
+
+
+  void DigiArapucaSBNDAlg::AddTPBDelays()
+  {
+    const size_t n = fDelays.size();
+    fRandom.resize(n);
+    fTimeTPB->fireArray(*fEngine, n, fRandom.data());
+    for(size_t i = 0; i < n; i++) fDelays[i] += fRandom[i];
+  }
+
+
+  void DigiArapucaSBNDAlg::AddPhotonPulses(double t_min, std::vector<float>& wave)
+  {
+    const size_t n = fPhotonTimes.size();
+    const bool crossTalk = (fParams.CrossTalk > 0.0);
+    if(crossTalk) {
+      fRandom.resize(n);
+      CLHEP::RandFlat::shootArray(fEngine, n, fRandom.data());
+    }
+    for(size_t i = 0; i < n; i++) {
+      const double tphoton = fDelays[i] + (fPhotonTimes[i] - t_min);
+      if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
+      const int nCT = (crossTalk && fRandom[i] < fParams.CrossTalk)? 2: 1;
+      const size_t timeBin = std::floor(tphoton * fSampling);
+      if(timeBin < wave.size()) AddSPE(timeBin, wave, nCT);
     }
   }
 
@@ -275,7 +241,7 @@ namespace opdet {
 
   void DigiArapucaSBNDAlg::AddSPE(
     size_t time_bin,
-    std::vector<double>& wave,
+    std::vector<float>& wave,
     int nphotons) //adding single pulse
   {
     // if(time_bin > wave.size()) return;
@@ -289,35 +255,24 @@ namespace opdet {
   }
 
 
-  void DigiArapucaSBNDAlg::CreateSaturation(std::vector<double>& wave)
+  void DigiArapucaSBNDAlg::Digitize(std::vector<float> const& wave,
+                                    std::vector<raw::ADC_Count_t>& waveform) const
   {
-    std::replace_if(wave.begin(), wave.end(),
-                    [&](auto w){return w > saturation;}, saturation);
+    // saturation and conversion in the same pass
+    waveform.resize(wave.size());
+    std::transform(wave.begin(), wave.end(), waveform.begin(),
+                   [this](float w) -> raw::ADC_Count_t {
+                     return (w > saturation)? saturation: w; });
   }
 
 
-  void DigiArapucaSBNDAlg::AddLineNoise(std::vector< double >& wave)
+  void DigiArapucaSBNDAlg::AddLineNoise(std::vector<float>& wave)
   {
-    // TODO: after running the profiler I can see that this is where
-    // most cycles are being used.  Potentially some improvement could
-    // be achieved with the below code but the array dynamic allocation
-    // is not helping. The function would need to have it passed.
-    // ~icaza
-    //
-    // double *array = new double[wave.size()]();
-    // CLHEP::RandGaussQ::shootArray(fEngine, wave.size(), array, 0, fParams.BaselineRMS);
-    // for(size_t i = 0; i<wave.size(); i++) {
-    //   wave[i] += array[i];
-    // }
-    // delete array;
-    //
-    std::transform(wave.begin(), wave.end(), wave.begin(),
-                   [this](double w) -> double {
-                     return w + CLHEP::RandGaussQ::shoot(fEngine, 0, fParams.BaselineRMS) ; });
+    fParams.lineNoise->AddNoise(*fEngine, fParams.BaselineRMS, wave);
   }
 
 
-  void DigiArapucaSBNDAlg::AddDarkNoise(std::vector<double>& wave)
+  void DigiArapucaSBNDAlg::AddDarkNoise(std::vector<float>& wave)
   {
     int nCT;
     size_t timeBin;
@@ -345,10 +300,10 @@ namespace opdet {
   }
 
 
-  double DigiArapucaSBNDAlg::FindMinimumTimeLite(std::map<int, int> const& photonMap)
+  double DigiArapucaSBNDAlg::FindMinimumTimeLite(PhotonLiteStore::Bins const& photonBins)
   {
-    for (auto const& mapMember : photonMap) {
-      if(mapMember.second != 0) return (double)mapMember.first;
+    for (PhotonLiteBin const& bin : photonBins) {
+      if(bin.count != 0) return (double)bin.time;
     }
     return 1e5;
   }
@@ -378,6 +333,7 @@ namespace opdet {
     fBaseConfig.PeakTime          = config.peakTime();
     fBaseConfig.DecayTXArapucaVIS = config.decayTXArapucaVIS();
     fBaseConfig.ArapucaDataFile   = config.arapucaDataFile();
+    fLineNoise = std::make_shared<OpDetNoiseGenerator const>(config.lineNoise());
 
   }
 
@@ -394,6 +350,7 @@ namespace opdet {
     params.larProp = &larProp;
     params.frequency = clockData.OpticalClock().Frequency();
     params.engine = engine;
+    params.lineNoise = fLineNoise.get();
 
     return std::make_unique<DigiArapucaSBNDAlg>(params);
   } // DigiArapucaSBNDAlgMaker::create()
@@ -10,11 +10,11 @@
 #define SBND_OPDETSIM_DIGIARAPUCASBNDALG_HH
 
 #include "fhiclcpp/types/Atom.h"
+#include "fhiclcpp/types/Table.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 #include "nurandom/RandomUtils/NuRandomService.h"
 #include "CLHEP/Random/RandFlat.h"
 #include "CLHEP/Random/RandGaussQ.h"
-#include "CLHEP/Random/RandGeneral.h"
 #include "CLHEP/Random/RandPoissonQ.h"
 #include "CLHEP/Random/RandExponential.h"
 
@@ -36,6 +36,10 @@
 
 #include "TFile.h"
 
+#include "sbndcode/OpDetSim/AliasSampler.hh"
+#include "sbndcode/OpDetSim/OpDetNoiseGenerator.hh"
+#include "sbndcode/OpDetSim/PhotonLiteStore.hh"
+
 namespace opdet {
 
   class DigiArapucaSBNDAlg {
@@ -64,6 +68,7 @@ namespace opdet {
       detinfo::LArProperties const* larProp = nullptr; ///< LarProperties service provider.
       double frequency; ///< Optical-clock frequency
       CLHEP::HepRandomEngine* engine = nullptr;
+      OpDetNoiseGenerator const* lineNoise = nullptr;
     };// ConfigurationParameters_t
 
     //Default constructor
@@ -78,13 +83,13 @@ namespace opdet {
 
     void ConstructWaveform(int ch,
                            sim::SimPhotons const& simphotons,
-                           std::vector<short unsigned int>& waveform,
+                           std::vector<raw::ADC_Count_t>& waveform,
                            std::string pdtype,
                            double start_time,
                            unsigned n_samples);
     void ConstructWaveformLite(int ch,
-                               sim::SimPhotonsLite const& litesimphotons,
-                               std::vector<short unsigned int>& waveform,
+                               PhotonLiteStore::Bins const& litesimphotons,
+                               std::vector<raw::ADC_Count_t>& waveform,
                                std::string pdtype,
                                double start_time,
                                unsigned n_samples);
@@ -105,38 +110,43 @@ namespace opdet {
 
     CLHEP::HepRandomEngine* fEngine; //!< Reference to art-managed random-number engine
 
-    std::unique_ptr<CLHEP::RandGeneral> fTimeArapucaVUV; // histogram for getting the photon time distribution inside the Arapuca VUV box (considering the optical window)
-    std::unique_ptr<CLHEP::RandGeneral> fTimeArapucaVIS; // histogram for getting the photon time distribution inside the Arapuca VIS box (considering the optical window)
-    std::unique_ptr<CLHEP::RandGeneral> fTimeXArapucaVUV;// histogram for getting the photon time distribution inside the XArapuca VUV box (considering the optical window)
-    std::unique_ptr<CLHEP::RandGeneral> fTimeTPB; // histogram for getting the TPB emission time for visible (x)arapucas
+    std::unique_ptr<AliasSampler> fTimeArapucaVUV; // histogram for getting the photon time distribution inside the Arapuca VUV box (considering the optical window)
+    std::unique_ptr<AliasSampler> fTimeArapucaVIS; // histogram for getting the photon time distribution inside the Arapuca VIS box (considering the optical window)
+    std::unique_ptr<AliasSampler> fTimeXArapucaVUV;// histogram for getting the photon time distribution inside the XArapuca VUV box (considering the optical window)
+    std::unique_ptr<AliasSampler> fTimeTPB; // histogram for getting the TPB emission time for visible (x)arapucas
 
     std::vector<double> wsp; //single photon pulse vector
+    std::vector<float> fWave; // waveform being built, before digitization
+    std::vector<double> fPhotonTimes; // arrival times of the accepted photons
+    std::vector<double> fDelays; // delays of the accepted photons
+    std::vector<double> fRandom; // buffer for the random numbers drawn in bulk
     std::unordered_map< raw::Channel_t, std::vector<double> > fFullWaveforms;
 
     void CreatePDWaveform(sim::SimPhotons const& SimPhotons,
                           double t_min,
-                          std::vector<double>& wave,
+                          std::vector<float>& wave,
                           std::string pdtype);
-    void CreatePDWaveformLite(std::map<int, int> const& photonMap,
+    void CreatePDWaveformLite(PhotonLiteStore::Bins const& photonBins,
                               double t_min,
-                              std::vector<double>& wave,
+                              std::vector<float>& wave,
                               std::string pdtype);
-    void SinglePDWaveformCreatorLite(double effT,
-                                     std::unique_ptr<CLHEP::RandGeneral>& timeHisto,
-                                     std::vector<double>& wave,
-                                     std::map<int, int> const& photonMap,
-                                     double const& t_min);
-    void SinglePDWaveformCreatorLite(double effT,
-                                     std::vector<double>& wave,
-                                     std::map<int, int> const& photonMap,
-                                     double const& t_min);
-    void AddSPE(size_t time_bin, std::vector<double>& wave, int nphotons); // add single pulse to auxiliary waveform
+    // The photons of a channel are first selected according to the
+    // efficiency (fPhotonTimes), then all their delays are drawn at once
+    // (fDelays) and their pulses, with cross-talk, added to the waveform
+    void SelectPhotons(sim::SimPhotons const& simphotons, double eff);
+    void SelectPhotonsLite(PhotonLiteStore::Bins const& photonBins, double eff);
+    void DelayPhotons(AliasSampler& timeHisto); // delays from a time histogram
+    void DelayPhotons(double decayTime); // exponential delays
+    void AddTPBDelays(); // add the TPB emission time to the delays
+    void AddPhotonPulses(double t_min, std::vector<float>& wave);
+    void AddSPE(size_t time_bin, std::vector<float>& wave, int nphotons); // add single pulse to auxiliary waveform
     void Pulse1PE(std::vector<double>& wave);
-    void AddLineNoise(std::vector<double>& wave);
-    void AddDarkNoise(std::vector<double>& wave);
+    void AddLineNoise(std::vector<float>& wave);
+    void AddDarkNoise(std::vector<float>& wave);
     double FindMinimumTime(sim::SimPhotons const& simphotons);
-    double FindMinimumTimeLite(std::map< int, int > const& photonMap);
-    void CreateSaturation(std::vector<double>& wave);//Including saturation effects
+    double FindMinimumTimeLite(PhotonLiteStore::Bins const& photonBins);
+    void Digitize(std::vector<float> const& wave,
+                  std::vector<raw::ADC_Count_t>& waveform) const; //Including saturation effects
   };//class DigiArapucaSBNDAlg
 
   class DigiArapucaSBNDAlgMaker {
@@ -231,6 +241,10 @@ namespace opdet {
         Comment("File containing timing distribution for ArapucaVUV (optical window + cavity), ArapucaVIS (optical window + cavity), XArapuca VUV (optical window)")
       };
 
+      fhicl::Table<OpDetNoiseGenerator::Config> lineNoise {
+        Name("ArapucaLineNoise"),
+        Comment("Line noise generator of the (X)Arapucas")
+      };
     };    //struct Config
 
     DigiArapucaSBNDAlgMaker(Config const& config); //Constructor
@@ -244,6 +258,7 @@ namespace opdet {
   private:
     /// Part of the configuration learned from configuration files.
     DigiArapucaSBNDAlg::ConfigurationParameters_t fBaseConfig;
+    std::shared_ptr<OpDetNoiseGenerator const> fLineNoise; // shared by all the algorithms
   }; //class DigiArapucaSBNDAlgMaker
 
 } //namespace
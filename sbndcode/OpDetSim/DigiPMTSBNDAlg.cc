@@ -38,8 +38,7 @@ namespace opdet {
     // TPB emission time histogram for pmt_coated histogram
     std::vector<double>* timeTPB_p;
     file->GetObject("timeTPB", timeTPB_p);
-    fTimeTPB = std::make_unique<CLHEP::RandGeneral>
-      (*fEngine, timeTPB_p->data(), timeTPB_p->size());
+    fTimeTPB = std::make_unique<AliasSampler>(*timeTPB_p);
 
     //shape of single pulse
     if (fParams.SinglePEmodel) {
@@ -71,224 +70,196 @@ namespace opdet {
   void DigiPMTSBNDAlg::ConstructWaveform(
     int ch,
     sim::SimPhotons const& simphotons,
-    std::vector<short unsigned int>& waveform,
+    std::vector<raw::ADC_Count_t>& waveform,
     std::string pdtype,
     double start_time,
     unsigned n_sample)
   {
-    std::vector<double> waves(n_sample, fParams.PMTBaseline);
-    CreatePDWaveform(simphotons, start_time, waves, ch, pdtype);
-    waveform = std::vector<short unsigned int> (waves.begin(), waves.end());
+    fWave.assign(n_sample, fParams.PMTBaseline);
+    CreatePDWaveform(simphotons, start_time, fWave, ch, pdtype);
+    Digitize(fWave, waveform);
   }
 
   void DigiPMTSBNDAlg::ConstructWaveformCoatedPMT(
     int ch,
-    std::vector<short unsigned int>& waveform,
-    std::unordered_map<int, sim::SimPhotons>& DirectPhotonsMap,
-    std::unordered_map<int, sim::SimPhotons>& ReflectedPhotonsMap,
+    std::vector<raw::ADC_Count_t>& waveform,
+    sim::SimPhotons const* directPhotons,
+    sim::SimPhotons const* reflectedPhotons,
     double start_time,
     unsigned n_sample)
   {
-    std::vector<double> waves(n_sample, fParams.PMTBaseline);
-    CreatePDWaveformCoatedPMT(ch, start_time, waves, DirectPhotonsMap, ReflectedPhotonsMap);
-    waveform = std::vector<short unsigned int> (waves.begin(), waves.end());
+    fWave.assign(n_sample, fParams.PMTBaseline);
+    CreatePDWaveformCoatedPMT(ch, start_time, fWave, directPhotons, reflectedPhotons);
+    Digitize(fWave, waveform);
   }
 
 
   void DigiPMTSBNDAlg::ConstructWaveformLite(
     int ch,
-    sim::SimPhotonsLite const& litesimphotons,
-    std::vector<short unsigned int>& waveform,
+    PhotonLiteStore::Bins const& litesimphotons,
+    std::vector<raw::ADC_Count_t>& waveform,
     std::string pdtype,
     double start_time,
     unsigned n_sample)
   {
-    std::vector<double> waves(n_sample, fParams.PMTBaseline);
-    CreatePDWaveformLite(litesimphotons, start_time, waves, ch, pdtype);
-    waveform = std::vector<short unsigned int> (waves.begin(), waves.end());
+    fWave.assign(n_sample, fParams.PMTBaseline);
+    CreatePDWaveformLite(litesimphotons, start_time, fWave, ch, pdtype);
+    Digitize(fWave, waveform);
   }
 
 
   void DigiPMTSBNDAlg::ConstructWaveformLiteCoatedPMT(
     int ch,
-    std::vector<short unsigned int>& waveform,
-    std::unordered_map<int, sim::SimPhotonsLite>& DirectPhotonsMap,
-    std::unordered_map<int, sim::SimPhotonsLite>& ReflectedPhotonsMap,
+    std::vector<raw::ADC_Count_t>& waveform,
+    PhotonLiteStore::Bins const* directPhotons,
+    PhotonLiteStore::Bins const* reflectedPhotons,
     double start_time,
     unsigned n_sample)
   {
-    std::vector<double> waves(n_sample, fParams.PMTBaseline);
-    CreatePDWaveformLiteCoatedPMT(ch, start_time, waves, DirectPhotonsMap, ReflectedPhotonsMap);
-    waveform = std::vector<short unsigned int> (waves.begin(), waves.end());
+    fWave.assign(n_sample, fParams.PMTBaseline);
+    CreatePDWaveformLiteCoatedPMT(ch, start_time, fWave, directPhotons, reflectedPhotons);
+    Digitize(fWave, waveform);
   }
 
 
   void DigiPMTSBNDAlg::CreatePDWaveform(
     sim::SimPhotons const& simphotons,
     double t_min,
-    std::vector<double>& wave,
+    std::vector<float>& wave,
     int ch,
     std::string pdtype)
   {
-    double ttsTime = 0;
-    double tphoton;
-    size_t timeBin;
-    double ttpb=0;
-    for(size_t i = 0; i < simphotons.size(); i++) { //simphotons is here reflected light. To be added for all PMTs
-      if(CLHEP::RandFlat::shoot(fEngine, 1.0) < fQERefl) {
-        if(fParams.TTS > 0.0) ttsTime = Transittimespread(fParams.TTS);
-        ttpb = fTimeTPB->fire(); //for including TPB emission time
-        tphoton = ttsTime + simphotons[i].Time - t_min + ttpb + fParams.CableTime;
-        if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
-        timeBin = std::floor(tphoton*fSampling);
-        if(timeBin < wave.size()) {AddSPE(timeBin, wave);}
-      }
-    }
+    fPECounts.assign(wave.size(), 0);
+    //simphotons is here reflected light. To be added for all PMTs
+    SelectPhotons(simphotons, fQERefl, fParams.CableTime - t_min);
+    BinPhotons();
 
+    if(fParams.PMTDarkNoiseRate > 0.0) AddDarkNoise();
+    AddSPEs(wave);
     if(fParams.PMTBaselineRMS > 0.0) AddLineNoise(wave);
-    if(fParams.PMTDarkNoiseRate > 0.0) AddDarkNoise(wave);
-    CreateSaturation(wave);
   }
 
 
   void DigiPMTSBNDAlg::CreatePDWaveformCoatedPMT(
     int ch,
     double t_min,
-    std::vector<double>& wave,
-    std::unordered_map<int, sim::SimPhotons>& DirectPhotonsMap,
-    std::unordered_map<int, sim::SimPhotons>& ReflectedPhotonsMap)
+    std::vector<float>& wave,
+    sim::SimPhotons const* directPhotons,
+    sim::SimPhotons const* reflectedPhotons)
   {
-
-    double ttsTime = 0;
-    double tphoton;
-    size_t timeBin;
-    double ttpb=0;
-    sim::SimPhotons auxphotons;
-
+    fPECounts.assign(wave.size(), 0);
     //direct light
-    if(auto it{ DirectPhotonsMap.find(ch) }; it != std::end(DirectPhotonsMap) )
-    {auxphotons = it->second;}
-    for(size_t j = 0; j < auxphotons.size(); j++) { //auxphotons is direct light
-      if(CLHEP::RandFlat::shoot(fEngine, 1.0) < fQEDirect) {
-        if(fParams.TTS > 0.0) ttsTime = Transittimespread(fParams.TTS); //implementing transit time spread
-        ttpb = fTimeTPB->fire(); //for including TPB emission time
-        tphoton = ttsTime + auxphotons[j].Time - t_min + ttpb + fParams.CableTime;
-        if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
-        timeBin = std::floor(tphoton*fSampling);
-        if(timeBin < wave.size()) {AddSPE(timeBin, wave);}
-      }
-    }
+    if(directPhotons) SelectPhotons(*directPhotons, fQEDirect, fParams.CableTime - t_min);
     // reflected light
-    if(auto it{ ReflectedPhotonsMap.find(ch) }; it != std::end(ReflectedPhotonsMap) )
-    {auxphotons = it->second;}
-    for(size_t j = 0; j < auxphotons.size(); j++) { //auxphotons is now reflected light
-      if(CLHEP::RandFlat::shoot(fEngine, 1.0) < fQERefl) {
-        if(fParams.TTS > 0.0) ttsTime = Transittimespread(fParams.TTS); //implementing transit time spread
-        ttpb = fTimeTPB->fire(); //for including TPB emission time
-        tphoton = ttsTime + auxphotons[j].Time - t_min + ttpb + fParams.CableTime;
-        if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
-        timeBin = std::floor(tphoton*fSampling);
-        if(timeBin < wave.size()) {AddSPE(timeBin, wave);}
-      }
-    }
+    if(reflectedPhotons) SelectPhotons(*reflectedPhotons, fQERefl, fParams.CableTime - t_min);
+    BinPhotons();
 
-    //Adding noise and saturation
+    //Adding noise
+    if(fParams.PMTDarkNoiseRate > 0.0) AddDarkNoise();
+    AddSPEs(wave);
     if(fParams.PMTBaselineRMS > 0.0) AddLineNoise(wave);
-    if(fParams.PMTDarkNoiseRate > 0.0) AddDarkNoise(wave);
-    CreateSaturation(wave);
   }
 
 
   void DigiPMTSBNDAlg::CreatePDWaveformLite(
-    sim::SimPhotonsLite const& litesimphotons,
+    PhotonLiteStore::Bins const& litesimphotons,
     double t_min,
-    std::vector<double>& wave,
+    std::vector<float>& wave,
     int ch,
     std::string pdtype)
   {
-    double mean_photons;
-    size_t accepted_photons;
-    double ttsTime = 0;
-    double tphoton;
-    size_t timeBin;
-    double ttpb=0;
+    fPECounts.assign(wave.size(), 0);
     // reflected light to be added to all PMTs
-    std::map<int, int> const& photonMap = litesimphotons.DetectedPhotons;
-    for (auto const& reflectedPhotons : photonMap) {
-      // TODO: check that this new approach of not using the last
-      // (1-accepted_photons) doesn't introduce some bias. ~icaza
-      mean_photons = reflectedPhotons.second*fQERefl;
-      accepted_photons = CLHEP::RandPoissonQ::shoot(fEngine, mean_photons);
-      for(size_t i = 0; i < accepted_photons; i++) {
-        if(fParams.TTS > 0.0) ttsTime = Transittimespread(fParams.TTS);
-        ttpb = fTimeTPB->fire(); //for including TPB emission time
-        tphoton = ttsTime + reflectedPhotons.first - t_min + ttpb + fParams.CableTime;
-        if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
-        timeBin = std::floor(tphoton*fSampling);
-        if(timeBin < wave.size()) {AddSPE(timeBin, wave);}
-      }
-    }
+    SelectPhotonsLite(litesimphotons, fQERefl, fParams.CableTime - t_min);
+    BinPhotons();
 
+    if(fParams.PMTDarkNoiseRate > 0.0) AddDarkNoise();
+    AddSPEs(wave);
     if(fParams.PMTBaselineRMS > 0.0) AddLineNoise(wave);
-    if(fParams.PMTDarkNoiseRate > 0.0) AddDarkNoise(wave);
-    CreateSaturation(wave);
   }
 
 
   void DigiPMTSBNDAlg::CreatePDWaveformLiteCoatedPMT(
     int ch,
     double t_min,
-    std::vector<double>& wave,
-    std::unordered_map<int, sim::SimPhotonsLite>& DirectPhotonsMap,
-    std::unordered_map<int, sim::SimPhotonsLite>& ReflectedPhotonsMap)
+    std::vector<float>& wave,
+    PhotonLiteStore::Bins const* directPhotons,
+    PhotonLiteStore::Bins const* reflectedPhotons)
   {
-    double mean_photons;
-    size_t accepted_photons;
-    double ttsTime = 0;
-    double tphoton;
-    size_t timeBin;
-    double ttpb;
-
+    fPECounts.assign(wave.size(), 0);
     // direct light
-    if ( auto it{ DirectPhotonsMap.find(ch) }; it != std::end(DirectPhotonsMap) ){
-      for (auto& directPhotons : (it->second).DetectedPhotons) {
-        // TODO: check that this new approach of not using the last
-        // (1-accepted_photons) doesn't introduce some bias. ~icaza
-        mean_photons = directPhotons.second*fQEDirect;
-        accepted_photons = CLHEP::RandPoissonQ::shoot(fEngine, mean_photons);
-        for(size_t i = 0; i < accepted_photons; i++) {
-          if(fParams.TTS > 0.0) ttsTime = Transittimespread(fParams.TTS); //implementing transit time spread
-          ttpb = fTimeTPB->fire(); //for including TPB emission time
-          tphoton = ttsTime + directPhotons.first - t_min + ttpb + fParams.CableTime;
-          if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
-          timeBin = std::floor(tphoton*fSampling);
-          if(timeBin < wave.size()) {AddSPE(timeBin, wave);}
-        }
-      }
+    if(directPhotons) SelectPhotonsLite(*directPhotons, fQEDirect, fParams.CableTime - t_min);
+    // reflected light
+    if(reflectedPhotons) SelectPhotonsLite(*reflectedPhotons, fQERefl, fParams.CableTime - t_min);
+    BinPhotons();
+
+    //Adding noise
+    if(fParams.PMTDarkNoiseRate > 0.0) AddDarkNoise();
+    AddSPEs(wave);
+    if(fParams.PMTBaselineRMS > 0.0) AddLineNoise(wave);
+  }
+
+
+  void DigiPMTSBNDAlg::SelectPhotons(
+    sim::SimPhotons const& simphotons,
+    double qe,
+    double t_offset)
+  {
+    // one uniform number per photon, drawn in a single call
+    const size_t n = simphotons.size();
+    fRandom.resize(n);
+    CLHEP::RandFlat::shootArray(fEngine, n, fRandom.data());
+    for(size_t i = 0; i < n; i++) {
+      if(fRandom[i] < qe) fPhotonTimes.push_back(simphotons[i].Time + t_offset);
     }
+  }
 
-    // reflected light
-    if ( auto it{ ReflectedPhotonsMap.find(ch) }; it != std::end(ReflectedPhotonsMap) ){
-      for (auto& reflectedPhotons : (it->second).DetectedPhotons) {
-        // TODO: check that this new approach of not using the last
-        // (1-accepted_photons) doesn't introduce some bias. ~icaza
-        mean_photons = reflectedPhotons.second*fQERefl;
-        accepted_photons = CLHEP::RandPoissonQ::shoot(fEngine, mean_photons);
-        for(size_t i = 0; i < accepted_photons; i++) {
-          if(fParams.TTS > 0.0) ttsTime = Transittimespread(fParams.TTS); //implementing transit time spread
-          ttpb = fTimeTPB->fire(); //for including TPB emission time
-          tphoton = ttsTime + reflectedPhotons.first - t_min + ttpb + fParams.CableTime;
-          if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
-          timeBin = std::floor(tphoton*fSampling);
-          if(timeBin < wave.size()) {AddSPE(timeBin, wave);}
-        }
-      }
+
+  void DigiPMTSBNDAlg::SelectPhotonsLite(
+    PhotonLiteStore::Bins const& photonBins,
+    double qe,
+    double t_offset)
+  {
+    for (PhotonLiteBin const& photons : photonBins) {
+      // TODO: check that this new approach of not using the last
+      // (1-accepted_photons) doesn't introduce some bias. ~icaza
+      const size_t accepted_photons = CLHEP::RandPoissonQ::shoot(fEngine, photons.count*qe);
+      fPhotonTimes.insert(fPhotonTimes.end(), accepted_photons, photons.time + t_offset);
     }
+  }
 
-    //Adding noise and saturation
-    if(fParams.PMTBaselineRMS > 0.0) AddLineNoise(wave);
-    if(fParams.PMTDarkNoiseRate > 0.0) AddDarkNoise(wave);
-    CreateSaturation(wave);
+
+  void DigiPMTSBNDAlg::BinPhotons()
+  {
+    const size_t n = fPhotonTimes.size();
+    if(n == 0) return;
+
+    fRandom.resize(n);
+    if(fParams.TTS > 0.0) { //implementing transit time spread
+      CLHEP::RandGaussQ::shootArray(fEngine, n, fRandom.data(),
+                                    0, fParams.TTS / transitTimeSpread_frac);
+      for(size_t i = 0; i < n; i++) fPhotonTimes[i] += fRandom[i];
+    }
+    fTimeTPB->fireArray(*fEngine, n, fRandom.data()); //for including TPB emission time
+    for(size_t i = 0; i < n; i++) {
+      const double tphoton = fPhotonTimes[i] + fRandom[i];
+      if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
+      const size_t timeBin = std::floor(tphoton*fSampling);
+      if(timeBin < fPECounts.size()) fPECounts[timeBin]++;
+    }
+    fPhotonTimes.clear();
+  }
+
+
+  void DigiPMTSBNDAlg::AddSPEs(std::vector<float>& wave)
+  {
+    // the sum over the ticks is the convolution of the photoelectron
+    // counts with the single pe response; empty ticks are skipped, so
+    // that the cost follows the occupancy rather than the number of
+    // photons or of samples
+    for(size_t timeBin = 0; timeBin < fPECounts.size(); timeBin++) {
+      if(fPECounts[timeBin] > 0) AddSPE(timeBin, wave, fPECounts[timeBin]);
+    }
   }
 
 
@@ -308,63 +279,43 @@ namespace opdet {
   }
 
 
-  double DigiPMTSBNDAlg::Transittimespread(double fwhm)
-  {
-    double tts, sigma;
-    sigma = fwhm / transitTimeSpread_frac;
-    tts = CLHEP::RandGaussQ::shoot(fEngine, 0, sigma);
-    return tts;
-  }
-
-
-  void DigiPMTSBNDAlg::AddSPE(size_t time_bin, std::vector<double>& wave)
+  void DigiPMTSBNDAlg::AddSPE(size_t time_bin, std::vector<float>& wave, double npe)
   {
     size_t max = time_bin + pulsesize < wave.size() ? time_bin + pulsesize : wave.size();
     auto min_it = std::next(wave.begin(), time_bin);
     auto max_it = std::next(wave.begin(), max);
     std::transform(min_it, max_it,
                    fSinglePEWave.begin(), min_it,
-                   std::plus<double>( ));
+                   [npe](double w, double spe) { return w + npe * spe; });
   }
 
 
-  void DigiPMTSBNDAlg::CreateSaturation(std::vector<double>& wave)
+  void DigiPMTSBNDAlg::Digitize(std::vector<float> const& wave,
+                                std::vector<raw::ADC_Count_t>& waveform) const
   {
-    std::replace_if(wave.begin(), wave.end(),
-                    [&](auto w){return w < saturation;}, saturation);
+    // saturation (the pulses are negative) and conversion in the same pass
+    waveform.resize(wave.size());
+    std::transform(wave.begin(), wave.end(), waveform.begin(),
+                   [this](float w) -> raw::ADC_Count_t {
+                     return (w < saturation)? saturation: w; });
   }
 
 
-  void DigiPMTSBNDAlg::AddLineNoise(std::vector<double>& wave)
+  void DigiPMTSBNDAlg::AddLineNoise(std::vector<float>& wave)
   {
-    // TODO: after running the profiler I can see that this is where
-    // most cycles are being used.  Potentially some improvement could
-    // be achieved with the below code but the array dynamic allocation
-    // is not helping. The function would need to have it passed.
-    // ~icaza
-    //
-    // double *array = new double[wave.size()]();
-    // CLHEP::RandGaussQ::shootArray(fEngine, wave.size(), array, 0, fParams.PMTBaselineRMS);
-    // for(size_t i = 0; i<wave.size(); i++) {
-    //   wave[i] += array[i];
-    // }
-    // delete array;
-    //
-    std::transform(wave.begin(), wave.end(), wave.begin(),
-                   [this](double w) -> double {
-                     return w + CLHEP::RandGaussQ::shoot(fEngine, 0, fParams.PMTBaselineRMS) ; });
+    fParams.lineNoise->AddNoise(*fEngine, fParams.PMTBaselineRMS, wave);
   }
 
 
-  void DigiPMTSBNDAlg::AddDarkNoise(std::vector<double>& wave)
+  void DigiPMTSBNDAlg::AddDarkNoise()
   {
     size_t timeBin;
     // Multiply by 10^9 since fParams.DarkNoiseRate is in Hz (conversion from s to ns)
     double mean =  1000000000.0 / fParams.PMTDarkNoiseRate;
     double darkNoiseTime = CLHEP::RandExponential::shoot(fEngine, mean);
-    while(darkNoiseTime < wave.size()) {
+    while(darkNoiseTime < fPECounts.size()) {
       timeBin = std::round(darkNoiseTime);
-      if(timeBin < wave.size()) {AddSPE(timeBin, wave);}
+      if(timeBin < fPECounts.size()) fPECounts[timeBin]++;
       // Find next time to add dark noise
       darkNoiseTime += CLHEP::RandExponential::shoot(fEngine, mean);
     }
@@ -462,6 +413,7 @@ namespace opdet {
     fBaseConfig.TTS                      = config.tts();
     fBaseConfig.CableTime                = config.cableTime();
     fBaseConfig.PMTDataFile              = config.pmtDataFile();
+    fLineNoise = std::make_shared<OpDetNoiseGenerator const>(config.lineNoise());
   }
 
   std::unique_ptr<DigiPMTSBNDAlg>
@@ -478,6 +430,7 @@ namespace opdet {
     params.larProp = &larProp;
     params.frequency = clockData.OpticalClock().Frequency();
     params.engine = engine;
+    params.lineNoise = fLineNoise.get();
 
     return std::make_unique<DigiPMTSBNDAlg>(params);
   } // DigiPMTSBNDAlgMaker::create()
@@ -10,11 +10,11 @@
 #define SBND_OPDETSIM_DIGIPMTSBNDALG_HH
 
 #include "fhiclcpp/types/Atom.h"
+#include "fhiclcpp/types/Table.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 #include "nurandom/RandomUtils/NuRandomService.h"
 #include "CLHEP/Random/RandFlat.h"
 #include "CLHEP/Random/RandGaussQ.h"
-#include "CLHEP/Random/RandGeneral.h"
 #include "CLHEP/Random/RandPoissonQ.h"
 #include "CLHEP/Random/RandExponential.h"
 
@@ -36,6 +36,10 @@
 
 #include "TFile.h"
 
+#include "sbndcode/OpDetSim/AliasSampler.hh"
+#include "sbndcode/OpDetSim/OpDetNoiseGenerator.hh"
+#include "sbndcode/OpDetSim/PhotonLiteStore.hh"
+
 namespace opdet {
 
   class DigiPMTSBNDAlg {
@@ -62,6 +66,7 @@ namespace opdet {
       detinfo::LArProperties const* larProp = nullptr; //< LarProperties service provider.
       double frequency;       //wave sampling frequency (GHz)
       CLHEP::HepRandomEngine* engine = nullptr;
+      OpDetNoiseGenerator const* lineNoise = nullptr;
     };// ConfigurationParameters_t
 
     //Default constructor
@@ -72,32 +77,32 @@ namespace opdet {
     void ConstructWaveform(
       int ch,
       sim::SimPhotons const& simphotons,
-      std::vector<short unsigned int>& waveform,
+      std::vector<raw::ADC_Count_t>& waveform,
       std::string pdtype,
       double start_time,
       unsigned n_sample);
 
     void ConstructWaveformCoatedPMT(
       int ch,
-      std::vector<short unsigned int>& waveform,
-      std::unordered_map<int, sim::SimPhotons>& DirectPhotonsMap,
-      std::unordered_map<int, sim::SimPhotons>& ReflectedPhotonsMap,
+      std::vector<raw::ADC_Count_t>& waveform,
+      sim::SimPhotons const* directPhotons,
+      sim::SimPhotons const* reflectedPhotons,
       double start_time,
       unsigned n_sample);
 
     void ConstructWaveformLite(
       int ch,
-      sim::SimPhotonsLite const& litesimphotons,
-      std::vector<short unsigned int>& waveform,
+      PhotonLiteStore::Bins const& litesimphotons,
+      std::vector<raw::ADC_Count_t>& waveform,
       std::string pdtype,
       double start_time,
       unsigned n_sample);
 
     void ConstructWaveformLiteCoatedPMT(
       int ch,
-      std::vector<short unsigned int>& waveform,
-      std::unordered_map<int, sim::SimPhotonsLite>& DirectPhotonsMap,
-      std::unordered_map<int, sim::SimPhotonsLite>& ReflectedPhotonsMap,
+      std::vector<raw::ADC_Count_t>& waveform,
+      PhotonLiteStore::Bins const* directPhotons,
+      PhotonLiteStore::Bins const* reflectedPhotons,
       double start_time,
       unsigned n_sample);
 
@@ -122,42 +127,56 @@ namespace opdet {
 
     CLHEP::HepRandomEngine* fEngine; //!< Reference to art-managed random-number engine
 
-    void AddSPE(size_t time_bin, std::vector<double>& wave); // add single pulse to auxiliary waveform
+    void AddSPE(size_t time_bin, std::vector<float>& wave, double npe = 1.); // add npe single pulses to auxiliary waveform
     void Pulse1PE(std::vector<double>& wave);
-    double Transittimespread(double fwhm);
 
     std::vector<double> fSinglePEWave; // single photon pulse vector
     int pulsesize; //size of 1PE waveform
-    std::unique_ptr<CLHEP::RandGeneral> fTimeTPB; // histogram for getting the TPB emission time for coated PMTs
+    std::unique_ptr<AliasSampler> fTimeTPB; // histogram for getting the TPB emission time for coated PMTs
     std::unordered_map< raw::Channel_t, std::vector<double> > fFullWaveforms;
 
+    // The photons of a channel are first collected in fPhotonTimes (after
+    // the quantum efficiency), then all their time smearings are drawn at
+    // once and they are counted per tick in fPECounts, together with the
+    // dark noise; the pulses are added to the waveform from the counts.
+    std::vector<double> fPhotonTimes; // arrival times of the accepted photons, w.r.t. the waveform start
+    std::vector<double> fRandom;      // buffer for the random numbers drawn in bulk
+    std::vector<unsigned int> fPECounts; // photoelectrons per tick
+    std::vector<float> fWave; // waveform being built, before digitization
+
+    void SelectPhotons(sim::SimPhotons const& simphotons, double qe, double t_offset);
+    void SelectPhotonsLite(PhotonLiteStore::Bins const& photonBins, double qe, double t_offset);
+    void BinPhotons(); // add transit time spread and TPB emission time and fill fPECounts
+    void AddSPEs(std::vector<float>& wave); // add the pulses of fPECounts to the waveform
+
     void CreatePDWaveform(
       sim::SimPhotons const& SimPhotons,
       double t_min,
-      std::vector<double>& wave,
+      std::vector<float>& wave,
       int ch,
       std::string pdtype);
     void CreatePDWaveformCoatedPMT(
       int ch,
       double t_min,
-      std::vector<double>& wave,
-      std::unordered_map<int, sim::SimPhotons>& DirectPhotonsMap,
-      std::unordered_map<int, sim::SimPhotons>& ReflectedPhotonsMap);
+      std::vector<float>& wave,
+      sim::SimPhotons const* directPhotons,
+      sim::SimPhotons const* reflectedPhotons);
     void CreatePDWaveformLite(
-      sim::SimPhotonsLite const& litesimphotons,
+      PhotonLiteStore::Bins const& litesimphotons,
       double t_min,
-      std::vector<double>& wave,
+      std::vector<float>& wave,
       int ch,
       std::string pdtype);
     void CreatePDWaveformLiteCoatedPMT(
       int ch,
       double t_min,
-      std::vector<double>& wave,
-      std::unordered_map<int, sim::SimPhotonsLite>& DirectPhotonsMap,
-      std::unordered_map<int, sim::SimPhotonsLite>& ReflectedPhotonsMap);
-    void CreateSaturation(std::vector<double>& wave);//Including saturation effects
-    void AddLineNoise(std::vector<double>& wave); //add noise to baseline
-    void AddDarkNoise(std::vector<double>& wave); //add dark noise
+      std::vector<float>& wave,
+      PhotonLiteStore::Bins const* directPhotons,
+      PhotonLiteStore::Bins const* reflectedPhotons);
+    void Digitize(std::vector<float> const& wave,
+                  std::vector<raw::ADC_Count_t>& waveform) const; //Including saturation effects
+    void AddLineNoise(std::vector<float>& wave); //add noise to baseline
+    void AddDarkNoise(); //add dark noise to fPECounts
     double FindMinimumTime(
       sim::SimPhotons const&,
       int ch,
@@ -251,6 +270,11 @@ namespace opdet {
         Name("PMTDataFile"),
         Comment("File containing timing emission distribution for TPB and single pe pulse from data")
       };
+
+      fhicl::Table<OpDetNoiseGenerator::Config> lineNoise {
+        Name("PMTLineNoise"),
+        Comment("Line noise generator of the PMTs")
+      };
     };    //struct Config
 
     DigiPMTSBNDAlgMaker(Config const& config); //Constructor
@@ -264,6 +288,7 @@ namespace opdet {
   private:
     // Part of the configuration learned from configuration files.
     DigiPMTSBNDAlg::ConfigurationParameters_t fBaseConfig;
+    std::shared_ptr<OpDetNoiseGenerator const> fLineNoise; // shared by all the algorithms
   }; //class DigiPMTSBNDAlgMaker
 
 } // namespace opdet
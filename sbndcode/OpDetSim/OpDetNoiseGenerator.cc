@@ -0,0 +1,151 @@
+#include "sbndcode/OpDetSim/OpDetNoiseGenerator.hh"
+
+#include "CLHEP/Random/RandGaussQ.h"
+#include "CLHEP/Random/RandomEngine.h"
+#include "cetlib_except/exception.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+//------------------------------------------------------------------------------
+//--- opdet::ZigguratNormal implementation
+//------------------------------------------------------------------------------
+
+namespace opdet {
+
+  namespace {
+
+    // Ziggurat tables (Marsaglia and Tsang, J. Stat. Softw. 5 (2000) 8)
+    struct ZigguratTables {
+      static constexpr double R = 3.442619855899; // start of the tail
+      std::array<std::uint32_t, 128> kn;
+      std::array<double, 128> wn;
+      std::array<double, 128> fn;
+
+      ZigguratTables()
+        {
+          const double m1 = 2147483648.0; // 2^31
+          const double vn = 9.91256303526217e-3;
+          double dn = R, tn = R;
+          const double q = vn / std::exp(-0.5 * dn * dn);
+          kn[0] = (dn / q) * m1;
+          kn[1] = 0;
+          wn[0] = q / m1;
+          wn[127] = dn / m1;
+          fn[0] = 1.0;
+          fn[127] = std::exp(-0.5 * dn * dn);
+          for (int i = 126; i >= 1; i--) {
+            dn = std::sqrt(-2.0 * std::log(vn / dn + std::exp(-0.5 * dn * dn)));
+            kn[i + 1] = (dn / tn) * m1;
+            tn = dn;
+            fn[i] = std::exp(-0.5 * dn * dn);
+            wn[i] = dn / m1;
+          }
+        }
+    }; // struct ZigguratTables
+
+    ZigguratTables const& Tables()
+    {
+      static ZigguratTables const tables;
+      return tables;
+    }
+
+  } // local namespace
+
+
+  double ZigguratNormal::operator()()
+  {
+    ZigguratTables const& t = Tables();
+    // the layer comes from the low bits, the abscissa from the high ones
+    const std::uint64_t r = fRNG();
+    const std::int64_t hz = static_cast<std::int32_t>(r >> 32);
+    const unsigned int iz = r & 127;
+    if (static_cast<std::uint64_t>(std::abs(hz)) < t.kn[iz]) return hz * t.wn[iz];
+    return Tail(hz, iz);
+  }
+
+
+  double ZigguratNormal::Tail(std::int64_t hz, unsigned int iz)
+  {
+    ZigguratTables const& t = Tables();
+    for (;;) {
+      const double x = hz * t.wn[iz];
+      if (iz == 0) { // base strip: sample the tail beyond R
+        double xt, y;
+        do {
+          xt = -std::log(fRNG.Uniform()) / ZigguratTables::R;
+          y = -std::log(fRNG.Uniform());
+        } while (y + y < xt * xt);
+        return (hz > 0)? ZigguratTables::R + xt: -ZigguratTables::R - xt;
+      }
+      if (t.fn[iz] + fRNG.Uniform() * (t.fn[iz - 1] - t.fn[iz]) < std::exp(-0.5 * x * x))
+        return x;
+
+      const std::uint64_t r = fRNG();
+      hz = static_cast<std::int32_t>(r >> 32);
+      iz = r & 127;
+      if (static_cast<std::uint64_t>(std::abs(hz)) < t.kn[iz]) return hz * t.wn[iz];
+    }
+  }
+
+  //------------------------------------------------------------------------------
+  //--- opdet::OpDetNoiseGenerator implementation
+  //------------------------------------------------------------------------------
+
+  OpDetNoiseGenerator::OpDetNoiseGenerator(Config const& config)
+    : fSegmentLength(config.segmentLength())
+  {
+    const std::string mode = config.mode();
+    if (mode == "ziggurat") fMode = Mode::kZiggurat;
+    else if (mode == "bank") fMode = Mode::kBank;
+    else if (mode == "gauss") fMode = Mode::kGaussQ;
+    else {
+      throw cet::exception("OpDetNoiseGenerator")
+        << "Unknown line noise mode '" << mode
+        << "' (expected \"ziggurat\", \"bank\" or \"gauss\")\n";
+    }
+
+    if (fMode == Mode::kBank) {
+      if (fSegmentLength == 0 || config.bankSize() < fSegmentLength) {
+        throw cet::exception("OpDetNoiseGenerator")
+          << "Line noise bank of " << config.bankSize()
+          << " samples can't hold segments of " << fSegmentLength << "\n";
+      }
+      ZigguratNormal normal(config.bankSeed());
+      fBank.resize(config.bankSize());
+      std::generate(fBank.begin(), fBank.end(), normal);
+    }
+  }
+
+
+  void OpDetNoiseGenerator::AddNoise(CLHEP::HepRandomEngine& engine, double rms,
+                                     std::vector<float>& wave) const
+  {
+    if (fMode == Mode::kGaussQ) {
+      for (float& w : wave) w += CLHEP::RandGaussQ::shoot(&engine, 0, rms);
+      return;
+    }
+
+    // the engine is seeded per channel: so is the key; the two draws are
+    // sequenced, as the operands of | are not
+    const std::uint64_t keyHigh = static_cast<unsigned int>(engine);
+    const std::uint64_t keyLow = static_cast<unsigned int>(engine);
+    const std::uint64_t key = (keyHigh << 32) | keyLow;
+    ZigguratNormal normal(key);
+
+    if (fMode == Mode::kZiggurat) {
+      for (float& w : wave) w += rms * normal();
+      return;
+    }
+
+    const std::size_t nOffsets = fBank.size() - fSegmentLength + 1;
+    for (std::size_t start = 0; start < wave.size(); start += fSegmentLength) {
+      const std::size_t n = std::min(fSegmentLength, wave.size() - start);
+      auto const segment = fBank.begin() + normal.RNG()() % nOffsets;
+      std::transform(segment, segment + n, wave.begin() + start, wave.begin() + start,
+                     [rms](float noise, float w) { return w + rms * noise; });
+    }
+  }
+
+} // namespace opdet
@@ -0,0 +1,139 @@
+////////////////////////////////////////////////////////////////////////
+// File:        OpDetNoiseGenerator.hh
+//
+// Gaussian line noise for the optical digitizers (DigiPMTSBNDAlg and
+// DigiArapucaSBNDAlg), added to a whole waveform buffer at once.
+//
+// Modes (LineNoise.Mode):
+//  - "ziggurat": normal numbers from the Ziggurat method of Marsaglia and
+//    Tsang, over a counter-based generator (SplitMix64 of a key and of
+//    the sample counter). The key is drawn from the engine of the
+//    digitizer, which is seeded per channel, so the noise of a channel
+//    depends only on the event seeds and on the channel number;
+//  - "bank": segments of a bank of normal numbers, computed once per job
+//    from BankSeed, copied from random offsets drawn as above;
+//  - "gauss": one CLHEP::RandGaussQ call per sample from the engine of
+//    the digitizer, as done before this class existed.
+//
+// The generator is not modified when adding noise, so one object can be
+// shared by the digitizers of all the threads.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBND_OPDETSIM_OPDETNOISEGENERATOR_HH
+#define SBND_OPDETSIM_OPDETNOISEGENERATOR_HH
+
+#include "fhiclcpp/types/Atom.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace CLHEP {
+  class HepRandomEngine;
+}
+
+namespace opdet {
+
+  // Counter-based random numbers: the n-th number of a stream is a hash
+  // of the stream key and of n
+  class CounterRNG {
+
+  public:
+
+    explicit CounterRNG(std::uint64_t key): fKey(Mix(key)) {}
+
+    std::uint64_t operator()() { return Mix(fKey + (++fCounter) * 0x9E3779B97F4A7C15ULL); }
+
+    // uniform in (0, 1)
+    double Uniform() { return ((*this)() >> 11) * 0x1.0p-53 + 0x1.0p-54; }
+
+  private:
+
+    static std::uint64_t Mix(std::uint64_t z)
+      {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+      }
+
+    std::uint64_t fKey;
+    std::uint64_t fCounter = 0;
+
+  }; // class CounterRNG
+
+
+  // Standard normal numbers with the 128-layer Ziggurat method
+  class ZigguratNormal {
+
+  public:
+
+    explicit ZigguratNormal(std::uint64_t key): fRNG(key) {}
+
+    double operator()();
+
+    CounterRNG& RNG() { return fRNG; }
+
+  private:
+
+    double Tail(std::int64_t hz, unsigned int iz);
+
+    CounterRNG fRNG;
+
+  }; // class ZigguratNormal
+
+
+  class OpDetNoiseGenerator {
+
+  public:
+
+    enum class Mode { kZiggurat, kBank, kGaussQ };
+
+    struct Config {
+      using Name = fhicl::Name;
+      using Comment = fhicl::Comment;
+
+      fhicl::Atom<std::string> mode {
+        Name("Mode"),
+        Comment("Line noise generator: \"ziggurat\", \"bank\" or \"gauss\" (one CLHEP call per sample)"),
+        "ziggurat"
+      };
+
+      fhicl::Atom<unsigned int> bankSize {
+        Name("BankSize"),
+        Comment("Number of noise samples precomputed for the \"bank\" mode"),
+        1048576
+      };
+
+      fhicl::Atom<unsigned int> segmentLength {
+        Name("SegmentLength"),
+        Comment("Number of consecutive samples copied from one random offset of the bank"),
+        1024
+      };
+
+      fhicl::Atom<unsigned long> bankSeed {
+        Name("BankSeed"),
+        Comment("Key of the random numbers of the bank"),
+        20201001
+      };
+    }; // struct Config
+
+    explicit OpDetNoiseGenerator(Config const& config);
+
+    // add noise of the given RMS to all the samples of wave, with random
+    // numbers from engine (just one for the key, unless in "gauss" mode)
+    void AddNoise(CLHEP::HepRandomEngine& engine, double rms,
+                  std::vector<float>& wave) const;
+
+    Mode GetMode() const { return fMode; }
+
+  private:
+
+    Mode fMode;
+    std::size_t fSegmentLength;
+    std::vector<float> fBank; // unit normal samples
+
+  }; // class OpDetNoiseGenerator
+
+} // namespace opdet
+
+#endif // SBND_OPDETSIM_OPDETNOISEGENERATOR_HH
@@ -0,0 +1,33 @@
+#include "sbndcode/OpDetSim/OpHitPeakFinder.hh"
+
+#include <algorithm>
+
+namespace opdet {
+
+  void FindOpHitPeaks(std::vector<float> const& waveform, double threshold,
+                      std::vector<OpHitPeak>& peaks)
+  {
+    peaks.clear();
+    const std::size_t n = waveform.size();
+    std::size_t i = 0;
+    while (i < n) {
+      if (waveform[i] < threshold) { ++i; continue; }
+      // sum in time order, as std::accumulate over the peak did
+      OpHitPeak peak { i, waveform[i], 0.0, i, i };
+      for (; i < n && !(waveform[i] < threshold); ++i) {
+        if (waveform[i] > peak.amplitude) {
+          peak.amplitude = waveform[i];
+          peak.timebin = i;
+        }
+        peak.sum += waveform[i];
+      }
+      peak.end = i;
+      peaks.push_back(peak);
+    }
+
+    // found in time order: a stable sort keeps it for equal amplitudes
+    std::stable_sort(peaks.begin(), peaks.end(), [](OpHitPeak const& a, OpHitPeak const& b)
+                     { return a.amplitude > b.amplitude; });
+  }
+
+} // namespace opdet
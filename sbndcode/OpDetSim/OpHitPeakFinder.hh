@@ -0,0 +1,37 @@
+////////////////////////////////////////////////////////////////////////
+// File:        OpHitPeakFinder.hh
+//
+// Peak finding of opHitFinderSBND, in one pass over the waveform.
+//
+// A peak is a maximal range of consecutive samples at or above the
+// threshold; its amplitude is the largest sample and its time the first
+// tick with that value. The peaks are returned in the order the previous
+// implementation extracted them, which looked for the maximum of the
+// whole waveform and zeroed its peak until the maximum was below
+// threshold: by decreasing amplitude, ties in order of time. With a
+// positive threshold the peaks found are the same, with the same sums.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBND_OPDETSIM_OPHITPEAKFINDER_HH
+#define SBND_OPDETSIM_OPHITPEAKFINDER_HH
+
+#include <cstddef>
+#include <vector>
+
+namespace opdet {
+
+  struct OpHitPeak {
+    std::size_t timebin; // tick of the maximum
+    double amplitude;    // value of the maximum
+    double sum;          // sum of the samples of the peak, in ADC*tick
+    std::size_t start;   // first tick of the peak
+    std::size_t end;     // tick after the last one of the peak
+  };
+
+  // replace peaks with the peaks of waveform above threshold
+  void FindOpHitPeaks(std::vector<float> const& waveform, double threshold,
+                      std::vector<OpHitPeak>& peaks);
+
+} // namespace opdet
+
+#endif // SBND_OPDETSIM_OPHITPEAKFINDER_HH
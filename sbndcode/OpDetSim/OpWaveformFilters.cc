@@ -0,0 +1,226 @@
+#include "sbndcode/OpDetSim/OpWaveformFilters.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace opdet {
+
+  double WindowBaseline(std::vector<raw::ADC_Count_t> const& adcs, std::size_t nSamples)
+  {
+    nSamples = std::min(nSamples, adcs.size());
+    if (nSamples == 0) return 0.0;
+    return std::accumulate(adcs.begin(), adcs.begin() + nSamples, 0.0) / nSamples;
+  }
+
+
+  double HistogramModeBaseline(std::vector<raw::ADC_Count_t> const& adcs)
+  {
+    if (adcs.empty()) return 0.0;
+    auto const range = std::minmax_element(adcs.begin(), adcs.end());
+    const int min = *range.first;
+    std::vector<unsigned int> counts(*range.second - min + 1, 0);
+    for (raw::ADC_Count_t adc : adcs) ++counts[adc - min];
+
+    const std::size_t mode = std::distance(counts.begin(), std::max_element(counts.begin(), counts.end()));
+    // center of mass of the mode and its neighbours, for sub-ADC resolution
+    double sum = 0.0, weight = 0.0;
+    for (std::size_t i = (mode > 0)? mode - 1: 0; i <= mode + 1 && i < counts.size(); ++i) {
+      sum += double(counts[i]) * i;
+      weight += counts[i];
+    }
+    return min + sum / weight;
+  }
+
+
+  void RollingMedianBaseline(std::vector<raw::ADC_Count_t> const& adcs,
+                             std::size_t halfWindow, std::vector<float>& baseline)
+  {
+    const std::size_t n = adcs.size();
+    baseline.resize(n);
+    if (n == 0) return;
+
+    // histogram of the samples in the window: the median moves by a few
+    // ADC from one tick to the next, and so does the search for it
+    auto const range = std::minmax_element(adcs.begin(), adcs.end());
+    const int min = *range.first;
+    std::vector<unsigned int> counts(*range.second - min + 1, 0);
+
+    std::size_t median = 0;  // median, w.r.t. min
+    std::size_t nBelow = 0;  // samples in the window below the median
+    std::size_t inWindow = 0;
+    std::size_t first = 0, last = 0; // window is [first, last)
+    for (std::size_t i = 0; i < n; ++i) {
+      const std::size_t newFirst = (i > halfWindow)? i - halfWindow: 0;
+      const std::size_t newLast = std::min(n, i + halfWindow + 1);
+      for (; last < newLast; ++last) {
+        const std::size_t v = adcs[last] - min;
+        ++counts[v];
+        if (v < median) ++nBelow;
+        ++inWindow;
+      }
+      for (; first < newFirst; ++first) {
+        const std::size_t v = adcs[first] - min;
+        --counts[v];
+        if (v < median) --nBelow;
+        --inWindow;
+      }
+      // lower median: the smallest value with at least half the samples
+      // at or below it
+      const std::size_t target = (inWindow + 1) / 2;
+      while (nBelow + counts[median] < target) nBelow += counts[median++];
+      while (nBelow >= target) nBelow -= counts[--median];
+      baseline[i] = min + median;
+    }
+  }
+
+
+  void TV1DDenoiser::operator()(std::vector<float>& wave)
+  {
+    // The lower and upper bounds of the taut string are kept as stacks of
+    // segments (start in fLowStart / fUpStart, value in the waveform at
+    // the start of the segment); each sample is pushed once and popped at
+    // most once, so the time is linear. Sample i is only read at step i,
+    // before anything at or after i is written, so the output can replace
+    // the input.
+    if (wave.size() < 2) return;
+    float* const output = wave.data();
+    const std::size_t width = wave.size() - 1;
+    const double lambda = fLambda;
+    const double twolambda = 2.0 * lambda;
+    fLowStart.resize(wave.size());
+    fUpStart.resize(wave.size());
+    std::size_t* const indstart_low = fLowStart.data();
+    std::size_t* const indstart_up = fUpStart.data();
+
+    std::size_t j_low = 0, j_up = 0, jseg = 0, indjseg = 0, i = 1, indjseg2, ind;
+    double output_low_first = output[0] - lambda;
+    double output_low_curr = output_low_first;
+    double output_up_first = output[0] + lambda;
+    double output_up_curr = output_up_first;
+    indstart_low[0] = 0;
+    indstart_up[0] = 0;
+    for (; i < width; i++) {
+      const double input = output[i];
+      if (input >= output_low_curr) {
+        if (input <= output_up_curr) {
+          output_up_curr += (input - output_up_curr) / (i - indstart_up[j_up] + 1);
+          output[indjseg] = output_up_first;
+          while ((j_up > jseg) && (output_up_curr <= output[ind = indstart_up[j_up - 1]]))
+            output_up_curr += (output[ind] - output_up_curr) *
+                              ((double)(indstart_up[j_up--] - ind) / (i - ind + 1));
+          if (j_up == jseg) {
+            while ((output_up_curr <= output_low_first) && (jseg < j_low)) {
+              indjseg2 = indstart_low[++jseg];
+              output_up_curr += (output_up_curr - output_low_first) *
+                                ((double)(indjseg2 - indjseg) / (i - indjseg2 + 1));
+              while (indjseg < indjseg2) output[indjseg++] = output_low_first;
+              output_low_first = output[indjseg];
+            }
+            output_up_first = output_up_curr;
+            indstart_up[j_up = jseg] = indjseg;
+          }
+          else output[indstart_up[j_up]] = output_up_curr;
+        }
+        else {
+          indstart_up[++j_up] = i;
+          output_up_curr = output[i] = input;
+        }
+        output_low_curr += (input - output_low_curr) / (i - indstart_low[j_low] + 1);
+        output[indjseg] = output_low_first;
+        while ((j_low > jseg) && (output_low_curr >= output[ind = indstart_low[j_low - 1]]))
+          output_low_curr += (output[ind] - output_low_curr) *
+                             ((double)(indstart_low[j_low--] - ind) / (i - ind + 1));
+        if (j_low == jseg) {
+          while ((output_low_curr >= output_up_first) && (jseg < j_up)) {
+            indjseg2 = indstart_up[++jseg];
+            output_low_curr += (output_low_curr - output_up_first) *
+                               ((double)(indjseg2 - indjseg) / (i - indjseg2 + 1));
+            while (indjseg < indjseg2) output[indjseg++] = output_up_first;
+            output_up_first = output[indjseg];
+          }
+          if ((indstart_low[j_low = jseg] = indjseg) == i) output_low_first = output_up_first - twolambda;
+          else output_low_first = output_low_curr;
+        }
+        else output[indstart_low[j_low]] = output_low_curr;
+      }
+      else {
+        indstart_low[++j_low] = i;
+        output_up_curr += ((output_low_curr = output[i] = input) - output_up_curr)
+                          / (i - indstart_up[j_up] + 1);
+        output[indjseg] = output_up_first;
+        while ((j_up > jseg) && (output_up_curr <= output[ind = indstart_up[j_up - 1]]))
+          output_up_curr += (output[ind] - output_up_curr) *
+                            ((double)(indstart_up[j_up--] - ind) / (i - ind + 1));
+        if (j_up == jseg) {
+          while ((output_up_curr <= output_low_first) && (jseg < j_low)) {
+            indjseg2 = indstart_low[++jseg];
+            output_up_curr += (output_up_curr - output_low_first) *
+                              ((double)(indjseg2 - indjseg) / (i - indjseg2 + 1));
+            while (indjseg < indjseg2) output[indjseg++] = output_low_first;
+            output_low_first = output[indjseg];
+          }
+          if ((indstart_up[j_up = jseg] = indjseg) == i) output_up_first = output_low_first + twolambda;
+          else output_up_first = output_up_curr;
+        }
+        else output[indstart_up[j_up]] = output_up_curr;
+      }
+    }
+
+    // here i == width, the last sample
+    const double input = output[i];
+    if (input + lambda <= output_low_curr) {
+      while (jseg < j_low) {
+        indjseg2 = indstart_low[++jseg];
+        while (indjseg < indjseg2) output[indjseg++] = output_low_first;
+        output_low_first = output[indjseg];
+      }
+      while (indjseg < i) output[indjseg++] = output_low_first;
+      output[indjseg] = input + lambda;
+    }
+    else if (input - lambda >= output_up_curr) {
+      while (jseg < j_up) {
+        indjseg2 = indstart_up[++jseg];
+        while (indjseg < indjseg2) output[indjseg++] = output_up_first;
+        output_up_first = output[indjseg];
+      }
+      while (indjseg < i) output[indjseg++] = output_up_first;
+      output[indjseg] = input - lambda;
+    }
+    else {
+      output_low_curr += (input + lambda - output_low_curr) / (i - indstart_low[j_low] + 1);
+      output[indjseg] = output_low_first;
+      while ((j_low > jseg) && (output_low_curr >= output[ind = indstart_low[j_low - 1]]))
+        output_low_curr += (output[ind] - output_low_curr) *
+                           ((double)(indstart_low[j_low--] - ind) / (i - ind + 1));
+      if (j_low == jseg) {
+        if (output_up_first >= output_low_curr)
+          while (indjseg <= i) output[indjseg++] = output_low_curr;
+        else {
+          output_up_curr += (input - lambda - output_up_curr) / (i - indstart_up[j_up] + 1);
+          output[indjseg] = output_up_first;
+          while ((j_up > jseg) && (output_up_curr <= output[ind = indstart_up[j_up - 1]]))
+            output_up_curr += (output[ind] - output_up_curr) *
+                              ((double)(indstart_up[j_up--] - ind) / (i - ind + 1));
+          while (jseg < j_up) {
+            indjseg2 = indstart_up[++jseg];
+            while (indjseg < indjseg2) output[indjseg++] = output_up_first;
+            output_up_first = output[indjseg];
+          }
+          indjseg = indstart_up[j_up];
+          while (indjseg <= i) output[indjseg++] = output_up_curr;
+        }
+      }
+      else {
+        while (jseg < j_low) {
+          indjseg2 = indstart_low[++jseg];
+          while (indjseg < indjseg2) output[indjseg++] = output_low_first;
+          output_low_first = output[indjseg];
+        }
+        indjseg = indstart_low[j_low];
+        while (indjseg <= i) output[indjseg++] = output_low_curr;
+      }
+    }
+  }
+
+} // namespace opdet
@@ -0,0 +1,62 @@
+////////////////////////////////////////////////////////////////////////
+// File:        OpWaveformFilters.hh
+//
+// Baseline estimation and denoising of optical detector waveforms, as
+// used by opHitFinderSBND. All of them take linear time in the number of
+// samples and work on reusable buffers, the waveform itself being only
+// read once:
+//
+//  - WindowBaseline: mean of the first samples (the pre-trigger);
+//  - HistogramModeBaseline: most frequent ADC value of the waveform,
+//    which ignores the pulses as long as they are not most of the samples;
+//  - RollingMedianBaseline: median of a window centered on each tick, for
+//    baselines which drift; it is robust to pulses shorter than half the
+//    window, also at the start of the waveform;
+//  - TV1DDenoiser: total variation denoising, with the taut string
+//    algorithm of L. Condat ("A direct algorithm for 1D total variation
+//    denoising", IEEE Signal Proc. Letters 20 (2013) 1054, version of
+//    2017 with linear complexity), in place.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBND_OPDETSIM_OPWAVEFORMFILTERS_HH
+#define SBND_OPDETSIM_OPWAVEFORMFILTERS_HH
+
+#include "lardataobj/RawData/OpDetWaveform.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace opdet {
+
+  // mean of the first nSamples samples (all of them if fewer)
+  double WindowBaseline(std::vector<raw::ADC_Count_t> const& adcs, std::size_t nSamples);
+
+  // most frequent ADC value, refined with the two neighbouring values
+  double HistogramModeBaseline(std::vector<raw::ADC_Count_t> const& adcs);
+
+  // baseline[i] is the median of the samples within halfWindow ticks of i
+  void RollingMedianBaseline(std::vector<raw::ADC_Count_t> const& adcs,
+                             std::size_t halfWindow, std::vector<float>& baseline);
+
+
+  class TV1DDenoiser {
+
+  public:
+
+    explicit TV1DDenoiser(double lambda): fLambda(lambda) {}
+
+    // replace wave with its denoised version
+    void operator()(std::vector<float>& wave);
+
+    double Lambda() const { return fLambda; }
+
+  private:
+
+    double fLambda; // regularization parameter, in ADC
+    std::vector<std::size_t> fLowStart, fUpStart; // segment starts of the lower and upper strings
+
+  }; // class TV1DDenoiser
+
+} // namespace opdet
+
+#endif // SBND_OPDETSIM_OPWAVEFORMFILTERS_HH
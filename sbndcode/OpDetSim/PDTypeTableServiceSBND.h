@@ -0,0 +1,46 @@
+////////////////////////////////////////////////////////////////////////
+// File:        PDTypeTableServiceSBND.h
+//
+// art service holding the opdet::sbndPDTypeTable of the job, so that all
+// the modules share one copy, built when the service is created.
+//
+// Configuration: none (`PDTypeTableServiceSBND: {}`).
+//
+// Use as:
+//
+//     opdet::sbndPDTypeTable const& pdTypes
+//       = *lar::providerFrom<opdet::PDTypeTableServiceSBND>();
+//
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBND_OPDETSIM_PDTYPETABLESERVICESBND_H
+#define SBND_OPDETSIM_PDTYPETABLESERVICESBND_H
+
+#include "art/Framework/Services/Registry/ServiceDeclarationMacros.h"
+#include "fhiclcpp/ParameterSet.h"
+
+#include "sbndcode/OpDetSim/sbndPDTypeTable.hh"
+
+namespace opdet {
+
+  class PDTypeTableServiceSBND {
+
+  public:
+
+    using provider_type = sbndPDTypeTable;
+
+    explicit PDTypeTableServiceSBND(fhicl::ParameterSet const& pset);
+
+    provider_type const* provider() const { return &fTable; }
+
+  private:
+
+    sbndPDTypeTable fTable;
+
+  }; // class PDTypeTableServiceSBND
+
+} // namespace opdet
+
+DECLARE_ART_SERVICE(opdet::PDTypeTableServiceSBND, SHARED)
+
+#endif // SBND_OPDETSIM_PDTYPETABLESERVICESBND_H
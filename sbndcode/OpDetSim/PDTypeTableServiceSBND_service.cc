@@ -0,0 +1,12 @@
+#include "sbndcode/OpDetSim/PDTypeTableServiceSBND.h"
+
+#include "art/Framework/Services/Registry/ServiceDefinitionMacros.h"
+#include "larcore/CoreUtils/ServiceUtil.h"
+#include "larcore/Geometry/Geometry.h"
+
+opdet::PDTypeTableServiceSBND::PDTypeTableServiceSBND(fhicl::ParameterSet const&)
+  : fTable(lar::providerFrom<geo::Geometry>())
+{
+}
+
+DEFINE_ART_SERVICE(opdet::PDTypeTableServiceSBND)
@@ -0,0 +1,48 @@
+#include "sbndcode/OpDetSim/PhotonLiteStore.hh"
+
+namespace opdet {
+
+  void PhotonLiteStore::Fill(
+    std::vector<art::Handle<std::vector<sim::SimPhotonsLite>>> const& photon_handles,
+    unsigned nChannels)
+  {
+    // first pass: count the entries and the bins of each channel
+    std::vector<std::size_t> entryCursor(nChannels + 1, 0), binCursor(nChannels + 1, 0);
+    for (auto const& opdetHandle : photon_handles) {
+      for (auto const& litesimphotons : *opdetHandle) {
+        const unsigned ch = litesimphotons.OpChannel;
+        if (ch >= nChannels) continue;
+        entryCursor[ch + 1] += 1;
+        binCursor[ch + 1] += litesimphotons.DetectedPhotons.size();
+      }
+    }
+    for (unsigned ch = 0; ch < nChannels; ch++) {
+      entryCursor[ch + 1] += entryCursor[ch];
+      binCursor[ch + 1] += binCursor[ch];
+    }
+
+    fChannelStart = entryCursor;
+    fEntries.resize(entryCursor[nChannels]);
+    fBins.resize(binCursor[nChannels]);
+    fNPhotons.assign(nChannels, 0);
+
+    // second pass: copy, keeping the order of the collections
+    for (auto const& opdetHandle : photon_handles) {
+      // this now tells you if light collection is reflected
+      const bool Reflected = (opdetHandle.provenance()->productInstanceName() == "Reflected");
+      for (auto const& litesimphotons : *opdetHandle) {
+        const unsigned ch = litesimphotons.OpChannel;
+        if (ch >= nChannels) continue;
+        PhotonLiteBin* const first = fBins.data() + binCursor[ch];
+        PhotonLiteBin* bin = first;
+        for (auto const& timePhotons : litesimphotons.DetectedPhotons) {
+          *bin++ = { timePhotons.first, timePhotons.second };
+          fNPhotons[ch] += timePhotons.second;
+        }
+        binCursor[ch] += bin - first;
+        fEntries[entryCursor[ch]++] = { Bins(first, bin), Reflected };
+      }
+    }
+  }
+
+} // namespace opdet
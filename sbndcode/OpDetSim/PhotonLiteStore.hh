@@ -0,0 +1,95 @@
+////////////////////////////////////////////////////////////////////////
+// File:        PhotonLiteStore.hh
+//
+// The sim::SimPhotonsLite of all the input collections of an event,
+// copied once into contiguous arrays ordered by channel (a CSR layout):
+//
+//   channel -> entries (one per collection with photons on the channel,
+//              in collection order, flagged as reflected light or not)
+//   entry   -> time bins (time in ns, number of photons), in time order
+//
+// The digitizers read the photons through views into the store, so that
+// the photons of all the channels share one block of memory, filled
+// without per-channel allocations and read sequentially.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBND_OPDETSIM_PHOTONLITESTORE_HH
+#define SBND_OPDETSIM_PHOTONLITESTORE_HH
+
+#include "art/Framework/Principal/Handle.h"
+#include "lardataobj/Simulation/SimPhotons.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace opdet {
+
+  // photons detected in one time bin of a SimPhotonsLite
+  struct PhotonLiteBin {
+    int time;  // ns
+    int count;
+  };
+
+  // read-only view of a contiguous sequence of T
+  template <class T>
+  class ContiguousView {
+
+  public:
+
+    ContiguousView() = default;
+    ContiguousView(T const* begin, T const* end): fBegin(begin), fEnd(end) {}
+
+    T const* begin() const { return fBegin; }
+    T const* end() const { return fEnd; }
+    std::size_t size() const { return fEnd - fBegin; }
+    bool empty() const { return fBegin == fEnd; }
+    T const& operator[](std::size_t i) const { return fBegin[i]; }
+
+  private:
+
+    T const* fBegin = nullptr;
+    T const* fEnd = nullptr;
+
+  }; // class ContiguousView
+
+
+  class PhotonLiteStore {
+
+  public:
+
+    using Bins = ContiguousView<PhotonLiteBin>;
+
+    // photons of one channel from one collection
+    struct Entry {
+      Bins bins;
+      bool reflected;
+    };
+
+    using Entries = ContiguousView<Entry>;
+
+    // replace the content of the store with the photons of the channels
+    // below nChannels from all the collections
+    void Fill(std::vector<art::Handle<std::vector<sim::SimPhotonsLite>>> const& photon_handles,
+              unsigned nChannels);
+
+    unsigned NChannels() const { return fNPhotons.size(); }
+
+    Entries Channel(unsigned ch) const
+      {
+        return { fEntries.data() + fChannelStart[ch], fEntries.data() + fChannelStart[ch + 1] };
+      }
+
+    unsigned long NPhotons(unsigned ch) const { return fNPhotons[ch]; }
+
+  private:
+
+    std::vector<PhotonLiteBin> fBins;       // all the bins, channel after channel
+    std::vector<Entry> fEntries;            // all the entries, channel after channel
+    std::vector<std::size_t> fChannelStart; // first entry of each channel, plus the end
+    std::vector<unsigned long> fNPhotons;   // photons per channel
+
+  }; // class PhotonLiteStore
+
+} // namespace opdet
+
+#endif // SBND_OPDETSIM_PHOTONLITESTORE_HH
@@ -0,0 +1,77 @@
+////////////////////////////////////////////////////////////////////////
+// File:        TriggerWindowSet.hh
+//
+// Union of half-open time intervals [start, end), as used by
+// opDetSBNDTriggerAlg for the readout windows of a channel.
+//
+// The intervals are kept sorted, disjoint and not touching each other:
+// adding an interval merges it with all those it overlaps or touches, in
+// O(log n) plus the number of intervals merged; overlap and containment
+// queries are O(log n).
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBND_OPDETSIM_TRIGGERWINDOWSET_HH
+#define SBND_OPDETSIM_TRIGGERWINDOWSET_HH
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+
+namespace opdet {
+
+  class TriggerWindowSet {
+
+  public:
+
+    using Time_t = double;
+    using const_iterator = std::map<Time_t, Time_t>::const_iterator; // (start, end)
+
+    // add [start, end); empty intervals are ignored
+    void Add(Time_t start, Time_t end)
+      {
+        if (!(start < end)) return;
+        auto it = fWindows.upper_bound(start);
+        if (it != fWindows.begin()) {
+          auto const prev = std::prev(it);
+          if (prev->second >= start) {
+            start = prev->first;
+            end = std::max(end, prev->second);
+            it = fWindows.erase(prev);
+          }
+        }
+        while (it != fWindows.end() && it->first <= end) {
+          end = std::max(end, it->second);
+          it = fWindows.erase(it);
+        }
+        fWindows.emplace_hint(it, start, end);
+      }
+
+    // whether any of the intervals overlaps [start, end)
+    bool Overlaps(Time_t start, Time_t end) const
+      {
+        auto const it = fWindows.lower_bound(end);
+        return (it != fWindows.begin()) && (std::prev(it)->second > start);
+      }
+
+    // whether time t is in one of the intervals
+    bool Contains(Time_t t) const
+      {
+        auto const it = fWindows.upper_bound(t);
+        return (it != fWindows.begin()) && (std::prev(it)->second > t);
+      }
+
+    const_iterator begin() const { return fWindows.begin(); }
+    const_iterator end() const { return fWindows.end(); }
+    std::size_t size() const { return fWindows.size(); }
+    bool empty() const { return fWindows.empty(); }
+    void clear() { fWindows.clear(); }
+
+  private:
+
+    std::map<Time_t, Time_t> fWindows; // start -> end
+
+  }; // class TriggerWindowSet
+
+} // namespace opdet
+
+#endif // SBND_OPDETSIM_TRIGGERWINDOWSET_HH
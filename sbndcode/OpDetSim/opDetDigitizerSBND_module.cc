@@ -20,6 +20,13 @@
 
 #include "nurandom/RandomUtils/NuRandomService.h"
 #include "CLHEP/Random/JamesRandom.h"
+#include "CLHEP/Random/RandFlat.h"
+
+#include "tbb/blocked_range.h"
+#include "tbb/enumerable_thread_specific.h"
+#include "tbb/parallel_for.h"
+#include "tbb/partitioner.h"
+#include "tbb/task_arena.h"
 
 #include <memory>
 #include <vector>
@@ -30,7 +37,8 @@
 #include <set>
 #include <sstream>
 #include <fstream>
-#include <thread>
+#include <algorithm>
+#include <chrono>
 #include <cstdlib>
 #include <stdexcept>
 
@@ -48,9 +56,11 @@
 #include "TRandom3.h"
 #include "TF1.h"
 
-#include "sbndcode/OpDetSim/sbndPDMapAlg.hh"
+#include "sbndcode/OpDetSim/PDTypeTableServiceSBND.h"
+#include "larcore/CoreUtils/ServiceUtil.h"
 #include "sbndcode/OpDetSim/DigiArapucaSBNDAlg.hh"
 #include "sbndcode/OpDetSim/DigiPMTSBNDAlg.hh"
+#include "sbndcode/OpDetSim/PhotonLiteStore.hh"
 #include "sbndcode/OpDetSim/opDetSBNDTriggerAlg.hh"
 #include "sbndcode/OpDetSim/opDetDigitizerWorker.hh"
 
@@ -77,6 +87,19 @@ namespace opdet {
   * * `DetectorClocksService` for timing conversions and settings
   * * `LArPropertiesService` for the scintillation yield(s)
   *
+  * Multithreading
+  * ===============
+  * The photons are first sorted by channel (`sim::SimPhotonsLite` are
+  * copied into a single opdet::PhotonLiteStore, read by the digitizers
+  * through views); then each channel is a task of
+  * a work-stealing TBB task arena of `NThreads` threads (limited by the
+  * number of threads art lets TBB use), with the channels with the most
+  * photons scheduled first. Each thread has its own opdet::opDetDigitizerWorker,
+  * and the random numbers of a channel are seeded from the event and the
+  * channel number, so the output does not depend on the number of threads.
+  * The time each thread spent digitizing and idling is reported at the end
+  * of the job.
+  *
   */
 
   class opDetDigitizerSBND;
@@ -108,9 +131,9 @@ namespace opdet {
 
       fhicl::Atom<unsigned> NThreads {
         Name("NThreads"),
-        Comment("Number of threads to split waveform process into. Defaults to 1.\
+        Comment("Maximum number of threads to split waveform process into. Defaults to 1.\
                      Set 0 to autodetect. Autodection will first check $SBNDCODE_OPDETSIM_NTHREADS for number of threads. \
-                     If this is not set, then NThreads is set to the number of hardware cores on the host machine."),
+                     If this is not set, then NThreads is set to the number of threads art allows."),
         1
       };
 
@@ -135,9 +158,10 @@ namespace opdet {
 
     // Required functions.
     void produce(art::Event & e) override;
+    void endJob() override;
 
-    opdet::sbndPDMapAlg map; //map for photon detector types
-    unsigned int nChannels = map.size();
+    opdet::sbndPDTypeTable const& pdTypes = *lar::providerFrom<opdet::PDTypeTableServiceSBND>(); //photon detector types
+    unsigned int nChannels = pdTypes.size();
     std::vector<raw::OpDetWaveform> fWaveforms; // holder for un-triggered waveforms
 
   private:
@@ -148,22 +172,32 @@ namespace opdet {
     unsigned fPMTBaseline;
     unsigned fArapucaBaseline;
     unsigned fNThreads;
-    // digitizer workers
-    std::vector<opdet::opDetDigitizerWorker> fWorkers;
-    std::vector<std::vector<raw::OpDetWaveform>> fTriggeredWaveforms;
-    std::vector<std::thread> fWorkerThreads;
+
+    // trigger algorithm
+    opdet::opDetSBNDTriggerAlg fTriggerAlg;
+
+    // digitizer workers, one per thread of the arena
+    opDetDigitizerWorker::Config fWorkerConfig;
+    tbb::task_arena fArena;
+    tbb::enumerable_thread_specific<std::unique_ptr<opdet::opDetDigitizerWorker>> fWorkers;
+    std::unique_ptr<CLHEP::HepRandomEngine> fEngine; // event seeds of the channel random streams
+    unsigned long fNEvents = 0;
+    double fWallTime = 0.; // s, spent in the parallel sections
+
+    // photons, sorted by channel, and channels in scheduling order
+    opdet::PhotonLiteStore fPhotonLiteStore; // SimPhotonsLite of the event
+    std::vector<opDetDigitizerWorker::ChannelPhotons> fChannelPhotons;
+    std::vector<unsigned> fChannelOrder;
+    std::vector<std::vector<raw::OpDetWaveform>> fTriggeredWaveforms; // by channel
 
     // product containers
     std::vector<art::Handle<std::vector<sim::SimPhotonsLite>>> fPhotonLiteHandles;
     std::vector<art::Handle<std::vector<sim::SimPhotons>>> fPhotonHandles;
 
-    // sync stuff
-    opdet::opDetDigitizerWorker::Semaphore fSemStart;
-    opdet::opDetDigitizerWorker::Semaphore fSemFinish;
-    bool fFinished;
-
-    // trigger algorithm
-    opdet::opDetSBNDTriggerAlg fTriggerAlg;
+    // worker of the current thread, ready for the current event
+    opDetDigitizerWorker& LocalWorker(detinfo::DetectorClocksData const& clockData);
+    // run f(worker, ch) on all channels in fChannelOrder, in the arena
+    template <class F> void RunOnChannels(detinfo::DetectorClocksData const& clockData, F f);
   };
 
   opDetDigitizerSBND::opDetDigitizerSBND(Parameters const& config)
@@ -173,9 +207,8 @@ namespace opdet {
     , fPMTBaseline(config().pmtAlgoConfig().pmtbaseline())
     , fArapucaBaseline(config().araAlgoConfig().baseline())
     , fTriggerAlg(config().trigAlgoConfig())
+    , fWorkerConfig(config().pmtAlgoConfig(), config().araAlgoConfig())
   {
-    opDetDigitizerWorker::Config wConfig( config().pmtAlgoConfig(), config().araAlgoConfig());
-
     fNThreads = config().NThreads();
     if (fNThreads == 0) { // autodetect -- first check env var
       const char *env = std::getenv("SBNDCODE_OPDETSIM_NTHREADS");
@@ -197,53 +230,33 @@ namespace opdet {
       }
     }
 
-    if (fNThreads == 0) { // autodetect -- now try to get number of cpu's
-      fNThreads = std::thread::hardware_concurrency();
+    if (fNThreads == 0) { // autodetect -- now use the threads art gives to TBB
+      fNThreads = tbb::this_task_arena::max_concurrency();
     }
     if (fNThreads == 0) { // autodetect failed
       fNThreads = 1;
     }
+    // TBB does not run more threads than art allows, whatever the arena size
+    fArena.initialize(fNThreads);
     mf::LogInfo("OpDetDigitizer") << "Digitizing on n threads: " << fNThreads << std::endl;
 
-    wConfig.nThreads = fNThreads;
-
-    wConfig.UseSimPhotonsLite = config().UseSimPhotonsLite();
-    wConfig.InputModuleName = config().InputModuleName();
+    fWorkerConfig.pdTypes = &pdTypes;
+    fWorkerConfig.UseSimPhotonsLite = config().UseSimPhotonsLite();
+    fWorkerConfig.InputModuleName = config().InputModuleName();
 
     auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataForJob();
     auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataForJob(clockData);
-    wConfig.Sampling = (clockData.OpticalClock().Frequency()) / 1000.0; //in GHz
-    wConfig.EnableWindow = fTriggerAlg.TriggerEnableWindow(clockData, detProp); // us
-    wConfig.Nsamples = (wConfig.EnableWindow[1] - wConfig.EnableWindow[0]) * 1000. /*us -> ns*/ * wConfig.Sampling /* GHz */;
-
-    fFinished = false;
-
-    fWorkers.reserve(fNThreads);
-    fTriggeredWaveforms.reserve(fNThreads);
-    for (unsigned i = 0; i < fNThreads; i++) {
-      // Set random number gen seed from the NuRandomService
-      art::ServiceHandle<rndm::NuRandomService> seedSvc;
-      CLHEP::HepJamesRandom *engine = new CLHEP::HepJamesRandom;
-      seedSvc->registerEngine(rndm::NuRandomService::CLHEPengineSeeder(engine), "opDetDigitizerSBND" + std::to_string(i));
-
-      fTriggeredWaveforms.emplace_back();
-
-      // setup worker
-      fWorkers.emplace_back(i, wConfig, engine, fTriggerAlg);
-      fWorkers[i].SetPhotonLiteHandles(&fPhotonLiteHandles);
-      fWorkers[i].SetPhotonHandles(&fPhotonHandles);
-      fWorkers[i].SetWaveformHandle(&fWaveforms);
-      fWorkers[i].SetTriggeredWaveformHandle(&fTriggeredWaveforms[i]);
-
-      // start worker thread
-      fWorkerThreads.emplace_back(opdet::opDetDigitizerWorkerThread,
-                                  std::cref(fWorkers[i]),
-                                  clockData,
-                                  std::ref(fSemStart),
-                                  std::ref(fSemFinish),
-                                  fApplyTriggers,
-                                  &fFinished);
-    }
+    fWorkerConfig.Sampling = (clockData.OpticalClock().Frequency()) / 1000.0; //in GHz
+    fWorkerConfig.EnableWindow = fTriggerAlg.TriggerEnableWindow(clockData, detProp); // us
+    fWorkerConfig.Nsamples = (fWorkerConfig.EnableWindow[1] - fWorkerConfig.EnableWindow[0]) * 1000. /*us -> ns*/ * fWorkerConfig.Sampling /* GHz */;
+
+    // Set random number gen seed from the NuRandomService
+    art::ServiceHandle<rndm::NuRandomService> seedSvc;
+    fEngine = std::make_unique<CLHEP::HepJamesRandom>();
+    seedSvc->registerEngine(rndm::NuRandomService::CLHEPengineSeeder(fEngine.get()), "opDetDigitizerSBND");
+
+    fChannelPhotons.resize(nChannels);
+    fTriggeredWaveforms.resize(nChannels);
 
     // Call appropriate produces<>() functions here.
     produces< std::vector< raw::OpDetWaveform > >();
@@ -251,13 +264,36 @@ namespace opdet {
 
   opDetDigitizerSBND::~opDetDigitizerSBND()
   {
-    // cleanup all of the workers
-    fFinished = true;
-    opdet::StartopDetDigitizerWorkers(fNThreads, fSemStart);
+  }
 
-    // join the threads
-    for (std::thread &thread : fWorkerThreads) thread.join();
+  opDetDigitizerWorker& opDetDigitizerSBND::LocalWorker(detinfo::DetectorClocksData const& clockData)
+  {
+    std::unique_ptr<opDetDigitizerWorker> &worker = fWorkers.local();
+    if (!worker) worker = std::make_unique<opDetDigitizerWorker>(fWorkerConfig, fTriggerAlg);
+    worker->BeginEvent(clockData, fNEvents);
+    return *worker;
+  }
 
+  template <class F>
+  void opDetDigitizerSBND::RunOnChannels(detinfo::DetectorClocksData const& clockData, F f)
+  {
+    using clock = std::chrono::steady_clock;
+    const auto start = clock::now();
+    fArena.execute([&]{
+      // one task per channel: idle threads steal the remaining channels
+      tbb::parallel_for(tbb::blocked_range<size_t>(0, fChannelOrder.size(), 1),
+        [&](tbb::blocked_range<size_t> const& range) {
+          opDetDigitizerWorker &worker = LocalWorker(clockData);
+          for (size_t i = range.begin(); i != range.end(); ++i) {
+            const auto channelStart = clock::now();
+            f(worker, fChannelOrder[i]);
+            worker.GetStats().busy += std::chrono::duration<double>(clock::now() - channelStart).count();
+            ++worker.GetStats().nChannels;
+          }
+        },
+        tbb::simple_partitioner());
+    });
+    fWallTime += std::chrono::duration<double>(clock::now() - start).count();
   }
 
   void opDetDigitizerSBND::produce(art::Event & e)
@@ -265,6 +301,7 @@ namespace opdet {
     std::unique_ptr< std::vector< raw::OpDetWaveform > > pulseVecPtr(std::make_unique< std::vector< raw::OpDetWaveform > > ());
     // Implementation of required member function here.
     mf::LogInfo("opDetDigitizer") << "Event: " << e.id().event() << std::endl;
+    ++fNEvents;
 
     // setup the waveforms
     fWaveforms = std::vector<raw::OpDetWaveform> (nChannels);
@@ -278,6 +315,8 @@ namespace opdet {
       e.getManyByType(fPhotonLiteHandles);
       if (fPhotonLiteHandles.size() == 0)
         mf::LogError("OpDetDigitizer") << "sim::SimPhotonsLite not found -> No Optical Detector Simulation!\n";
+      fPhotonLiteStore.Fill(fPhotonLiteHandles, nChannels);
+      opdet::FillChannelPhotons(fPhotonLiteStore, fChannelPhotons);
     }
     else {
       fPhotonHandles.clear();
@@ -285,11 +324,25 @@ namespace opdet {
       e.getManyByType(fPhotonHandles);
       if (fPhotonHandles.size() == 0)
         mf::LogError("OpDetDigitizer") << "sim::SimPhotons not found -> No Optical Detector Simulation!\n";
+      opdet::FillChannelPhotons(fPhotonHandles, fChannelPhotons);
     }
-    // Start the workers!
+
+    // channels with photons, the most expensive first
+    fChannelOrder.clear();
+    for (unsigned ch = 0; ch < nChannels; ch++) {
+      if (!fChannelPhotons[ch].lite.empty() || !fChannelPhotons[ch].full.empty()) fChannelOrder.push_back(ch);
+    }
+    std::stable_sort(fChannelOrder.begin(), fChannelOrder.end(), [this](unsigned a, unsigned b)
+                     { return fChannelPhotons[a].nPhotons > fChannelPhotons[b].nPhotons; });
+
     // Run the digitizer over the full readout window
-    opdet::StartopDetDigitizerWorkers(fNThreads, fSemStart);
-    opdet::WaitopDetDigitizerWorkers(fNThreads, fSemFinish);
+    const long eventSeeds[2] = {
+      CLHEP::RandFlat::shootInt(fEngine.get(), 0x7FFFFFFFL),
+      CLHEP::RandFlat::shootInt(fEngine.get(), 0x7FFFFFFFL)
+    };
+    RunOnChannels(clockData, [&](opDetDigitizerWorker &worker, unsigned ch) {
+      worker.MakeWaveform(ch, fChannelPhotons[ch], eventSeeds, fWaveforms[ch]);
+    });
 
     if (fApplyTriggers) {
       // find the trigger locations for the waveforms
@@ -299,26 +352,31 @@ namespace opdet {
         if (ch == std::numeric_limits<raw::Channel_t>::max() /* "NULL" value*/) {
           continue;
         }
-        raw::ADC_Count_t baseline = (map.isPDType(ch, "pmt_uncoated") || map.isPDType(ch, "pmt_coated")) ?
+        raw::ADC_Count_t baseline = pdTypes.isPMT(ch) ?
                                     fPMTBaseline : fArapucaBaseline;
         fTriggerAlg.FindTriggerLocations(clockData, detProp, waveform, baseline);
       }
 
       // combine the triggers
       fTriggerAlg.MergeTriggerLocations();
-      // Start the workers!
-      // Apply the trigger locations
-      opdet::StartopDetDigitizerWorkers(fNThreads, fSemStart);
-      opdet::WaitopDetDigitizerWorkers(fNThreads, fSemFinish);
 
+      // Apply the trigger locations, channel by channel
+      RunOnChannels(clockData, [&](opDetDigitizerWorker &worker, unsigned ch) {
+        const raw::OpDetWaveform &waveform = fWaveforms[ch];
+        if (waveform.ChannelNumber() == std::numeric_limits<raw::Channel_t>::max() /* "NULL" value*/) {
+          return;
+        }
+        worker.ApplyTriggerLocations(clockData, waveform, fTriggeredWaveforms[ch]);
+      });
+
+      // move these waveforms into the pulseVecPtr, in channel order
+      size_t nTriggered = 0;
+      for (const std::vector<raw::OpDetWaveform> &waveforms : fTriggeredWaveforms) nTriggered += waveforms.size();
+      pulseVecPtr->reserve(nTriggered);
       for (std::vector<raw::OpDetWaveform> &waveforms : fTriggeredWaveforms) {
-        // move these waveforms into the pulseVecPtr
-        pulseVecPtr->reserve(pulseVecPtr->size() + waveforms.size());
         std::move(waveforms.begin(), waveforms.end(), std::back_inserter(*pulseVecPtr));
-      }
-      // clean up the vector
-      for (unsigned i = 0; i < fTriggeredWaveforms.size(); i++) {
-        fTriggeredWaveforms[i] = std::vector<raw::OpDetWaveform>();
+        // clean up the vector
+        waveforms.clear();
       }
 
       // put the waveforms in the event
@@ -343,6 +401,22 @@ namespace opdet {
 
   }//produce end
 
+  void opDetDigitizerSBND::endJob()
+  {
+    // load balance: time each thread spent digitizing, out of the time
+    // spent in the parallel sections
+    mf::LogInfo log("OpDetDigitizer");
+    log << "Digitization of " << fNEvents << " events took " << fWallTime << " s on up to "
+        << fNThreads << " threads:";
+    unsigned thread = 0;
+    for (const std::unique_ptr<opDetDigitizerWorker> &worker : fWorkers) {
+      if (!worker) continue;
+      const opDetDigitizerWorker::Stats &stats = worker->GetStats();
+      log << "\n  thread " << thread++ << ": " << stats.nChannels << " channels, busy "
+          << stats.busy << " s, idle " << std::max(0., fWallTime - stats.busy) << " s";
+    }
+  }
+
   DEFINE_ART_MODULE(opdet::opDetDigitizerSBND)
 
 }//closing namespace
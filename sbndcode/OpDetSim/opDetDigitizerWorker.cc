@@ -3,306 +3,216 @@
 #include "larcore/CoreUtils/ServiceUtil.h"
 #include "sbndcode/OpDetSim/opDetDigitizerWorker.hh"
 
+#include <algorithm>
+
 opdet::opDetDigitizerWorker::Config::Config(const opdet::DigiPMTSBNDAlgMaker::Config &pmt_config,
                                             const opdet::DigiArapucaSBNDAlgMaker::Config &arapuca_config):
   makePMTDigi(pmt_config),
   makeArapucaDigi(arapuca_config) {}
 
-opdet::opDetDigitizerWorker::opDetDigitizerWorker(unsigned no,
-                                                  const Config &config,
-                                                  CLHEP::HepRandomEngine *Engine,
+opdet::opDetDigitizerWorker::opDetDigitizerWorker(const Config &config,
                                                   const opDetSBNDTriggerAlg &trigger_alg):
   fConfig(config),
-  fThreadNo(no),
-  fEngine(Engine),
   fTriggerAlg(trigger_alg)
 {}
 
-void opdet::opDetDigitizerWorkerThread(const opdet::opDetDigitizerWorker &worker,
-                                       detinfo::DetectorClocksData const& clockData,
-                                       opdet::opDetDigitizerWorker::Semaphore &sem_start,
-                                       opdet::opDetDigitizerWorker::Semaphore &sem_finish,
-                                       bool ApplyTriggerLocations,
-                                       bool *finished)
+void opdet::FillChannelPhotons(
+  const PhotonLiteStore &photon_store,
+  std::vector<opDetDigitizerWorker::ChannelPhotons> &channelPhotons)
 {
+  for (auto &photons : channelPhotons) photons.clear();
 
-  bool do_apply_trigger_locations = false;
-  while (1) {
-    sem_start.decrement();
-
-    if (*finished) break;
-
-    if (do_apply_trigger_locations) {
-      worker.ApplyTriggerLocations(clockData);
-      do_apply_trigger_locations = false;
-    }
-    else {
-      worker.Start(clockData);
-      do_apply_trigger_locations = ApplyTriggerLocations;
-    }
-
-    sem_finish.increment();
+  const unsigned nChannels = std::min<size_t>(photon_store.NChannels(), channelPhotons.size());
+  for (unsigned ch = 0; ch < nChannels; ch++) {
+    channelPhotons[ch].lite = photon_store.Channel(ch);
+    channelPhotons[ch].nPhotons = photon_store.NPhotons(ch);
   }
-
-}
-
-void opdet::StartopDetDigitizerWorkers(unsigned n_workers,
-                                       opdet::opDetDigitizerWorker::Semaphore &sem_start)
-{
-  sem_start.increment(n_workers);
-}
-
-void opdet::WaitopDetDigitizerWorkers(unsigned n_workers,
-                                      opdet::opDetDigitizerWorker::Semaphore &sem_finish)
-{
-  sem_finish.decrement(n_workers);
-}
-
-void opdet::opDetDigitizerWorker::Semaphore::increment(unsigned n)
-{
-  std::unique_lock<std::mutex> lock(mtx);
-  count += n;
-  cv.notify_all();
 }
 
-void opdet::opDetDigitizerWorker::Semaphore::decrement(unsigned n)
+void opdet::FillChannelPhotons(
+  const std::vector<art::Handle<std::vector<sim::SimPhotons>>> &photon_handles,
+  std::vector<opDetDigitizerWorker::ChannelPhotons> &channelPhotons)
 {
-  std::unique_lock<std::mutex> lock(mtx);
-
-  while (count < n) {
-    cv.wait(lock);
+  for (auto &photons : channelPhotons) photons.clear();
+
+  for (const art::Handle<std::vector<sim::SimPhotons>> &opdetHandle : photon_handles) {
+    const bool Reflected = (opdetHandle.provenance()->productInstanceName() == "Reflected");
+    for (auto const& simphotons : (*opdetHandle)) {
+      const unsigned ch = simphotons.OpChannel();
+      if (ch >= channelPhotons.size()) continue;
+      opDetDigitizerWorker::ChannelPhotons &photons = channelPhotons[ch];
+      photons.full.emplace_back(&simphotons, Reflected);
+      photons.nPhotons += simphotons.size();
+    }
   }
-  count -= n;
-}
-
-unsigned opdet::opDetDigitizerWorker::NChannelsToProcess(unsigned n) const
-{
-  return (n + fConfig.nThreads - fThreadNo - 1) / fConfig.nThreads;
-}
-
-unsigned opdet::opDetDigitizerWorker::StartChannelToProcess(unsigned n) const
-{
-  unsigned n_per_job = n / fConfig.nThreads;
-  unsigned leftover = std::min(fThreadNo, n % fConfig.nThreads);
-  return n_per_job * fThreadNo + leftover;
 }
 
-void opdet::opDetDigitizerWorker::Start(detinfo::DetectorClocksData const& clockData) const
+void opdet::opDetDigitizerWorker::BeginEvent(detinfo::DetectorClocksData const& clockData,
+                                             unsigned long event)
 {
-  auto arapucaDigitizer = fConfig.makeArapucaDigi(
-                            *(lar::providerFrom<detinfo::LArPropertiesService>()),
-                            clockData,
-                            fEngine
-                          );
+  if (fPMTDigitizer && event == fEvent) return;
+  fEvent = event;
 
-  auto pmtDigitizer = fConfig.makePMTDigi(
+  fArapucaDigitizer = fConfig.makeArapucaDigi(
                         *(lar::providerFrom<detinfo::LArPropertiesService>()),
                         clockData,
-                        fEngine
+                        &fEngine
                       );
-  MakeWaveforms(pmtDigitizer.get(), arapucaDigitizer.get());
 
+  fPMTDigitizer = fConfig.makePMTDigi(
+                    *(lar::providerFrom<detinfo::LArPropertiesService>()),
+                    clockData,
+                    &fEngine
+                  );
 }
 
-opdet::opDetDigitizerWorker::~opDetDigitizerWorker()
+void opdet::opDetDigitizerWorker::MakeWaveform(unsigned ch,
+                                               const ChannelPhotons &photons,
+                                               const long eventSeeds[2],
+                                               raw::OpDetWaveform &waveform)
 {
-  delete fEngine;
+  // the random sequence of a channel does not depend on the worker
+  const long seeds[3] = { eventSeeds[0], eventSeeds[1], (long) ch };
+  fEngine.setSeeds(seeds, 3);
+
+  if (fConfig.UseSimPhotonsLite) MakeWaveformLite(ch, photons, waveform);
+  else MakeWaveformFull(ch, photons, waveform);
 }
 
-void opdet::opDetDigitizerWorker::ApplyTriggerLocations(detinfo::DetectorClocksData const& clockData) const
+void opdet::opDetDigitizerWorker::ApplyTriggerLocations(detinfo::DetectorClocksData const& clockData,
+                                                        const raw::OpDetWaveform &waveform,
+                                                        std::vector<raw::OpDetWaveform> &triggered) const
 {
-  unsigned start = StartChannelToProcess(fConfig.nChannels);
-  unsigned n = NChannelsToProcess(fConfig.nChannels);
-
-  fTriggeredWaveforms->clear();
+  fTriggerAlg.ApplyTriggerLocations(clockData, waveform, triggered);
+}
 
-  // apply the triggers and save the output
-  for (const raw::OpDetWaveform &waveform : *fWaveforms){
-    if (waveform.ChannelNumber() == std::numeric_limits<raw::Channel_t>::max() /* "NULL" value*/) {
-      continue;
+void opdet::opDetDigitizerWorker::MakeWaveformLite(unsigned ch,
+                                                   const ChannelPhotons &photons,
+                                                   raw::OpDetWaveform &wvf)
+{
+  // to temporarily store channel and combine PMT (direct and converted) time profiles
+  const double startTime = fConfig.EnableWindow[0] * 1000 /*ns for digitizer*/;
+  const opdet::PDType type = fConfig.pdTypes->type(ch);
+  const std::string &pdtype = opdet::PDTypeName(type);
+  const PhotonLiteStore::Entry *directPhotons = nullptr, *reflectedPhotons = nullptr;
+
+  for (auto const& entry : photons.lite) {
+    const PhotonLiteStore::Bins &litesimphotons = entry.bins;
+    const bool Reflected = entry.reflected;
+
+    if( type == PDType::kPMTCoated ){
+      // only the first collection of each kind is used
+      if(Reflected) { if (!reflectedPhotons) reflectedPhotons = &entry; }
+      else if (!directPhotons) directPhotons = &entry;
     }
-    // only work on the prescribed channels
-    if (waveform.ChannelNumber() < start || waveform.ChannelNumber() >= start + n) continue;
-
-    std::vector<raw::OpDetWaveform> waveforms = fTriggerAlg.ApplyTriggerLocations(clockData, waveform);
+    else if( (Reflected) && (type == PDType::kPMTUncoated) ) { //Uncoated PMT channels
+      // including pre trigger window and transit time
+      InitWaveform(ch, wvf);
+      fPMTDigitizer->ConstructWaveformLite(ch,
+                                           litesimphotons,
+                                           wvf,
+                                           pdtype,
+                                           startTime,
+                                           fConfig.Nsamples);
+    }
+    // getting only xarapuca channels with appropriate type of light
+    else if((type == PDType::kXArapucaVUV && !Reflected) ||
+            (type == PDType::kXArapucaVIS && Reflected) ) {
+      InitWaveform(ch, wvf);
+      fArapucaDigitizer->ConstructWaveformLite(ch,
+                                               litesimphotons,
+                                               wvf,
+                                               pdtype,
+                                               startTime,
+                                               fConfig.Nsamples);
+    }
+    // getting only arapuca channels with appropriate type of light
+    else if((type == PDType::kArapucaVUV && !Reflected) ||
+            (type == PDType::kArapucaVIS && Reflected) ) {
+      InitWaveform(ch, wvf);
+      fArapucaDigitizer->ConstructWaveformLite(ch,
+                                               litesimphotons,
+                                               wvf,
+                                               pdtype,
+                                               startTime,
+                                               fConfig.Nsamples);
+    }
+  }
 
-    std::move(waveforms.begin(), waveforms.end(), std::back_inserter(*fTriggeredWaveforms));
+  //Constructing Waveforms for hybrid OpChannels (coated pmts)
+  if (directPhotons || reflectedPhotons) {
+    InitWaveform(ch, wvf);
+    fPMTDigitizer->ConstructWaveformLiteCoatedPMT(ch, wvf,
+                                                  directPhotons ? &directPhotons->bins : nullptr,
+                                                  reflectedPhotons ? &reflectedPhotons->bins : nullptr,
+                                                  startTime, fConfig.Nsamples);
   }
 }
 
-void opdet::opDetDigitizerWorker::MakeWaveforms(opdet::DigiPMTSBNDAlg *pmtDigitizer,
-                                                opdet::DigiArapucaSBNDAlg *arapucaDigitizer) const
+void opdet::opDetDigitizerWorker::MakeWaveformFull(unsigned ch,
+                                                   const ChannelPhotons &photons,
+                                                   raw::OpDetWaveform &wvf)
 {
-  if(fConfig.UseSimPhotonsLite) {
-    const std::vector<art::Handle<std::vector<sim::SimPhotonsLite>>> &photon_handles = *fPhotonLiteHandles;
-
-    // TODO: Instead of looping and evaluating if/else through all the photon_handles
-    // we should get smaller containers with only the relevant handles for each case
-    // ~icaza
-    // std::vector<art::Handle<std::vector<sim::SimPhotonsLite>> const*> ptr_photon_handles(photon_handles.size());
-    // std::transform(photon_handles.begin(), photon_handles.end(), ptr_photon_handles.begin(),
-    //                [](auto& p) {return std::addressof(p);});
-
-    // to temporarily store channel and combine PMT (direct and converted) time profiles
-    const double startTime = fConfig.EnableWindow[0] * 1000 /*ns for digitizer*/;
-
-    std::unordered_map<int, sim::SimPhotonsLite> DirectPhotonsMap;
-    std::unordered_map<int, sim::SimPhotonsLite> ReflectedPhotonsMap;
-    std::unordered_set<short unsigned int> coatedpmts_todigitize;
-
-    const unsigned start = StartChannelToProcess(fConfig.nChannels);
-    const unsigned n = NChannelsToProcess(fConfig.nChannels);
-    for (const art::Handle<std::vector<sim::SimPhotonsLite>> &opdetHandle : photon_handles) {
-      // this now tells you if light collection is reflected
-      const bool Reflected = (opdetHandle.provenance()->productInstanceName() == "Reflected");
-      for (auto const& litesimphotons : (*opdetHandle)) {
-        std::vector<short unsigned int> waveform;
-        waveform.reserve(fConfig.Nsamples);
-        const unsigned ch = litesimphotons.OpChannel;
-        const std::string pdtype = fConfig.pdsMap.pdType(ch);
-        // only work on the prescribed channels
-        if (ch < start || ch >= start + n) continue;
-
-        if( pdtype == "pmt_coated" ){
-          if(Reflected)
-            ReflectedPhotonsMap.insert(std::make_pair(ch, litesimphotons));
-          else
-            DirectPhotonsMap.insert(std::make_pair(ch, litesimphotons));
-
-          coatedpmts_todigitize.insert(ch);
-        }
-        else if( (Reflected) && (pdtype == "pmt_uncoated") ) { //Uncoated PMT channels
-          pmtDigitizer->ConstructWaveformLite(ch,
-                                              litesimphotons,
-                                              waveform,
-                                              pdtype,
-                                              startTime,
-                                              fConfig.Nsamples);
-          // including pre trigger window and transit time
-          fWaveforms->at(ch) = raw::OpDetWaveform(fConfig.EnableWindow[0],
-                                                  (unsigned int)ch,
-                                                  waveform);
-      	}
-        // getting only xarapuca channels with appropriate type of light
-        else if((pdtype == "xarapuca_vuv" && !Reflected) ||
-                (pdtype == "xarapuca_vis" && Reflected) ) {
-          arapucaDigitizer->ConstructWaveformLite(ch,
-                                                  litesimphotons,
-                                                  waveform,
-                                                  pdtype,
-                                                  startTime,
-                                                  fConfig.Nsamples);
-          // including pre trigger window and transit time
-          fWaveforms->at(ch) = raw::OpDetWaveform(fConfig.EnableWindow[0],
-                                                  (unsigned int)ch,
-                                                  waveform);
-        }
-        // getting only arapuca channels with appropriate type of light
-        else if((pdtype == "arapuca_vuv" && !Reflected) ||
-                (pdtype == "arapuca_vis" && Reflected) ) {
-          arapucaDigitizer->ConstructWaveformLite(ch,
-                                                  litesimphotons,
-                                                  waveform,
-                                                  pdtype,
-                                                  startTime,
-                                                  fConfig.Nsamples);
-          // including pre trigger window and transit time
-          fWaveforms->at(ch) = raw::OpDetWaveform(fConfig.EnableWindow[0],
-                                                  (unsigned int)ch,
-                                                  waveform);
-      	}
-      }
-    }  //end loop on simphoton lite collections
-
-    //Constructing Waveforms for hybrid OpChannels (coated pmts)
-    for(auto ch : coatedpmts_todigitize){
-      std::vector<short unsigned int> waveform;
-      waveform.reserve(fConfig.Nsamples);
-      pmtDigitizer->ConstructWaveformLiteCoatedPMT(ch, waveform, DirectPhotonsMap, ReflectedPhotonsMap, startTime, fConfig.Nsamples);
-      fWaveforms->at(ch) = raw::OpDetWaveform(fConfig.EnableWindow[0],
-                                              (unsigned int)ch,
-                                              waveform);
+  const double startTime = fConfig.EnableWindow[0] * 1000 /*ns for digitizer*/;
+  const opdet::PDType type = fConfig.pdTypes->type(ch);
+  const std::string &pdtype = opdet::PDTypeName(type);
+  const sim::SimPhotons *directPhotons = nullptr, *reflectedPhotons = nullptr;
+
+  for (auto const& entry : photons.full) {
+    const sim::SimPhotons &simphotons = *entry.first;
+    const bool Reflected = entry.second;
+
+    //coated PMTs
+    if( type == PDType::kPMTCoated ){
+      // only the first collection of each kind is used
+      if(Reflected) { if (!reflectedPhotons) reflectedPhotons = &simphotons; }
+      else if (!directPhotons) directPhotons = &simphotons;
+    }
+    // uncoated PMTs
+    else if(Reflected && type == PDType::kPMTUncoated) {
+      // including pre trigger window and transit time
+      InitWaveform(ch, wvf);
+      fPMTDigitizer->ConstructWaveform(ch,
+                                       simphotons,
+                                       wvf,
+                                       pdtype,
+                                       startTime,
+                                       fConfig.Nsamples);
+    }
+    // getting only arapuca channels with appropriate type of light
+    if((type == PDType::kArapucaVUV && !Reflected) ||
+       (type == PDType::kArapucaVIS && Reflected)) {
+      InitWaveform(ch, wvf);
+      fArapucaDigitizer->ConstructWaveform(ch,
+                                           simphotons,
+                                           wvf,
+                                           pdtype,
+                                           startTime,
+                                           fConfig.Nsamples);
+    }
+    // getting only arapuca channels with appropriate type of light
+    if((type == PDType::kXArapucaVUV && !Reflected) ||
+       (type == PDType::kXArapucaVIS && Reflected)) {
+      InitWaveform(ch, wvf);
+      fArapucaDigitizer->ConstructWaveform(ch,
+                                           simphotons,
+                                           wvf,
+                                           pdtype,
+                                           startTime,
+                                           fConfig.Nsamples);
     }
   }
-  else { // for SimPhotons
-    // to temporarily store channel and direct light distribution
-    std::unordered_map<int, sim::SimPhotons> DirectPhotonsMap;
-    std::unordered_map<int, sim::SimPhotons> ReflectedPhotonsMap;
-    std::unordered_set<short unsigned int> coatedpmts_todigitize;
-
-    const std::vector<art::Handle<std::vector<sim::SimPhotons>>> &photon_handles = *fPhotonHandles;
-    const double startTime = fConfig.EnableWindow[0] * 1000 /*ns for digitizer*/;
 
-    const unsigned start = StartChannelToProcess(fConfig.nChannels);
-    const unsigned n = NChannelsToProcess(fConfig.nChannels);
-    for (const art::Handle<std::vector<sim::SimPhotons>> &opdetHandle : photon_handles) {
-      const bool Reflected = (opdetHandle.provenance()->productInstanceName() == "Reflected");
-      for (auto const& simphotons : (*opdetHandle)) {
-        std::vector<short unsigned int> waveform;
-        const unsigned ch = simphotons.OpChannel();
-        const std::string pdtype = fConfig.pdsMap.pdType(ch);
-        // only work on the prescribed channels
-        if (ch < start || ch >= start + n) continue;
-        //coated PMTs
-        if( pdtype == "pmt_coated" ){
-          if(Reflected)
-            ReflectedPhotonsMap.insert(std::make_pair(ch, simphotons));
-          else
-            DirectPhotonsMap.insert(std::make_pair(ch, simphotons));
+  //Constructing Waveforms for hybrid OpChannels (coated pmts)
+  if (directPhotons || reflectedPhotons) {
+    InitWaveform(ch, wvf);
+    fPMTDigitizer->ConstructWaveformCoatedPMT(ch, wvf, directPhotons, reflectedPhotons, startTime, fConfig.Nsamples);
+  }
+}
 
-          coatedpmts_todigitize.insert(ch);
-        }
-        // uncoated PMTs
-        else if(Reflected && pdtype == "pmt_uncoated") {
-          pmtDigitizer->ConstructWaveform(ch,
-                                          simphotons,
-                                          waveform,
-                                          pdtype,
-                                          startTime,
-                                          fConfig.Nsamples);
-          // including pre trigger window and transit time
-          fWaveforms->at(ch) = raw::OpDetWaveform(fConfig.EnableWindow[0],
-                                                  (unsigned int)ch,
-                                                  waveform);
-        }
-        // getting only arapuca channels with appropriate type of light
-        if((pdtype == "arapuca_vuv" && !Reflected) ||
-           (pdtype == "arapuca_vis" && Reflected)) {
-          arapucaDigitizer->ConstructWaveform(ch,
-                                              simphotons,
-                                              waveform,
-                                              pdtype,
-                                              startTime,
-                                              fConfig.Nsamples);
-          // including pre trigger window and transit time
-          fWaveforms->at(ch) = raw::OpDetWaveform(fConfig.EnableWindow[0],
-                                                  (unsigned int)ch,
-                                                  waveform);
-        }
-        // getting only arapuca channels with appropriate type of light
-        if((pdtype == "xarapuca_vuv" && !Reflected) ||
-           (pdtype == "xarapuca_vis" && Reflected)) {
-          arapucaDigitizer->ConstructWaveform(ch,
-                                              simphotons,
-                                              waveform,
-                                              pdtype,
-                                              startTime,
-                                              fConfig.Nsamples);
-          // including pre trigger window and transit time
-          fWaveforms->at(ch) = raw::OpDetWaveform(fConfig.EnableWindow[0],
-                                                  (unsigned int)ch,
-                                                  waveform);
-        }
-      }//optical channel loop
-    }//type of light loop
-    //Constructing Waveforms for hybrid OpChannels (coated pmts)
-    for(auto ch : coatedpmts_todigitize){
-      std::vector<short unsigned int> waveform;
-      waveform.reserve(fConfig.Nsamples);
-      pmtDigitizer->ConstructWaveformCoatedPMT(ch, waveform, DirectPhotonsMap, ReflectedPhotonsMap, startTime, fConfig.Nsamples);
-      fWaveforms->at(ch) = raw::OpDetWaveform(fConfig.EnableWindow[0],
-                                              (unsigned int)ch,
-                                              waveform);
-    }
-  }//simphotons end
+void opdet::opDetDigitizerWorker::InitWaveform(unsigned ch, raw::OpDetWaveform &wvf) const
+{
+  // the digitizers fill the samples in place
+  wvf.SetTimeStamp(fConfig.EnableWindow[0]);
+  wvf.SetChannelNumber(ch);
 }
@@ -3,18 +3,25 @@
 //
 // This module handles the calls to the digitization functions
 // Created by G. Putnam and I.L. de Icaza
+//
+// A worker holds the digitization algorithms, the random engine and the
+// timing counters of one thread: opDetDigitizerSBND keeps one per thread
+// of its task arena and hands it one channel at a time. The photons of
+// each channel are gathered beforehand by FillChannelPhotons, so that a
+// channel task does not need to look at the photons of other channels.
 ////////////////////////////////////////////////////////////////////////
 
 #ifndef SBND_OPDETSIM_OPDETDIGITIZERWORKER_HH
 #define SBND_OPDETSIM_OPDETDIGITIZERWORKER_HH
 
-#include <unordered_map>
+#include <memory>
+#include <utility>
 #include <vector>
-#include <mutex>
-#include <condition_variable>
-// #include <memory>
 
-#include "sbndcode/OpDetSim/sbndPDMapAlg.hh"
+#include "CLHEP/Random/MixMaxRng.h"
+
+#include "sbndcode/OpDetSim/sbndPDTypeTable.hh"
+#include "sbndcode/OpDetSim/PhotonLiteStore.hh"
 #include "sbndcode/OpDetSim/DigiArapucaSBNDAlg.hh"
 #include "sbndcode/OpDetSim/DigiPMTSBNDAlg.hh"
 #include "sbndcode/OpDetSim/opDetSBNDTriggerAlg.hh"
@@ -32,10 +39,7 @@ namespace opdet {
       opdet::DigiPMTSBNDAlgMaker makePMTDigi;
       opdet::DigiArapucaSBNDAlgMaker makeArapucaDigi;
 
-      opdet::sbndPDMapAlg pdsMap;  //map for photon detector types
-      unsigned int nChannels = pdsMap.size();
-
-      unsigned nThreads;
+      const opdet::sbndPDTypeTable* pdTypes = nullptr;  //photon detector types
 
       art::InputTag InputModuleName;
       bool UseSimPhotonsLite; // SimPhotons have more information that SimPhotonsLite
@@ -47,72 +51,66 @@ namespace opdet {
       Config(const opdet::DigiPMTSBNDAlgMaker::Config &pmt_config, const opdet::DigiArapucaSBNDAlgMaker::Config &arapuca_config);
     };
 
-    class Semaphore {
-    public:
-      Semaphore(unsigned count_ = 0): count(count_) {}
-      void increment(unsigned n = 1);
-      void decrement(unsigned n = 1);
-
-    private:
-      std::mutex mtx;
-      std::condition_variable cv;
-      unsigned count;
+    // Photons of one channel from all the input collections, in the order
+    // of the collections, each flagged as reflected light or not; the
+    // SimPhotonsLite are views into the PhotonLiteStore of the event
+    struct ChannelPhotons {
+      PhotonLiteStore::Entries lite;
+      std::vector<std::pair<const sim::SimPhotons*, bool>> full;
+      unsigned long nPhotons = 0; // digitization cost estimate, for scheduling
+
+      void clear() { lite = {}; full.clear(); nPhotons = 0; }
+    };
+
+    // Time spent digitizing and channels processed by one worker
+    struct Stats {
+      double busy = 0.; // s
+      unsigned long nChannels = 0;
     };
 
-    opDetDigitizerWorker(unsigned no, const Config &config, CLHEP::HepRandomEngine *Engine, const opDetSBNDTriggerAlg &trigger_alg);
-    ~opDetDigitizerWorker();
-
-    void SetPhotonLiteHandles(const std::vector<art::Handle<std::vector<sim::SimPhotonsLite>>> *PhotonLiteHandles)
-    {
-      fPhotonLiteHandles = PhotonLiteHandles;
-    }
-    void SetPhotonHandles(const std::vector<art::Handle<std::vector<sim::SimPhotons>>> *PhotonHandles)
-    {
-      fPhotonHandles = PhotonHandles;
-    }
-    void SetWaveformHandle(std::vector<raw::OpDetWaveform> *Waveforms)
-    {
-      fWaveforms = Waveforms;
-    }
-    void SetTriggeredWaveformHandle(std::vector<raw::OpDetWaveform> *Waveforms)
-    {
-      fTriggeredWaveforms = Waveforms;
-    }
-
-    void Start(detinfo::DetectorClocksData const& clockData) const;
-    void ApplyTriggerLocations(detinfo::DetectorClocksData const& clockData) const;
+    opDetDigitizerWorker(const Config &config, const opDetSBNDTriggerAlg &trigger_alg);
+
+    // Create the digitization algorithms for the event number event, if
+    // this worker does not have them yet
+    void BeginEvent(detinfo::DetectorClocksData const& clockData, unsigned long event);
+
+    // Digitize channel ch, with random numbers seeded by the event seeds
+    // and the channel number; waveform is left untouched if the channel
+    // has no photons of a kind its detector sees
+    void MakeWaveform(unsigned ch, const ChannelPhotons &photons,
+                      const long eventSeeds[2], raw::OpDetWaveform &waveform);
+
+    // Append the triggered pieces of waveform to triggered
+    void ApplyTriggerLocations(detinfo::DetectorClocksData const& clockData,
+                               const raw::OpDetWaveform &waveform,
+                               std::vector<raw::OpDetWaveform> &triggered) const;
+
+    Stats& GetStats() { return fStats; }
+    const Stats& GetStats() const { return fStats; }
 
   private:
-    unsigned NChannelsToProcess(unsigned n) const;
-    unsigned StartChannelToProcess(unsigned n) const;
-    void CreateDirectPhotonMap(
-      std::unordered_map<int, sim::SimPhotons>& directPhotonsOnPMTS,
-      std::vector<art::Handle<std::vector<sim::SimPhotons>>> photon_handles) const;
-    void CreateDirectPhotonMapLite(
-      std::unordered_map<int, sim::SimPhotonsLite>& directPhotonsOnPMTS,
-      std::vector<art::Handle<std::vector<sim::SimPhotonsLite>>> photon_handles) const;
-    void MakeWaveforms(
-      opdet::DigiPMTSBNDAlg *pmtDigitizer,
-      opdet::DigiArapucaSBNDAlg *arapucaDigitizer) const;
-
-    Config fConfig;
-    unsigned fThreadNo;
-    CLHEP::HepRandomEngine *fEngine;
+    void MakeWaveformLite(unsigned ch, const ChannelPhotons &photons, raw::OpDetWaveform &waveform);
+    void MakeWaveformFull(unsigned ch, const ChannelPhotons &photons, raw::OpDetWaveform &waveform);
+    void InitWaveform(unsigned ch, raw::OpDetWaveform &waveform) const;
+
+    const Config &fConfig;
     const opDetSBNDTriggerAlg &fTriggerAlg;
 
-    const std::vector<art::Handle<std::vector<sim::SimPhotonsLite>>> *fPhotonLiteHandles;
-    const std::vector<art::Handle<std::vector<sim::SimPhotons>>> *fPhotonHandles;
-    std::vector<raw::OpDetWaveform> *fWaveforms;
-    std::vector<raw::OpDetWaveform> *fTriggeredWaveforms;
+    CLHEP::MixMaxRng fEngine;
+    unsigned long fEvent = 0;
+    std::unique_ptr<opdet::DigiPMTSBNDAlg> fPMTDigitizer;
+    std::unique_ptr<opdet::DigiArapucaSBNDAlg> fArapucaDigitizer;
+
+    Stats fStats;
   };
 
-  void StartopDetDigitizerWorkers(unsigned n_workers, opDetDigitizerWorker::Semaphore &sem_start);
-  void WaitopDetDigitizerWorkers(unsigned n_workers, opDetDigitizerWorker::Semaphore &sem_finish);
-  void opDetDigitizerWorkerThread(const opDetDigitizerWorker &worker,
-                                  detinfo::DetectorClocksData const& clockData,
-                                  opDetDigitizerWorker::Semaphore &sem_start,
-                                  opDetDigitizerWorker::Semaphore &sem_finish,
-                                  bool ApplyTriggerLocations, bool *finished);
+  // Sort the photons of all the collections by channel
+  void FillChannelPhotons(
+    const PhotonLiteStore &photon_store,
+    std::vector<opDetDigitizerWorker::ChannelPhotons> &channelPhotons);
+  void FillChannelPhotons(
+    const std::vector<art::Handle<std::vector<sim::SimPhotons>>> &photon_handles,
+    std::vector<opDetDigitizerWorker::ChannelPhotons> &channelPhotons);
 
 } // end namespace opdet
 
@@ -1,5 +1,8 @@
 #include "sbndcode/OpDetSim/opDetSBNDTriggerAlg.hh"
 #include "lardataalg/DetectorInfo/DetectorClocksData.h"
+#include "sbndcode/OpDetSim/TriggerWindowSet.hh"
+
+#include <queue>
 
 namespace {
   double optical_period(detinfo::DetectorClocksData const& clockData)
@@ -13,6 +16,22 @@ namespace {
   {
     return waveform_start + waveform_index * optical_period(clockData);
   }
+
+  // index of the first tick, from index first on, at or after time t
+  // (n_ticks if none); the tick times are computed as in tick_to_timestamp
+  size_t first_tick_from(detinfo::DetectorClocksData const& clockData,
+                         raw::TimeStamp_t waveform_start,
+                         raw::TimeStamp_t t,
+                         size_t first,
+                         size_t n_ticks)
+  {
+    const double guess = std::ceil((t - waveform_start) / optical_period(clockData));
+    size_t i = (guess <= first) ? first : (guess >= n_ticks) ? n_ticks : (size_t) guess;
+    // fix rounding
+    while (i > first && tick_to_timestamp(clockData, waveform_start, i-1) >= t) i -= 1;
+    while (i < n_ticks && tick_to_timestamp(clockData, waveform_start, i) < t) i += 1;
+    return i;
+  }
 }
 
 namespace opdet {
@@ -24,33 +43,6 @@ struct TriggerPrimitive {
 
 };
 
-// Local static functions
-// Adds a value to a vector of trigger locations, while keeping the vector sorted
-void AddTriggerLocation(std::vector<std::array<raw::TimeStamp_t, 2>> &triggers, std::array<raw::TimeStamp_t,2> range) {
-  typedef std::vector<std::array<raw::TimeStamp_t,2>> TimeStamps;
-
-  TimeStamps::iterator insert = std::lower_bound(triggers.begin(), triggers.end(), range,
-    [](const auto &lhs, const auto &rhs) { return lhs[0] < rhs[0]; });
-  triggers.insert(insert, range);
-}
-
-void AddTriggerPrimitive(std::vector<TriggerPrimitive> &triggers, TriggerPrimitive trigger) {
-  typedef std::vector<TriggerPrimitive> TimeStamps;
-
-  TimeStamps::iterator insert = std::lower_bound(triggers.begin(), triggers.end(), trigger,
-    [](auto const &lhs, auto const &rhs) { return lhs.start < rhs.start; });
-
-  triggers.insert(insert, trigger);
-}
-
-void AddTriggerPrimitiveFinish(std::vector<TriggerPrimitive> &triggers, TriggerPrimitive trigger) {
-  typedef std::vector<TriggerPrimitive> TimeStamps;
-  
-  TimeStamps::iterator insert = std::upper_bound(triggers.begin(), triggers.end(), trigger,
-    [](auto const &lhs, auto const &rhs) { return lhs.finish < rhs.finish; });
-
-  triggers.insert(insert, trigger);
-}
 
 opDetSBNDTriggerAlg::opDetSBNDTriggerAlg(const Config &config):
   fConfig(config)
@@ -62,15 +54,12 @@ opDetSBNDTriggerAlg::opDetSBNDTriggerAlg(const Config &config):
 void opDetSBNDTriggerAlg::FindTriggerLocations(detinfo::DetectorClocksData const& clockData,
                                                detinfo::DetectorPropertiesData const& detProp,
                                                const raw::OpDetWaveform &waveform, raw::ADC_Count_t baseline) {
-  std::vector<std::array<raw::TimeStamp_t, 2>> this_trigger_ranges;
   const std::vector<raw::ADC_Count_t> &adcs = waveform; // upcast to get adcs
   raw::Channel_t channel = waveform.ChannelNumber();
   // if (channel > (unsigned)fOpDetMap.size()) return;
 
   // initialize the channel in the map no matter what
-  if (fTriggerRangesPerChannel.count(channel) == 0) {
-    fTriggerRangesPerChannel[channel] = std::vector<std::array<raw::TimeStamp_t,2>>();
-  }
+  std::vector<std::array<raw::TimeStamp_t, 2>> &channel_ranges = fTriggerRangesPerChannel[channel];
 
   // get the threshold -- first check if channel is Arapuca or PMT
   bool is_arapuca = false;
@@ -135,7 +124,8 @@ void opDetSBNDTriggerAlg::FindTriggerLocations(detinfo::DetectorClocksData const
     }
     else if (above_threshold && (val < threshold || i+1 == end_i)) {
       raw::TimeStamp_t trigger_finish = tick_to_timestamp(clockData, waveform.TimeStamp(), i);
-      AddTriggerLocation(this_trigger_locations, {{trigger_start, trigger_finish}});
+      // found in time order: no need to sort
+      this_trigger_locations.push_back({{trigger_start, trigger_finish}});
       above_threshold = false;
     }
   }
@@ -144,14 +134,15 @@ void opDetSBNDTriggerAlg::FindTriggerLocations(detinfo::DetectorClocksData const
   //
   // Small speed optimization: if this is the first time we are setting the 
   // trigger times for the channel, just move the vector we already built
-  if (fTriggerRangesPerChannel[channel].size() == 0) {
-    fTriggerRangesPerChannel[channel] = std::move(this_trigger_locations);
+  if (channel_ranges.size() == 0) {
+    channel_ranges = std::move(this_trigger_locations);
   }
-  // Otherwise, merge them in and keep things sorted in time
+  // Otherwise, merge the two sorted lists, keeping things sorted in time
   else {
-    for (const std::array<raw::TimeStamp_t, 2> &trigger_range: this_trigger_ranges) {
-      AddTriggerLocation(fTriggerRangesPerChannel[channel], trigger_range);
-    }
+    const size_t n_old = channel_ranges.size();
+    channel_ranges.insert(channel_ranges.end(), this_trigger_locations.begin(), this_trigger_locations.end());
+    std::inplace_merge(channel_ranges.begin(), channel_ranges.begin() + n_old, channel_ranges.end(),
+      [](const auto &lhs, const auto &rhs) { return lhs[0] < rhs[0]; });
   }
 
 }
@@ -215,10 +206,12 @@ void opDetSBNDTriggerAlg::MergeTriggerLocations() {
         trigger.start = trigger_range[0];
         trigger.finish = trigger_range[1];
         trigger.channel = this_channel;
-        AddTriggerPrimitive(all_trigger_locations, trigger);
+        all_trigger_locations.push_back(trigger);
       }
     }
   }
+  std::stable_sort(all_trigger_locations.begin(), all_trigger_locations.end(),
+    [](auto const &lhs, auto const &rhs) { return lhs.start < rhs.start; });
 
   // Now merge the trigger locations we have 
   //
@@ -233,12 +226,16 @@ void opDetSBNDTriggerAlg::MergeTriggerLocations() {
   // synched.
   bool was_triggering = false;
 
-  std::vector<TriggerPrimitive> primitives;
+  // primitives still active, the one finishing first on top
+  auto finishes_later = [](TriggerPrimitive const &lhs, TriggerPrimitive const &rhs)
+    { return lhs.finish > rhs.finish; };
+  std::priority_queue<TriggerPrimitive, std::vector<TriggerPrimitive>, decltype(finishes_later)>
+    primitives(finishes_later);
   for (const TriggerPrimitive &primitive: all_trigger_locations) {
-    AddTriggerPrimitiveFinish(primitives, primitive);
-    while (primitives.back().finish < primitive.start) {
-      // remove the final element
-      primitives.resize(primitives.size() - 1);
+    primitives.push(primitive);
+    // remove the primitives which finished before this one started
+    while (primitives.top().finish < primitive.start) {
+      primitives.pop();
     }
 
     bool is_triggering = primitives.size() >= fConfig.TriggerChannelCount();
@@ -324,8 +321,15 @@ double opDetSBNDTriggerAlg::ReadoutWindowPostTriggerBeam(raw::Channel_t channel)
 std::vector<raw::OpDetWaveform> opDetSBNDTriggerAlg::ApplyTriggerLocations(detinfo::DetectorClocksData const& clockData,
                                                                            const raw::OpDetWaveform &waveform) const {
   std::vector<raw::OpDetWaveform> ret;
+  ApplyTriggerLocations(clockData, waveform, ret);
+  return ret;
+}
+
+void opDetSBNDTriggerAlg::ApplyTriggerLocations(detinfo::DetectorClocksData const& clockData,
+                                                const raw::OpDetWaveform &waveform,
+                                                std::vector<raw::OpDetWaveform> &ret) const {
   raw::Channel_t channel = waveform.ChannelNumber();
-  // if (channel > (unsigned)fOpDetMap.size()) return {};
+  // if (channel > (unsigned)fOpDetMap.size()) return;
 
   const std::vector<raw::TimeStamp_t> &trigger_times = GetTriggerTimes(channel);
 
@@ -336,57 +340,34 @@ std::vector<raw::OpDetWaveform> opDetSBNDTriggerAlg::ApplyTriggerLocations(detin
   double beam_readout_window_post_trigger = ReadoutWindowPostTriggerBeam(channel);
   double beam_trigger_time = fConfig.BeamTriggerTime();
 
+  // The readout windows of this channel, merged where they overlap or
+  // touch, so that each one becomes one OpDetWaveform
+  TriggerWindowSet windows;
+  for (raw::TimeStamp_t trigger_time: trigger_times) {
+    windows.Add(trigger_time - readout_window_pre_trigger, trigger_time + readout_window_post_trigger);
+  }
+  if (fConfig.BeamTriggerEnable()) {
+    windows.Add(beam_trigger_time - beam_readout_window_pre_trigger,
+                beam_trigger_time + beam_readout_window_post_trigger);
+  }
+
+  // Single pass: copy the ticks in [start, end) of each window
   const std::vector<raw::ADC_Count_t> &adcs = waveform; // upcast to get adcs
-  unsigned trigger_i = 0;
-  raw::OpDetWaveform this_waveform;
-  bool was_triggering = false;
-  for (size_t i = 0; i < adcs.size(); i++) {
-    double time = tick_to_timestamp(clockData, waveform.TimeStamp(), i);
-
-    // first, scroll to the next readout window that ends after this time
-    while (trigger_i < trigger_times.size() && time >= trigger_times[trigger_i] + readout_window_post_trigger) {
-      trigger_i += 1;
-    } 
-    // see if we are reading out
-    bool has_next_trigger = trigger_i < trigger_times.size();
-    bool has_beam_trigger = fConfig.BeamTriggerEnable();
-
-    bool is_triggering = false;
-    // check next trigger
-    if (has_next_trigger) {
-      if (time >= trigger_times[trigger_i] - readout_window_pre_trigger &&
-          time < trigger_times[trigger_i] + readout_window_post_trigger) {
-            is_triggering = true;
-      }
-    }
-    // otherwise check beam trigger
-    if (!is_triggering && has_beam_trigger) {
-      if (time >= beam_trigger_time - beam_readout_window_pre_trigger &&
-          time < beam_trigger_time + beam_readout_window_post_trigger) {
-        is_triggering = true;
-      }
-    }
-    // We were triggering and we still are! Add this adc count to the list
-    if (is_triggering && was_triggering) {
-      this_waveform.push_back(adcs[i]); 
-    } 
-    // No longer triggering -- save the waveform
-    else if (!is_triggering && was_triggering) {
-      ret.push_back(std::move(this_waveform));
+  size_t tick = 0;
+  raw::OpDetWaveform *this_waveform = nullptr;
+  for (const auto &window: windows) {
+    size_t first = first_tick_from(clockData, waveform.TimeStamp(), window.first, tick, adcs.size());
+    size_t last = first_tick_from(clockData, waveform.TimeStamp(), window.second, first, adcs.size());
+    if (last == first) continue;
+
+    // no tick between this window and the previous one: same waveform
+    if (!this_waveform || first != tick) {
+      this_waveform = &ret.emplace_back(tick_to_timestamp(clockData, waveform.TimeStamp(), first), channel);
     }
-    // New Trigger! make a new OpDetWaveform
-    else if (is_triggering && !was_triggering) {
-      this_waveform = raw::OpDetWaveform(time, channel); 
-      this_waveform.push_back(adcs[i]);
-    }
-    // last adc -- save the waveform
-    if (is_triggering && i+1 == adcs.size()) {
-      ret.push_back(std::move(this_waveform));
-    }
- 
-    was_triggering = is_triggering;
+    this_waveform->insert(this_waveform->end(), adcs.begin() + first, adcs.begin() + last);
+    tick = last;
+    if (tick == adcs.size()) break;
   }
-  return ret;
 }
 
 } // namespace opdet
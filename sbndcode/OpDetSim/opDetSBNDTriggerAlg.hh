@@ -225,6 +225,11 @@ namespace opdet {
     // Apply trigger locations to an input OpDetWaveform
     std::vector<raw::OpDetWaveform> ApplyTriggerLocations(detinfo::DetectorClocksData const& clockData, const raw::OpDetWaveform &waveform) const;
 
+    // Same, appending the waveforms of all the readout windows to triggered
+    void ApplyTriggerLocations(detinfo::DetectorClocksData const& clockData,
+                               const raw::OpDetWaveform &waveform,
+                               std::vector<raw::OpDetWaveform> &triggered) const;
+
     // Returns the time range over which triggers are enabled over a range [start, end]
     std::array<double, 2> TriggerEnableWindow(detinfo::DetectorClocksData const& clockData,
                                               detinfo::DetectorPropertiesData const& detProp) const;
@@ -18,6 +18,7 @@
 #include "messagefacility/MessageLogger/MessageLogger.h"
 #include "canvas/Utilities/Exception.h"
 #include "canvas/Utilities/InputTag.h"
+#include "cetlib_except/exception.h"
 #include "art/Framework/Services/Registry/ServiceHandle.h"
 #include "art_root_io/TFileService.h"
 
@@ -39,13 +40,17 @@
 
 #include <memory>
 #include <algorithm>
+#include <chrono>
 #include <vector>
 #include "TMath.h"
 #include "TH1D.h"
 #include "TRandom3.h"
 #include "TF1.h"
 
-#include "sbndcode/OpDetSim/sbndPDMapAlg.hh"
+#include "larcore/CoreUtils/ServiceUtil.h"
+#include "sbndcode/OpDetSim/PDTypeTableServiceSBND.h"
+#include "sbndcode/OpDetSim/OpHitPeakFinder.hh"
+#include "sbndcode/OpDetSim/OpWaveformFilters.hh"
 
 namespace opdet {
 
@@ -65,7 +70,8 @@ namespace opdet {
 
     // Required functions.
     void produce(art::Event & e) override;
-    opdet::sbndPDMapAlg map; //map for photon detector types
+    void endJob() override;
+    opdet::sbndPDTypeTable const& pdTypes = *lar::providerFrom<opdet::PDTypeTableServiceSBND>(); //photon detector types
 
   private:
 
@@ -84,28 +90,34 @@ namespace opdet {
     int fThresholdArapuca; //in ADC
     int fEvNumber;
     int fChNumber;
-    std::string opdetType;
+    opdet::PDType opdetType;
     int threshold;
-    std::vector<double> fwaveform;
-    std::vector<double> outwvform;
+    enum class BaselineMethod { kWindow, kHistogramMode, kRollingMedian };
+    BaselineMethod fBaselineMethod;
+    size_t fBaselineHalfWindow; //in ticks, for the rolling median
+    opdet::TV1DDenoiser fDenoiser;
+    std::vector<float> fwaveform; // baseline-subtracted waveform, with positive pulses
+    std::vector<float> fBaseline; // baseline of each tick, for the rolling median
+    std::vector<opdet::OpHitPeak> fPeaks; // peaks of the current waveform
+
+    // time spent in each stage (s), for all the waveforms
+    struct StageTimes {
+      double baseline = 0.;
+      double denoise = 0.;
+      double peaks = 0.;
+      unsigned long nWaveforms = 0;
+      unsigned long nSamples = 0;
+    } fStageTimes;
     //int fSize;
     //int fTimePMT;         //Start time of PMT signal
     //int fTimeMax;         //Time of maximum (minimum) PMT signal
-    void subtractBaseline(std::vector<double>& waveform, std::string pdtype, double& rms);
-    bool findAndSuppressPeak(std::vector<double>& waveform, size_t& timebin,
-                             double& Area, double& amplitude,
-                             const int& threshold, const std::string& opdetType);
-    void denoise(std::vector<double>& waveform, std::vector<double>& outwaveform);
-    bool TV1D_denoise(std::vector<double>& waveform,
-                      std::vector<double>& outwaveform,
-                      const double lambda);
-    void TV1D_denoise_v2(std::vector<double>& input, std::vector<double>& output,
-                         unsigned int width, const double lambda);
+    void subtractBaseline(std::vector<raw::ADC_Count_t> const& adcs, double polarity, double& rms);
     //std::stringstream histname;
   };
 
   opHitFinderSBND::opHitFinderSBND(fhicl::ParameterSet const & p)
     : EDProducer{p}
+    , fDenoiser(p.get<double>("DenoisingLambda", 10.0))
       // Initialize member data here.
   {
     fInputModuleName = p.get< std::string >("InputModule" );
@@ -119,6 +131,17 @@ namespace opdet {
     fPulsePolarityArapuca = p.get<int>("PulsePolarityArapuca");
     fUseDenoising     = p.get< bool  >("UseDenoising");
 
+    const std::string baselineMethod = p.get<std::string>("BaselineMethod", "window");
+    if (baselineMethod == "window") fBaselineMethod = BaselineMethod::kWindow;
+    else if (baselineMethod == "mode") fBaselineMethod = BaselineMethod::kHistogramMode;
+    else if (baselineMethod == "median") fBaselineMethod = BaselineMethod::kRollingMedian;
+    else {
+      throw cet::exception("opHitFinderSBND")
+        << "Unknown BaselineMethod '" << baselineMethod
+        << "' (expected \"window\", \"mode\" or \"median\")\n";
+    }
+    fBaselineHalfWindow = p.get<size_t>("BaselineMedianWindow", 1000) / 2; //in ticks
+
     auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataForJob();
     fSampling = clockData.OpticalClock().Frequency(); // MHz
 
@@ -134,7 +157,7 @@ namespace opdet {
 
     std::unique_ptr< std::vector< recob::OpHit > > pulseVecPtr(std::make_unique< std::vector< recob::OpHit > > ());
     fwaveform.reserve(30000); // TODO: no hardcoded value
-    outwvform.reserve(30000); // TODO: no hardcoded value
+    using clock = std::chrono::steady_clock;
 
     art::ServiceHandle<art::TFileService> tfs;
     art::Handle< std::vector< raw::OpDetWaveform > > wvfHandle;
@@ -158,59 +181,74 @@ namespace opdet {
       }
 
       fChNumber = wvf.ChannelNumber();
-      opdetType = map.pdType(fChNumber);
-      if(opdetType == "pmt_coated" || opdetType == "pmt_uncoated") {
+      opdetType = pdTypes.type(fChNumber);
+      if(pdTypes.isPMT(fChNumber)) {
         threshold = fThresholdPMT;
       }
-      else if((opdetType == "arapuca_vuv") || (opdetType == "arapuca_vis")) {
+      else if((opdetType == PDType::kArapucaVUV) || (opdetType == PDType::kArapucaVIS)) {
         threshold = fThresholdArapuca;
       }
-      else if((opdetType == "xarapuca_vuv") || (opdetType == "xarapuca_vis")) {
+      else if((opdetType == PDType::kXArapucaVUV) || (opdetType == PDType::kXArapucaVIS)) {
         threshold = fThresholdArapuca;
       }
       else {
-        mf::LogWarning("opHitFinder") << "Unexpected OpChannel: " << opdetType;
+        mf::LogWarning("opHitFinder") << "Unexpected OpChannel: " << PDTypeName(opdetType);
         continue;
       }
 
-      fwaveform.resize(wvf.size());
-      for(unsigned int i = 0; i < wvf.size(); i++) {
-        fwaveform[i] = wvf[i];
-      }
-
-      subtractBaseline(fwaveform, opdetType, rms);
+      // the baseline is estimated on the ADC counts, and subtracted
+      // while filling the buffer
+      auto stageStart = clock::now();
+      subtractBaseline(wvf, pdTypes.isPMT(fChNumber)? fPulsePolarityPMT: fPulsePolarityArapuca, rms);
+      auto stageEnd = clock::now();
+      fStageTimes.baseline += std::chrono::duration<double>(stageEnd - stageStart).count();
 
       if(fUseDenoising) {
-        if((opdetType == "pmt_coated") || (opdetType == "pmt_uncoated")) {
+        if((opdetType == PDType::kPMTCoated) || (opdetType == PDType::kPMTUncoated)) {
         }
-        else if((opdetType == "arapuca_vuv") || (opdetType == "arapuca_vis")) {
-          denoise(fwaveform, outwvform);
+        else if((opdetType == PDType::kArapucaVUV) || (opdetType == PDType::kArapucaVIS)) {
+          fDenoiser(fwaveform);
         }
-        else if((opdetType == "xarapuca_vuv") || (opdetType == "xarapuca_vis")) {
-          denoise(fwaveform, outwvform);
+        else if((opdetType == PDType::kXArapucaVUV) || (opdetType == PDType::kXArapucaVIS)) {
+          fDenoiser(fwaveform);
         }
         else {
-          mf::LogInfo("opHitFinder") << "Unexpected OpChannel: " << opdetType
+          mf::LogInfo("opHitFinder") << "Unexpected OpChannel: " << PDTypeName(opdetType)
                     << ", continue." << std::endl;
           std::terminate();
         }
+        stageStart = stageEnd;
+        stageEnd = clock::now();
+        fStageTimes.denoise += std::chrono::duration<double>(stageEnd - stageStart).count();
       }
 
+      // all the peaks in one pass, largest first
       // TODO: pass rms to this function once that's sorted. ~icaza
-      while(findAndSuppressPeak(fwaveform, timebin, Area, amplitude, threshold, opdetType)){
+      FindOpHitPeaks(fwaveform, threshold, fPeaks);
+      fStageTimes.peaks += std::chrono::duration<double>(clock::now() - stageEnd).count();
+      ++fStageTimes.nWaveforms;
+      fStageTimes.nSamples += wvf.size();
+      for(OpHitPeak const& peak : fPeaks){
+        timebin = peak.timebin;
+        amplitude = peak.amplitude;
+        // integrate the area below the peak
+        // note that fSampling is in MHz and
+        // we convert it to GHz here so as to
+        // have an area in ADC*ns.
+        Area = peak.sum / (fSampling / 1000.);
         time = wvf.TimeStamp() + (double)timebin / fSampling;
 
-        if(opdetType == "pmt_coated" || opdetType == "pmt_uncoated") {
+        if(opdetType == PDType::kPMTCoated || opdetType == PDType::kPMTUncoated) {
           phelec = Area / fArea1pePMT;
         }
-        else if((opdetType == "arapuca_vuv") || (opdetType == "arapuca_vis")) {
+        else if((opdetType == PDType::kArapucaVUV) || (opdetType == PDType::kArapucaVIS)) {
           phelec = Area / fArea1peSiPM;
         }
-        else if((opdetType == "xarapuca_vuv") || (opdetType == "xarapuca_vis")) {
+        else if((opdetType == PDType::kXArapucaVUV) || (opdetType == PDType::kXArapucaVIS)) {
           phelec = Area / fArea1peSiPM;
         }
         else {
-          mf::LogWarning("opHitFinder")  << "Unexpected OpChannel: " << opdetType
+          mf::LogWarning("opHitFinder")  << "Unexpected OpChannel: " << PDTypeName(opdetType)
                                          << ", continue.";
           continue;
         }
@@ -218,309 +256,49 @@ namespace opdet {
         //including hit info: OpChannel, PeakTime, PeakTimeAbs, Frame, Width, Area, PeakHeight, PE, FastToTotal
         recob::OpHit opHit(fChNumber, time, time, frame, FWHM, Area, amplitude, phelec, fasttotal);
         pulseVecPtr->emplace_back(opHit);
-      } // while findAndSuppressPeak()
+      } // for peaks
     } // for(auto const& wvf : (*wvfHandle)){
     e.put(std::move(pulseVecPtr));
-    std::vector<double>().swap(fwaveform); // clear and release the memory of fwaveform
-    std::vector<double>().swap(outwvform); // clear and release the memory of outwvform
+    std::vector<float>().swap(fwaveform); // clear and release the memory of fwaveform
+    std::vector<float>().swap(fBaseline); // clear and release the memory of fBaseline
   } // void opHitFinderSBND::produce(art::Event & e)
 
+  void opHitFinderSBND::endJob()
+  {
+    const double perWaveform = fStageTimes.nWaveforms? 1e6 / fStageTimes.nWaveforms: 0.;
+    mf::LogInfo("opHitFinder")
+      << "Processed " << fStageTimes.nWaveforms << " waveforms (" << fStageTimes.nSamples << " ticks):"
+      << "\n  baseline:  " << fStageTimes.baseline << " s (" << fStageTimes.baseline * perWaveform << " us/waveform)"
+      << "\n  denoising: " << fStageTimes.denoise << " s (" << fStageTimes.denoise * perWaveform << " us/waveform)"
+      << "\n  peaks:     " << fStageTimes.peaks << " s (" << fStageTimes.peaks * perWaveform << " us/waveform)";
+  }
+
   DEFINE_ART_MODULE(opHitFinderSBND)
 
-  void opHitFinderSBND::subtractBaseline(std::vector<double>& waveform,
-                                         std::string pdtype, double& rms)
+  void opHitFinderSBND::subtractBaseline(std::vector<raw::ADC_Count_t> const& adcs,
+                                         double polarity, double& rms)
   {
-    double baseline = 0.0;
+    // noise of the pre-trigger window, around its mean
+    const size_t cnt = std::min<size_t>(fBaselineSample, adcs.size());
+    const double windowBaseline = WindowBaseline(adcs, cnt);
     rms = 0.0;
-    int cnt = 0;
-    // TODO: this is broken it assumes that the beginning of the
-    // waveform is only noise, which is not always the case. ~icaza.
-    // TODO: use std::accumulate instead of this loop. ~icaza.
-    for(int i = 0; i < fBaselineSample; i++) {
-      baseline += waveform[i];
-      rms += std::pow(waveform[i], 2);
-      cnt++;
-    }
-
-    baseline = baseline / cnt;
-    rms = sqrt(rms / cnt - baseline * baseline);
+    for(size_t i = 0; i < cnt; i++) rms += std::pow(adcs[i], 2);
+    rms = sqrt(rms / cnt - windowBaseline * windowBaseline);
     rms = rms / sqrt(cnt - 1);
 
-    if(pdtype == "pmt_coated" || pdtype == "pmt_uncoated") {
-      for(unsigned int i = 0; i < waveform.size(); i++) waveform[i] = fPulsePolarityPMT * (waveform[i] - baseline);
-    }
-    else if((opdetType == "arapuca_vuv") || (opdetType == "arapuca_vis")) {
-      for(unsigned int i = 0; i < waveform.size(); i++) waveform[i] = fPulsePolarityArapuca * (waveform[i] - baseline);
-    }
-    else if((opdetType == "xarapuca_vuv") || (opdetType == "xarapuca_vis")) {
-      for(unsigned int i = 0; i < waveform.size(); i++) waveform[i] = fPulsePolarityArapuca * (waveform[i] - baseline);
-    }
-    else {
-      mf::LogWarning("opHitFinder") << "Unexpected OpChannel: " << opdetType;
+    fwaveform.resize(adcs.size());
+    if(fBaselineMethod == BaselineMethod::kRollingMedian) {
+      RollingMedianBaseline(adcs, fBaselineHalfWindow, fBaseline);
+      for(size_t i = 0; i < adcs.size(); i++) fwaveform[i] = polarity * (adcs[i] - fBaseline[i]);
       return;
     }
-  }
-
-
-  // TODO: pass rms to this function once that's sorted. ~icaza
-  bool opHitFinderSBND::findAndSuppressPeak(std::vector<double>& waveform,
-                                            size_t& timebin, double& Area,
-                                            double& amplitude, const int& threshold,
-                                            const std::string& opdetType)
-  {
-
-    std::vector<double>::iterator max_element_it = std::max_element(waveform.begin(), waveform.end());
-    amplitude = *max_element_it;
-    if(amplitude < threshold) return false; // stop if there's no more peaks
-    timebin = std::distance(waveform.begin(), max_element_it);
-
-    // it_e contains the iterator to the last element in the peak
-    // where waveform is above threshold
-    auto it_e = std::find_if(max_element_it,
-                            waveform.end(),
-                            [threshold](const double& x)->bool
-                              {return x < threshold;} );
-    // it_s contains the iterator to the first element in the peak
-    // where waveform is above threshold
-    auto it_s = std::find_if(std::make_reverse_iterator(max_element_it),
-                            std::make_reverse_iterator(waveform.begin()),
-                            [threshold](const double& x)->bool
-                              {return x < threshold;} ).base();
-
-    // integrate the area below the peak
-    // note that fSampling is in MHz and
-    // we convert it to GHz here so as to
-    // have an area in ADC*ns.
-    Area = std::accumulate(it_s, it_e, 0.0);
-    Area = Area / (fSampling / 1000.);
-
-    // TODO: try to just remove this
-    // TODO: better even, return iterator to last position
-    std::fill(it_s, it_e, 0.0); // zeroes out that peak
-    return true;
-  } // bool opHitFinderSBND::findAndSuppressPeak()
-
-
-  void opHitFinderSBND::denoise(std::vector<double>& waveform, std::vector<double>& outwaveform)
-  {
-
-    int wavelength = waveform.size();
-    outwaveform = waveform;  // copy
-    double lambda = 10.0;
-    const uint retries = 5; uint try_ = 0;
-    if (wavelength > 0) {
-      while (try_ <= retries) {
-        if (TV1D_denoise(waveform, outwaveform, lambda)) break;
-        try_++;
-        mf::LogInfo("opHitFinder") << try_ << "/" << retries
-                                   << " Coming out of TV1D_denoise() unsuccessfully, "
-                                   << "using lambda: " << lambda;
-        lambda += 0.1 * lambda;
-        if (try_ == retries) mf::LogWarning("opHitFinder") <<  "Couldn't denoise!";
-      }
-    }
-    // if (wavelength > 0) TV1D_denoise_v2(waveform, outwaveform, wavelength, lambda);
-
-    // TODO: fairly certain this for is completely redundant,
-    // and if not a std::move or swap would be better. ~icaza
-    for(int i = 0; i < wavelength; i++) {
-      if(outwaveform[i]) waveform[i] = outwaveform[i];
-    }
-  } // void opHitFinderSBND::denoise()
-
-  // TODO: this function is not robust, check if the expected input is given and put exceptions
-  bool opHitFinderSBND::TV1D_denoise(std::vector<double>& waveform,
-                                     std::vector<double>& outwaveform,
-                                     const double lambda)
-  {
-    int width = waveform.size();
-    int k = 0, k0 = 0; // k: current sample location, k0: beginning of current segment
-    double umin = lambda, umax = -lambda; // u is the dual variable
-    double vmin = waveform[0] - lambda, vmax = waveform[0] + lambda; // bounds for the segment's value
-    int kplus = 0, kminus = 0; // last positions where umax=-lambda, umin=lambda, respectively
-    const double twolambda = 2.0 * lambda; // auxiliary variable
-    const double minlambda = -lambda; // auxiliary variable
-    for (;;) { // simple loop, the exit test is inside
-      while (k == width - 1) { // we use the right boundary condition
-        if (umin < 0.0) { // vmin is too high -> negative jump necessary
-          do outwaveform[k0++] = vmin; while (k0 <= kminus);
-          umax = (vmin = waveform[kminus = k = k0]) + (umin = lambda) - vmax;
-        }
-        else if (umax > 0.0) { // vmax is too low -> positive jump necessary
-          do outwaveform[k0++] = vmax; while (k0 <= kplus);
-          umin = (vmax = waveform[kplus = k = k0]) + (umax = minlambda) - vmin;
-        }
-        else {
-          vmin += umin / (k - k0 + 1);
-          do outwaveform[k0++] = vmin; while(k0 <= k);
-          return true;
-        }
-      } // while (k == width - 1)
-      if ((umin += waveform[k + 1] - vmin) < minlambda) { // negative jump necessary
-        if (k0 > width) return false;
-        do outwaveform[k0++] = vmin; while (k0 <= kminus);
-        vmax = (vmin = waveform[kplus = kminus = k = k0]) + twolambda;
-        umin = lambda; umax = minlambda;
-      }
-      else if ((umax += waveform[k + 1] - vmax) > lambda) { // positive jump necessary
-        if (k0 > width) return false;
-        do outwaveform[k0++] = vmax; while (k0 <= kplus);
-        vmin = (vmax = waveform[kplus = kminus = k = k0]) - twolambda;
-        umin = lambda; umax = minlambda;
-      }
-      else {   //no jump necessary, we continue
-        k++;
-        if (k > width) return false;
-        if (umin >= lambda) { // update of vmin
-          vmin += (umin - lambda) / ((kminus = k) - k0 + 1);
-          umin = lambda;
-        }
-        if (umax <= minlambda) { // update of vmax
-          vmax += (umax + lambda) / ((kplus = k) - k0 + 1);
-          umax = minlambda;
-        }
-      }
-    } // for (;;)
-  } // bool opHitFinderSBND::TV1D_denoise()
 
-
-  void opHitFinderSBND::TV1D_denoise_v2(std::vector<double>& input, std::vector<double>& output,
-                                        unsigned int width, const double lambda)
-  {
-    // unsigned int* indstart_low = malloc(sizeof *indstart_low * width);
-    // unsigned int* indstart_up = malloc(sizeof *indstart_up * width);
-    std::vector<unsigned int> indstart_low(width);
-    std::vector<unsigned int> indstart_up(width);
-    unsigned int j_low = 0, j_up = 0, jseg = 0, indjseg = 0, i = 1, indjseg2, ind;
-    double output_low_first = input[0] - lambda;
-    double output_low_curr = output_low_first;
-    double output_up_first = input[0] + lambda;
-    double output_up_curr = output_up_first;
-    const double twolambda = 2.0 * lambda;
-    if (width == 1) {
-      output[0] = input[0];
-      return;
-    }
-    indstart_low[0] = 0;
-    indstart_up[0] = 0;
-    width--;
-    for (; i < width; i++) {
-      if (input[i] >= output_low_curr) {
-        if (input[i] <= output_up_curr) {
-          output_up_curr += (input[i] - output_up_curr) / (i - indstart_up[j_up] + 1);
-          output[indjseg] = output_up_first;
-          while ((j_up > jseg) && (output_up_curr <= output[ind = indstart_up[j_up - 1]]))
-            output_up_curr += (output[ind] - output_up_curr) *
-                              ((double)(indstart_up[j_up--] - ind) / (i - ind + 1));
-          if (j_up == jseg) {
-            while ((output_up_curr <= output_low_first) && (jseg < j_low)) {
-              indjseg2 = indstart_low[++jseg];
-              output_up_curr += (output_up_curr - output_low_first) *
-                                ((double)(indjseg2 - indjseg) / (i - indjseg2 + 1));
-              while (indjseg < indjseg2) output[indjseg++] = output_low_first;
-              output_low_first = output[indjseg];
-            }
-            output_up_first = output_up_curr;
-            indstart_up[j_up = jseg] = indjseg;
-          }
-          else output[indstart_up[j_up]] = output_up_curr;
-        }
-        else
-          output_up_curr = output[i] = input[indstart_up[++j_up] = i];
-        output_low_curr += (input[i] - output_low_curr) / (i - indstart_low[j_low] + 1);
-        output[indjseg] = output_low_first;
-        while ((j_low > jseg) && (output_low_curr >= output[ind = indstart_low[j_low - 1]]))
-          output_low_curr += (output[ind] - output_low_curr) *
-                             ((double)(indstart_low[j_low--] - ind) / (i - ind + 1));
-        if (j_low == jseg) {
-          while ((output_low_curr >= output_up_first) && (jseg < j_up)) {
-            indjseg2 = indstart_up[++jseg];
-            output_low_curr += (output_low_curr - output_up_first) *
-                               ((double)(indjseg2 - indjseg) / (i - indjseg2 + 1));
-            while (indjseg < indjseg2) output[indjseg++] = output_up_first;
-            output_up_first = output[indjseg];
-          }
-          if ((indstart_low[j_low = jseg] = indjseg) == i) output_low_first = output_up_first - twolambda;
-          else output_low_first = output_low_curr;
-        }
-        else output[indstart_low[j_low]] = output_low_curr;
-      }
-      else {
-        output_up_curr += ((output_low_curr = output[i] = input[indstart_low[++j_low] = i]) -
-                           output_up_curr) / (i - indstart_up[j_up] + 1);
-        output[indjseg] = output_up_first;
-        while ((j_up > jseg) && (output_up_curr <= output[ind = indstart_up[j_up - 1]]))
-          output_up_curr += (output[ind] - output_up_curr) *
-                            ((double)(indstart_up[j_up--] - ind) / (i - ind + 1));
-        if (j_up == jseg) {
-          while ((output_up_curr <= output_low_first) && (jseg < j_low)) {
-            indjseg2 = indstart_low[++jseg];
-            output_up_curr += (output_up_curr - output_low_first) *
-                              ((double)(indjseg2 - indjseg) / (i - indjseg2 + 1));
-            while (indjseg < indjseg2) output[indjseg++] = output_low_first;
-            output_low_first = output[indjseg];
-          }
-          if ((indstart_up[j_up = jseg] = indjseg) == i) output_up_first = output_low_first + twolambda;
-          else output_up_first = output_up_curr;
-        }
-        else output[indstart_up[j_up]] = output_up_curr;
-      }
-    }
-    /* here i==width (with value the actual width minus one) */
-    if (input[i] + lambda <= output_low_curr) {
-      while (jseg < j_low) {
-        indjseg2 = indstart_low[++jseg];
-        while (indjseg < indjseg2) output[indjseg++] = output_low_first;
-        output_low_first = output[indjseg];
-      }
-      while (indjseg < i) output[indjseg++] = output_low_first;
-      output[indjseg] = input[i] + lambda;
-    }
-    else if (input[i] - lambda >= output_up_curr) {
-      while (jseg < j_up) {
-        indjseg2 = indstart_up[++jseg];
-        while (indjseg < indjseg2) output[indjseg++] = output_up_first;
-        output_up_first = output[indjseg];
-      }
-      while (indjseg < i) output[indjseg++] = output_up_first;
-      output[indjseg] = input[i] - lambda;
-    }
-    else {
-      output_low_curr += (input[i] + lambda - output_low_curr) / (i - indstart_low[j_low] + 1);
-      output[indjseg] = output_low_first;
-      while ((j_low > jseg) && (output_low_curr >= output[ind = indstart_low[j_low - 1]]))
-        output_low_curr += (output[ind] - output_low_curr) *
-                           ((double)(indstart_low[j_low--] - ind) / (i - ind + 1));
-      if (j_low == jseg) {
-        if (output_up_first >= output_low_curr)
-          while (indjseg <= i) output[indjseg++] = output_low_curr;
-        else {
-          output_up_curr += (input[i] - lambda - output_up_curr) / (i - indstart_up[j_up] + 1);
-          output[indjseg] = output_up_first;
-          while ((j_up > jseg) && (output_up_curr <= output[ind = indstart_up[j_up - 1]]))
-            output_up_curr += (output[ind] - output_up_curr) *
-                              ((double)(indstart_up[j_up--] - ind) / (i - ind + 1));
-          while (jseg < j_up) {
-            indjseg2 = indstart_up[++jseg];
-            while (indjseg < indjseg2) output[indjseg++] = output_up_first;
-            output_up_first = output[indjseg];
-          }
-          indjseg = indstart_up[j_up];
-          while (indjseg <= i) output[indjseg++] = output_up_curr;
-        }
-      }
-      else {
-        while (jseg < j_low) {
-          indjseg2 = indstart_low[++jseg];
-          while (indjseg < indjseg2) output[indjseg++] = output_low_first;
-          output_low_first = output[indjseg];
-        }
-        indjseg = indstart_low[j_low];
-        while (indjseg <= i) output[indjseg++] = output_low_curr;
-      }
-    }
-    // free(indstart_low);
-    // free(indstart_up);
-  }// void opHitFinderSBND::TV1D_denoise_v2()
+    // TODO: the window baseline assumes that the beginning of the
+    // waveform is only noise, which is not always the case;
+    // the histogram mode does not.
+    const double baseline = (fBaselineMethod == BaselineMethod::kHistogramMode)?
+      HistogramModeBaseline(adcs): windowBaseline;
+    for(size_t i = 0; i < adcs.size(); i++) fwaveform[i] = polarity * (adcs[i] - baseline);
+  }
 
 } // namespace opdet
@@ -0,0 +1,75 @@
+#include "sbndcode/OpDetSim/sbndPDTypeTable.hh"
+
+#include "cetlib/search_path.h"
+#include "cetlib_except/exception.h"
+#include "larcorealg/Geometry/GeometryCore.h"
+
+#include <fstream>
+
+#include "json.hpp"
+
+//------------------------------------------------------------------------------
+//--- opdet::sbndPDTypeTable implementation
+//------------------------------------------------------------------------------
+
+namespace opdet {
+
+  namespace {
+    std::array<std::string, kNPDTypes + 1> const PDTypeNames {{
+      "pmt_coated", "pmt_uncoated",
+      "xarapuca_vuv", "xarapuca_vis",
+      "arapuca_vuv", "arapuca_vis",
+      "There is no such channel" // as sbndPDMapAlg::pdType()
+    }};
+  }
+
+  std::string const& PDTypeName(PDType type)
+  {
+    return PDTypeNames[static_cast<std::size_t>(type)];
+  }
+
+  PDType PDTypeFromName(std::string const& name)
+  {
+    for (std::size_t t = 0; t < kNPDTypes; t++) {
+      if (PDTypeNames[t] == name) return static_cast<PDType>(t);
+    }
+    return PDType::kUnknown;
+  }
+
+
+  sbndPDTypeTable::sbndPDTypeTable(geo::GeometryCore const* geom, std::string const& mapFile)
+  {
+    std::string fname;
+    cet::search_path sp("FW_SEARCH_PATH");
+    if (!sp.find_file(mapFile, fname)) {
+      throw cet::exception("sbndPDTypeTable") << "Can't find PDS map '" << mapFile << "'\n";
+    }
+    nlohmann::json PDmap;
+    std::ifstream i(fname, std::ifstream::in);
+    i >> PDmap;
+    i.close();
+
+    fChannels.resize(PDmap.size());
+    for (std::size_t ch = 0; ch < PDmap.size(); ch++) {
+      nlohmann::json const& entry = PDmap.at(ch);
+      ChannelInfo& info = fChannels[ch];
+      info.type           = PDTypeFromName(entry.at("pd_type").get<std::string>());
+      info.tpc            = entry.value("tpc", -1);
+      info.pdsBox         = entry.value("pds_box", -1);
+      info.sensitiveToVUV = entry.value("sensible_to_vuv", false);
+      info.sensitiveToVIS = entry.value("sensible_to_vis", false);
+      if (geom && geom->IsValidOpChannel(ch)) {
+        double xyz[3];
+        geom->OpDetGeoFromOpChannel(ch).GetCenter(xyz);
+        info.position = { { xyz[0], xyz[1], xyz[2] } };
+      }
+      fChannelsOfType[static_cast<std::size_t>(info.type)].push_back(ch);
+    }
+  }
+
+  std::vector<unsigned int> const& sbndPDTypeTable::channelsOfType(PDType t) const
+  {
+    return fChannelsOfType[static_cast<std::size_t>(t)];
+  }
+
+} // namespace opdet
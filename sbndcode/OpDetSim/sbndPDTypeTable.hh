@@ -0,0 +1,92 @@
+////////////////////////////////////////////////////////////////////////
+// File:        sbndPDTypeTable.hh
+//
+// Channel-indexed table of the SBND photon detector properties, read once
+// from the PDS map (sbnd_pds_mapping.json, see sbndPDMapAlg) and from the
+// geometry, and immutable afterwards.
+//
+// The detector type is an integer code (opdet::PDType), so that per-hit
+// and per-waveform queries are array lookups and enum comparisons instead
+// of JSON lookups and string comparisons; the name of the type, as used
+// by the JSON map and the digitization algorithms, is still available.
+// The channels of each type are listed once at construction.
+//
+// The table is shared by the modules of a job through
+// opdet::PDTypeTableServiceSBND.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBND_OPDETSIM_SBNDPDTYPETABLE_HH
+#define SBND_OPDETSIM_SBNDPDTYPETABLE_HH
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace geo {
+  class GeometryCore;
+}
+
+namespace opdet {
+
+  enum class PDType : unsigned char {
+    kPMTCoated,
+    kPMTUncoated,
+    kXArapucaVUV,
+    kXArapucaVIS,
+    kArapucaVUV,
+    kArapucaVIS,
+    kUnknown
+  };
+  constexpr std::size_t kNPDTypes = static_cast<std::size_t>(PDType::kUnknown);
+
+  // name of the type in the PDS map ("pmt_coated", ...), and back
+  std::string const& PDTypeName(PDType type);
+  PDType PDTypeFromName(std::string const& name);
+
+  class sbndPDTypeTable {
+
+  public:
+
+    struct ChannelInfo {
+      PDType type = PDType::kUnknown;
+      int tpc = -1;                 // TPC (side of the cathode) the detector faces
+      int pdsBox = -1;
+      bool sensitiveToVUV = false;
+      bool sensitiveToVIS = false;
+      std::array<double, 3> position{ { 0., 0., 0. } }; // center, cm; zero if not in the geometry
+    };
+
+    // read the PDS map from the search path; positions from geom, if any
+    explicit sbndPDTypeTable(geo::GeometryCore const* geom = nullptr,
+                             std::string const& mapFile = "sbnd_pds_mapping.json");
+
+    std::size_t size() const { return fChannels.size(); }
+
+    // type of channel ch, kUnknown if out of the map
+    PDType type(std::size_t ch) const
+      { return (ch < fChannels.size())? fChannels[ch].type: PDType::kUnknown; }
+    bool isType(std::size_t ch, PDType t) const { return type(ch) == t; }
+    bool isPMT(std::size_t ch) const
+      { PDType const t = type(ch); return (t == PDType::kPMTCoated) || (t == PDType::kPMTUncoated); }
+    bool isCoated(std::size_t ch) const { return type(ch) == PDType::kPMTCoated; }
+    std::string const& typeName(std::size_t ch) const { return PDTypeName(type(ch)); }
+
+    // all the properties of channel ch; throws if out of the map
+    ChannelInfo const& channel(std::size_t ch) const { return fChannels.at(ch); }
+    int tpc(std::size_t ch) const { return channel(ch).tpc; }
+    std::array<double, 3> const& position(std::size_t ch) const { return channel(ch).position; }
+
+    // channels of type t, in increasing order
+    std::vector<unsigned int> const& channelsOfType(PDType t) const;
+
+  private:
+
+    std::vector<ChannelInfo> fChannels;
+    std::array<std::vector<unsigned int>, kNPDTypes + 1> fChannelsOfType;
+
+  }; // class sbndPDTypeTable
+
+} // namespace opdet
+
+#endif // SBND_OPDETSIM_SBNDPDTYPETABLE_HH
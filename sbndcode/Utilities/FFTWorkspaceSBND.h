@@ -0,0 +1,164 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   FFTWorkspaceSBND.h
+///
+/// \brief  Private FFT plans and buffers for concurrent (de)convolution.
+///
+/// util::LArFFT owns a single pair of FFTW plans and a single scratch
+/// array, so only one thread at a time may use it. A workspace holds its
+/// own plans and buffers and follows the LArFFT conventions (forward
+/// transform unnormalised, inverse transform divided by the FFT size),
+/// so that each thread can transform its channels independently.
+///
+/// Plans are created with the FFTW "estimate" strategy, which does not
+/// time candidate algorithms: every workspace of a given size computes
+/// bit-identical results, whatever thread it lives on.
+///
+/// Creating and destroying FFTW plans is not thread safe, so those steps
+/// are serialised through a process-wide mutex. Transforms are not.
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef FFTWORKSPACESBND_H
+#define FFTWORKSPACESBND_H
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cetlib_except/exception.h"
+
+#include "TComplex.h"
+#include "TVirtualFFT.h"
+
+namespace util {
+
+  class FFTWorkspaceSBND {
+  public:
+
+    explicit FFTWorkspaceSBND(int size, std::string const& option = "ES");
+    ~FFTWorkspaceSBND();
+
+    FFTWorkspaceSBND(FFTWorkspaceSBND&&) = default;
+    FFTWorkspaceSBND(FFTWorkspaceSBND const&) = delete;
+    FFTWorkspaceSBND& operator= (FFTWorkspaceSBND const&) = delete;
+
+    int Size() const { return fSize; }
+    int FreqSize() const { return fFreqSize; }
+
+    // Forward transform; input shorter than Size() is zero padded.
+    template <class T> void DoFFT(std::vector<T> const& input,
+                                  std::vector<TComplex>& output);
+
+    // Inverse transform, divided by Size() as in LArFFT. The result is
+    // rotated while it is copied out: output[i] = result[(i + shift) % Size()].
+    template <class T> void DoInvFFT(std::vector<TComplex> const& input,
+                                     std::vector<T>& output, int shift = 0);
+
+    // Multiply the spectrum of func by kern, in place, and rotate the
+    // result by shift as in DoInvFFT.
+    template <class T> void Convolute(std::vector<T>& func,
+                                      std::vector<TComplex> const& kern,
+                                      int shift = 0);
+
+  private:
+
+    static std::mutex& PlanMutex();
+
+    int fSize;
+    int fFreqSize;
+    std::unique_ptr<TVirtualFFT> fFFT;         ///< real to complex plan
+    std::unique_ptr<TVirtualFFT> fInverseFFT;  ///< complex to real plan
+    std::vector<TComplex> fCompTemp;           ///< spectrum scratch
+  };
+
+} // namespace util
+
+//----------------------------------------------------------------------
+inline std::mutex& util::FFTWorkspaceSBND::PlanMutex()
+{
+  static std::mutex planMutex;
+  return planMutex;
+}
+
+//----------------------------------------------------------------------
+inline util::FFTWorkspaceSBND::FFTWorkspaceSBND(int size, std::string const& option)
+  : fSize(size)
+  , fFreqSize(size/2 + 1)
+  , fCompTemp(size/2 + 1)
+{
+  if (fSize <= 0)
+    throw cet::exception("FFTWorkspaceSBND") << "Invalid FFT size " << fSize << "\n";
+
+  // "K" keeps TVirtualFFT from deleting or recycling the last transform
+  // it handed out, which may belong to another thread.
+  std::string const fwdOpt = "R2C " + option + " K";
+  std::string const invOpt = "C2R " + option + " K";
+
+  std::lock_guard<std::mutex> lock(PlanMutex());
+  fFFT.reset(TVirtualFFT::FFT(1, &fSize, fwdOpt.c_str()));
+  fInverseFFT.reset(TVirtualFFT::FFT(1, &fSize, invOpt.c_str()));
+  if (!fFFT || !fInverseFFT)
+    throw cet::exception("FFTWorkspaceSBND") << "Could not create FFTW plans of size " << fSize << "\n";
+}
+
+//----------------------------------------------------------------------
+inline util::FFTWorkspaceSBND::~FFTWorkspaceSBND()
+{
+  if (!fFFT && !fInverseFFT) return; // moved from
+  std::lock_guard<std::mutex> lock(PlanMutex());
+  fFFT.reset();
+  fInverseFFT.reset();
+}
+
+//----------------------------------------------------------------------
+template <class T>
+inline void util::FFTWorkspaceSBND::DoFFT(std::vector<T> const& input,
+                                          std::vector<TComplex>& output)
+{
+  int const n = std::min<int>(input.size(), fSize);
+  for (int p = 0; p < n; ++p) fFFT->SetPoint(p, input[p]);
+  for (int p = n; p < fSize; ++p) fFFT->SetPoint(p, 0.);
+  fFFT->Transform();
+
+  output.resize(fFreqSize);
+  double re = 0., im = 0.;
+  for (int i = 0; i < fFreqSize; ++i) {
+    fFFT->GetPointComplex(i, re, im);
+    output[i] = TComplex(re, im);
+  }
+}
+
+//----------------------------------------------------------------------
+template <class T>
+inline void util::FFTWorkspaceSBND::DoInvFFT(std::vector<TComplex> const& input,
+                                             std::vector<T>& output, int shift)
+{
+  for (int i = 0; i < fFreqSize; ++i)
+    fInverseFFT->SetPoint(i, input[i].Re(), input[i].Im());
+  fInverseFFT->Transform();
+
+  output.resize(fSize);
+  double const factor = 1.0/(double) fSize;
+  int src = shift % fSize;
+  if (src < 0) src += fSize;
+  for (int i = 0; i < fSize; ++i) {
+    output[i] = factor*fInverseFFT->GetPointReal(src, false);
+    if (++src == fSize) src = 0;
+  }
+}
+
+//----------------------------------------------------------------------
+template <class T>
+inline void util::FFTWorkspaceSBND::Convolute(std::vector<T>& func,
+                                              std::vector<TComplex> const& kern,
+                                              int shift)
+{
+  DoFFT(func, fCompTemp);
+  for (int i = 0; i < fFreqSize; ++i) fCompTemp[i] *= kern[i];
+  DoInvFFT(fCompTemp, func, shift);
+}
+
+#endif // FFTWORKSPACESBND_H
@@ -29,13 +29,17 @@
 #ifndef SIGNALSHAPINGSERVICELARIAT_H
 #define SIGNALSHAPINGSERVICELARIAT_H
 
+#include <algorithm>
 #include <vector>
 
 #include "fhiclcpp/ParameterSet.h"
 #include "art/Framework/Services/Registry/ActivityRegistry.h"
 #include "art/Framework/Services/Registry/ServiceMacros.h"
 #include "lardata/Utilities/SignalShaping.h"
+#include "larcoreobj/SimpleTypesAndConstants/geo_types.h"
+#include "sbndcode/Utilities/FFTWorkspaceSBND.h"
 namespace detinfo { class DetectorClocksData; }
+namespace art { class Run; }
 
 #include "TF1.h"
 #include "TH1D.h"
@@ -57,7 +61,7 @@ namespace util {
 
     void reconfigure(const fhicl::ParameterSet& pset);
 
-    std::vector<DoubleVec> GetNoiseFactVec()   {return fNoiseFactVec;};
+    std::vector<DoubleVec> const& GetNoiseFactVec() const {return fNoiseFactVec;};
     double GetASICGain(unsigned int const channel) const;
     //double GetShapingTime(unsigned int const channel) const;
     
@@ -65,11 +69,19 @@ namespace util {
     double GetDeconNoise(unsigned int const channel) const;
 
     // Accessors.
+    // The kernels and the per-channel tables are built at the beginning of
+    // each run and are read-only afterwards, so the accessors may be called
+    // concurrently from several threads.
+
+    geo::View_t View(unsigned int channel) const;
 
     const util::SignalShaping& SignalShaping(unsigned int channel) const;
+    const util::SignalShaping& SignalShaping(geo::View_t view) const;
 
     int FieldResponseTOffset(detinfo::DetectorClocksData const& clockData,
                              unsigned int const channel) const;
+    int FieldResponseTOffset(detinfo::DetectorClocksData const& clockData,
+                             geo::View_t view) const;
 
     // Do convolution calcution (for simulation).
 
@@ -81,15 +93,56 @@ namespace util {
     template <class T> void Deconvolute(detinfo::DetectorClocksData const& clockData,
                                         unsigned int channel, std::vector<T>& func) const;
 
-    double GetDeconNorm(){return fDeconNorm;};
+    // Same as above, but transforming with a caller-owned FFT workspace
+    // instead of the shared LArFFT service, so that several threads can
+    // process different channels at the same time.
+
+    template <class T> void Convolute(detinfo::DetectorClocksData const& clockData,
+                                      unsigned int channel, std::vector<T>& func,
+                                      util::FFTWorkspaceSBND& fft) const;
+    template <class T> void Deconvolute(detinfo::DetectorClocksData const& clockData,
+                                        unsigned int channel, std::vector<T>& func,
+                                        util::FFTWorkspaceSBND& fft) const;
+
+    // Batched (de)convolution of a block of waveforms, all from channels of
+    // the given view: the kernel and time offset are looked up once for the
+    // whole block, the FFT plans and scratch space of the workspace are
+    // reused, and the time offset is applied while the inverse transform is
+    // copied out, without temporary vectors.
+
+    template <class T> void ConvoluteBlock(detinfo::DetectorClocksData const& clockData,
+                                           geo::View_t view, std::vector<std::vector<T>*> const& funcs,
+                                           util::FFTWorkspaceSBND& fft) const;
+    template <class T> void DeconvoluteBlock(detinfo::DetectorClocksData const& clockData,
+                                             geo::View_t view, std::vector<std::vector<T>*> const& funcs,
+                                             util::FFTWorkspaceSBND& fft) const;
+
+    double GetDeconNorm() const {return fDeconNorm;};
 
   private:
 
+    // Build the kernels and the per-channel tables.
+
+    void preBeginRun(const art::Run& run);
+    void BuildChannelTables();
+
+    // Index of the plane parameters (0: U, 1: V, 2: Z) of a view.
+
+    static unsigned int PlaneIndex(geo::View_t view);
+
+    // Throw unless the per-channel tables have an entry for channel.
+
+    void CheckChannel(unsigned int channel) const;
+
+    // Move the field response time offset out of a (de)convoluted waveform.
+
+    template <class T> static void ShiftConvoluted(std::vector<T>& func, int time_offset);
+    template <class T> static void ShiftDeconvoluted(std::vector<T>& func, int time_offset);
+
     // Private configuration methods.
 
     // Post-constructor initialization.
 
-    void init() const{const_cast<SignalShapingServiceSBND*>(this)->init();}
     void init();
 
     // Calculate response functions.
@@ -165,6 +218,13 @@ namespace util {
     std::vector<TComplex> fIndUFilter;
     std::vector<TComplex> fIndVFilter;
     std::vector<TComplex> fColFilter;
+
+    // Per-channel lookup tables, indexed by channel number.
+
+    std::vector<geo::View_t> fChannelView;
+    std::vector<double> fChannelASICGain;
+    std::vector<double> fChannelRawNoise;
+    std::vector<double> fChannelDeconNoise;
   };
 }
 //----------------------------------------------------------------------
@@ -174,19 +234,28 @@ template <class T> inline void util::SignalShapingServiceSBND::Convolute(detinfo
 {
   SignalShaping(channel).Convolute(func);
 
-  //negative number;
-  int time_offset = FieldResponseTOffset(clockData, channel);
-  
-  std::vector<T> temp;
-  if (time_offset <= 0) {
-    temp.assign(func.begin(),func.begin()-time_offset);
-    func.erase(func.begin(),func.begin()-time_offset);
-    func.insert(func.end(),temp.begin(),temp.end());
-  }else{
-    temp.assign(func.end()-time_offset,func.end());
-    func.erase(func.end()-time_offset,func.end());
-    func.insert(func.begin(),temp.begin(),temp.end());
-  }
+  ShiftConvoluted(func, FieldResponseTOffset(clockData, channel));
+}
+
+template <class T> inline void util::SignalShapingServiceSBND::Convolute(detinfo::DetectorClocksData const& clockData,
+                                                                         unsigned int channel, std::vector<T>& func,
+                                                                         util::FFTWorkspaceSBND& fft) const
+{
+  std::vector<std::vector<T>*> const funcs{ &func };
+  ConvoluteBlock(clockData, View(channel), funcs, fft);
+}
+
+template <class T> inline void util::SignalShapingServiceSBND::ConvoluteBlock(detinfo::DetectorClocksData const& clockData,
+                                                                              geo::View_t view,
+                                                                              std::vector<std::vector<T>*> const& funcs,
+                                                                              util::FFTWorkspaceSBND& fft) const
+{
+  std::vector<TComplex> const& kern = SignalShaping(view).ConvKernel();
+
+  // undo the (negative) time offset: func[i] <- func[i - time_offset]
+  int const shift = -FieldResponseTOffset(clockData, view);
+
+  for (std::vector<T>* func: funcs) fft.Convolute(*func, kern, shift);
 }
 
 
@@ -196,21 +265,52 @@ template <class T> inline void util::SignalShapingServiceSBND::Deconvolute(detin
                                                                            unsigned int channel, std::vector<T>& func) const
 {
   SignalShaping(channel).Deconvolute(func);
-  
-  //negative number;
-  int time_offset = FieldResponseTOffset(clockData, channel);
-  
-  std::vector<T> temp;
-  if (time_offset <= 0) {
-    temp.assign(func.end()+time_offset,func.end());
-    func.erase(func.end()+time_offset,func.end());
-    func.insert(func.begin(),temp.begin(),temp.end());
-  }else{
-    temp.assign(func.begin(),func.begin()+time_offset);
-    func.erase(func.begin(),func.begin()+time_offset);
-    func.insert(func.end(),temp.begin(),temp.end());
-  }
-  
+
+  ShiftDeconvoluted(func, FieldResponseTOffset(clockData, channel));
+}
+
+template <class T> inline void util::SignalShapingServiceSBND::Deconvolute(detinfo::DetectorClocksData const& clockData,
+                                                                           unsigned int channel, std::vector<T>& func,
+                                                                           util::FFTWorkspaceSBND& fft) const
+{
+  std::vector<std::vector<T>*> const funcs{ &func };
+  DeconvoluteBlock(clockData, View(channel), funcs, fft);
+}
+
+template <class T> inline void util::SignalShapingServiceSBND::DeconvoluteBlock(detinfo::DetectorClocksData const& clockData,
+                                                                                geo::View_t view,
+                                                                                std::vector<std::vector<T>*> const& funcs,
+                                                                                util::FFTWorkspaceSBND& fft) const
+{
+  std::vector<TComplex> const& kern = SignalShaping(view).DeconvKernel();
+
+  // put the time offset back: func[i] <- func[i + time_offset]
+  int const shift = FieldResponseTOffset(clockData, view);
+
+  for (std::vector<T>* func: funcs) fft.Convolute(*func, kern, shift);
+}
+
+
+//----------------------------------------------------------------------
+// Remove the field response time offset (a negative number of ticks)
+// from a convoluted waveform.
+template <class T> inline void util::SignalShapingServiceSBND::ShiftConvoluted(std::vector<T>& func, int time_offset)
+{
+  if (time_offset <= 0)
+    std::rotate(func.begin(), func.begin()-time_offset, func.end());
+  else
+    std::rotate(func.begin(), func.end()-time_offset, func.end());
+}
+
+
+//----------------------------------------------------------------------
+// Put the field response time offset back after deconvolution.
+template <class T> inline void util::SignalShapingServiceSBND::ShiftDeconvoluted(std::vector<T>& func, int time_offset)
+{
+  if (time_offset <= 0)
+    std::rotate(func.begin(), func.end()+time_offset, func.end());
+  else
+    std::rotate(func.begin(), func.begin()+time_offset, func.end());
 }
 
 DECLARE_ART_SERVICE(util::SignalShapingServiceSBND, LEGACY)
@@ -13,15 +13,29 @@
 #include "lardata/DetectorInfoServices/DetectorPropertiesService.h"
 #include "lardata/DetectorInfoServices/DetectorClocksService.h"
 #include "lardata/Utilities/LArFFT.h"
+#include "art/Framework/Principal/Run.h"
 #include "TFile.h"
 
 //----------------------------------------------------------------------
 // Constructor.
 util::SignalShapingServiceSBND::SignalShapingServiceSBND(const fhicl::ParameterSet& pset,
-								    art::ActivityRegistry& /* reg */) 
+								    art::ActivityRegistry& reg) 
   : fInit(false)
 {
   reconfigure(pset);
+
+  reg.sPreBeginRun.watch(this, &SignalShapingServiceSBND::preBeginRun);
+}
+
+
+//----------------------------------------------------------------------
+// Build the kernels, if not done yet, and the per-channel tables
+// before any module sees the run, so that nothing is initialized
+// lazily from (possibly concurrent) const accessors.
+void util::SignalShapingServiceSBND::preBeginRun(const art::Run& /* run */)
+{
+  init();
+  BuildChannelTables();
 }
 
 
@@ -219,19 +233,19 @@ void util::SignalShapingServiceSBND::reconfigure(const fhicl::ParameterSet& pset
 const util::SignalShaping&
 util::SignalShapingServiceSBND::SignalShaping(unsigned int channel) const
 {
-  if(!fInit)
-    init();
-
-  // Figure out plane type.
-
-  art::ServiceHandle<geo::Geometry> geom;
-  //geo::SigType_t sigtype = geom->SignalType(channel);
+  return SignalShaping(View(channel));
+}
 
-  // we need to distiguish the U and V planes
-  geo::View_t view = geom->View(channel);
+//----------------------------------------------------------------------
+// Accessor for the signal shaper of a view.
+const util::SignalShaping&
+util::SignalShapingServiceSBND::SignalShaping(geo::View_t view) const
+{
+  if(!fInit)
+    throw cet::exception("SignalShapingServiceSBND")
+      << "Signal shaping requested before the beginning of the first run\n";
 
   // Return appropriate shaper.
-  //geo::SigType_t sigtype = geom->SignalType(channel);
 
   if (view == geo::kU)
     return fIndUSignalShaping;
@@ -247,26 +261,19 @@ util::SignalShapingServiceSBND::SignalShaping(unsigned int channel) const
   return fColSignalShaping;
 }
 
+//----------------------------------------------------------------------
+// View of a channel, from the per-channel table.
+geo::View_t util::SignalShapingServiceSBND::View(unsigned int channel) const
+{
+  CheckChannel(channel);
+  return fChannelView[channel];
+}
+
 //---Give Gain Settings to SimWire ---//
 double util::SignalShapingServiceSBND::GetASICGain(unsigned int const channel) const
 {
-  art::ServiceHandle<geo::Geometry> geom;
-  //geo::SigType_t sigtype = geom->SignalType(channel);
-
-  // we need to distiguish the U and V planes
-  geo::View_t view = geom->View(channel);
-
-  double gain = 0.0;
-  if(view == geo::kU)
-    gain = fASICGainInMVPerFC.at(0);
-  else if(view == geo::kV)
-     gain = fASICGainInMVPerFC.at(1);
-  else if(view == geo::kZ)
-    gain = fASICGainInMVPerFC.at(2);
-  else
-    throw cet::exception("SignalShapingServiceSBND")<< "2 can't determine"
-                                                    << " SignalType\n";
-  return gain;
+  CheckChannel(channel);
+  return fChannelASICGain[channel];
 } 
 
 // //---Give Shaping time Settings to SimWire ---//
@@ -293,82 +300,83 @@ double util::SignalShapingServiceSBND::GetASICGain(unsigned int const channel) c
 
 double util::SignalShapingServiceSBND::GetRawNoise(unsigned int const channel) const
 {
-  unsigned int plane;
-  art::ServiceHandle<geo::Geometry> geom;
-  //geo::SigType_t sigtype = geom->SignalType(channel);
-
-  // we need to distiguish the U and V planes
-  geo::View_t view = geom->View(channel);
-
-  if(view == geo::kU)
-    plane = 0;
-  else if(view == geo::kV)
-    plane = 1;
-  else if(view == geo::kZ)
-    plane = 2;
-  else
-    throw cet::exception("SignalShapingServiceSBND")<< "4 can't determine"
-                                                    << " SignalType\n";
-
-  double shapingtime = fShapeTimeConst.at(plane);
-  double gain = fASICGainInMVPerFC.at(plane);
-  int temp;
-  if (shapingtime == 0.5){
-    temp = 0;
-  }else if (shapingtime == 1.0){
-    temp = 1;
-  }else if (shapingtime == 2.0){
-    temp = 2;
-  }else{
-    temp = 3;
-  }
-  double rawNoise;
-  
-  auto tempNoise = fNoiseFactVec.at(plane);
-  rawNoise = tempNoise.at(temp);
-
-  rawNoise *= gain/4.7;
-  return rawNoise;
+  CheckChannel(channel);
+  return fChannelRawNoise[channel];
 }
 
 double util::SignalShapingServiceSBND::GetDeconNoise(unsigned int const channel) const
 {
-  unsigned int plane;
-  art::ServiceHandle<geo::Geometry> geom;
-  //geo::SigType_t sigtype = geom->SignalType(channel);
+  CheckChannel(channel);
+  return fChannelDeconNoise[channel];
+}
 
-  // we need to distiguish the U and V planes
-  geo::View_t view = geom->View(channel);
+//----------------------------------------------------------------------
+void util::SignalShapingServiceSBND::CheckChannel(unsigned int channel) const
+{
+  if (channel >= fChannelView.size())
+    throw cet::exception("SignalShapingServiceSBND")
+      << "No settings for channel " << channel << ": "
+      << fChannelView.size() << " channels known (tables are built at the beginning of the run)\n";
+}
 
+//----------------------------------------------------------------------
+// we need to distiguish the U and V planes
+unsigned int util::SignalShapingServiceSBND::PlaneIndex(geo::View_t view)
+{
   if(view == geo::kU)
-    plane = 0;
+    return 0;
   else if(view == geo::kV)
-    plane = 1;
+    return 1;
   else if(view == geo::kZ)
-    plane = 2;
+    return 2;
   else
-    throw cet::exception("SignalShapingServiceSBND")<< "5 can't determine"
+    throw cet::exception("SignalShapingServiceSBND")<< "4 can't determine"
                                                     << " SignalType\n";
+}
+
+//----------------------------------------------------------------------
+// Fill the per-channel tables of view, gain and noise, which depend on
+// the view of the channel only.
+void util::SignalShapingServiceSBND::BuildChannelTables()
+{
+  constexpr unsigned int NPlanes = 3;
+
+  double gain[NPlanes], rawNoise[NPlanes], deconNoise[NPlanes];
+  for(unsigned int plane = 0; plane < NPlanes; ++plane) {
+    double shapingtime = fShapeTimeConst.at(plane);
+    int temp;
+    if (shapingtime == 0.5){
+      temp = 0;
+    }else if (shapingtime == 1.0){
+      temp = 1;
+    }else if (shapingtime == 2.0){
+      temp = 2;
+    }else{
+      temp = 3;
+    }
+    double const noiseFact = fNoiseFactVec.at(plane).at(temp);
 
-  double shapingtime = fShapeTimeConst.at(plane);
-  int temp;
-  if (shapingtime == 0.5){
-    temp = 0;
-  }else if (shapingtime == 1.0){
-    temp = 1;
-  }else if (shapingtime == 2.0){
-    temp = 2;
-  }else{
-    temp = 3;
+    gain[plane] = fASICGainInMVPerFC.at(plane);
+    rawNoise[plane] = noiseFact*gain[plane]/4.7;
+    // replaced 2000 with fADCPerPCAtLowestASICGain/4.7 because 2000 V/ADC is specific to MicroBooNE
+    deconNoise[plane] = noiseFact /4096.*(fADCPerPCAtLowestASICGain/4.7/4.7) *6.241*1000/fDeconNorm;
   }
-  double deconNoise;
-  
-  auto tempNoise = fNoiseFactVec.at(plane);
-  deconNoise = tempNoise.at(temp);
 
-  // replaced 2000 with fADCPerPCAtLowestASICGain/4.7 because 2000 V/ADC is specific to MicroBooNE
-  deconNoise = deconNoise /4096.*(fADCPerPCAtLowestASICGain/4.7/4.7) *6.241*1000/fDeconNorm;
-  return deconNoise;
+  art::ServiceHandle<geo::Geometry> geom;
+  unsigned int const nChannels = geom->Nchannels();
+
+  fChannelView.resize(nChannels);
+  fChannelASICGain.resize(nChannels);
+  fChannelRawNoise.resize(nChannels);
+  fChannelDeconNoise.resize(nChannels);
+  for(unsigned int channel = 0; channel < nChannels; ++channel) {
+    geo::View_t const view = geom->View(channel);
+    unsigned int const plane = PlaneIndex(view);
+    fChannelView[channel] = view;
+    fChannelASICGain[channel] = gain[plane];
+    fChannelRawNoise[channel] = rawNoise[plane];
+    fChannelDeconNoise[channel] = deconNoise[plane];
+  }
 }
 
 
@@ -878,9 +886,12 @@ void util::SignalShapingServiceSBND::SetResponseSampling()
 int util::SignalShapingServiceSBND::FieldResponseTOffset(detinfo::DetectorClocksData const& clockData,
                                                          unsigned int const channel) const
 {
-  art::ServiceHandle<geo::Geometry> geom;
-  geo::View_t view = geom->View(channel);
+  return FieldResponseTOffset(clockData, View(channel));
+}
 
+int util::SignalShapingServiceSBND::FieldResponseTOffset(detinfo::DetectorClocksData const& clockData,
+                                                         geo::View_t view) const
+{
   double time_offset = 0;
   if(view == geo::kU)
     time_offset = fFieldResponseTOffset.at(0);
@@ -0,0 +1,195 @@
+/**
+ * @file   rawdigit_builder_alloc_test.cxx
+ * @brief  Allocation count benchmark of detsim::RawDigitBuilder
+ *
+ * Usage:
+ *   `rawdigit_builder_alloc_test [NChannels [NSamples]]`
+ *
+ * Digitizes NChannels fake waveforms of NSamples ticks into a
+ * std::vector<raw::RawDigit>, the way SimWireSBND does, counting the calls
+ * to the global operator new in the steady state (after the first
+ * channels). The builder is compared with the previous pipeline, which
+ * copied a scratch buffer into each digit and copied the digit into a
+ * collection that was not reserved.
+ *
+ * The digits of the two pipelines must be identical (channel, samples,
+ * compression, pedestal and compressed ADC), and must uncompress to the
+ * original waveforms. Without compression the builder must not need more
+ * than one allocation per channel, i.e. the digit payload. The test fails
+ * otherwise.
+ */
+
+// SBND libraries
+#include "sbndcode/DetectorSim/RawDigitBuilder.h"
+
+// LArSoft libraries
+#include "lardataobj/RawData/RawDigit.h"
+#include "lardataobj/RawData/raw.h"
+
+// C/C++ standard libraries
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+
+//------------------------------------------------------------------------------
+//--- allocation counter
+//---
+namespace {
+  std::atomic<unsigned long> gNAllocations{0};
+}
+
+void* operator new(std::size_t size) {
+  ++gNAllocations;
+  if (void* p = std::malloc(size? size: 1)) return p;
+  throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+
+//------------------------------------------------------------------------------
+namespace {
+
+  struct BenchmarkResult_t {
+    double allocationsPerChannel;
+    double microsecondsPerChannel;
+  };
+
+  // a slowly varying baseline with some structure, so that Huffman
+  // compression has something to do
+  void FillWaveform(unsigned int chan, std::vector<short>& adcs) {
+    for (std::size_t i = 0; i < adcs.size(); ++i)
+      adcs[i] = 2000 + (short) ((chan*7 + i*13) % 5) - 2 + ((i % 500 < 20)? 100: 0);
+  }
+
+
+  // previous pipeline: scratch buffer copied into the digit, digit copied
+  // into a collection which was not reserved
+  BenchmarkResult_t RunCopyPipeline(unsigned int nChannels, std::size_t nSamples,
+                                    raw::Compress_t compression, std::vector<raw::RawDigit>& digits)
+  {
+    digits.clear();
+    std::vector<short> adcvec(nSamples, 0);
+    unsigned int const nWarmup = nChannels/10;
+    unsigned long startAllocations = 0;
+    auto startTime = std::chrono::steady_clock::now();
+    for (unsigned int chan = 0; chan < nChannels; ++chan) {
+      if (chan == nWarmup) {
+        startAllocations = gNAllocations;
+        startTime = std::chrono::steady_clock::now();
+      }
+      adcvec.resize(nSamples);
+      FillWaveform(chan, adcvec);
+      raw::Compress(adcvec, compression);
+      raw::RawDigit rd(chan, nSamples, adcvec, compression);
+      rd.SetPedestal(2000.);
+      digits.push_back(rd);
+    }
+    std::chrono::duration<double, std::micro> const elapsed
+      = std::chrono::steady_clock::now() - startTime;
+    unsigned int const nMeasured = nChannels - nWarmup;
+    return {
+      double(gNAllocations - startAllocations)/nMeasured,
+      elapsed.count()/nMeasured
+    };
+  }
+
+
+  // the pipeline of SimWireSBND: reserved collection, digit buffer moved in
+  BenchmarkResult_t RunBuilderPipeline(unsigned int nChannels, std::size_t nSamples,
+                                       raw::Compress_t compression, std::vector<raw::RawDigit>& digits)
+  {
+    digits.clear();
+    digits.reserve(nChannels);
+    detsim::RawDigitBuilder digitBuilder(nSamples, compression);
+    unsigned int const nWarmup = nChannels/10;
+    unsigned long startAllocations = 0;
+    auto startTime = std::chrono::steady_clock::now();
+    for (unsigned int chan = 0; chan < nChannels; ++chan) {
+      if (chan == nWarmup) {
+        startAllocations = gNAllocations;
+        startTime = std::chrono::steady_clock::now();
+      }
+      FillWaveform(chan, digitBuilder.ADCs());
+      digits.push_back(digitBuilder.Make(chan, 2000.));
+    }
+    std::chrono::duration<double, std::micro> const elapsed
+      = std::chrono::steady_clock::now() - startTime;
+    unsigned int const nMeasured = nChannels - nWarmup;
+    return {
+      double(gNAllocations - startAllocations)/nMeasured,
+      elapsed.count()/nMeasured
+    };
+  }
+
+
+  // number of digits which differ from the reference ones or do not
+  // uncompress to their waveform
+  unsigned int CheckDigits(std::vector<raw::RawDigit> const& digits,
+                           std::vector<raw::RawDigit> const& reference, std::size_t nSamples)
+  {
+    if (digits.size() != reference.size()) {
+      std::cerr << digits.size() << " digits, " << reference.size() << " expected!" << std::endl;
+      return 1;
+    }
+    unsigned int nErrors = 0;
+    std::vector<short> adcs(nSamples), expected(nSamples);
+    for (std::size_t i = 0; i < digits.size(); ++i) {
+      raw::RawDigit const& digit = digits[i];
+      raw::RawDigit const& ref = reference[i];
+      if (digit.Channel() != ref.Channel() || digit.Samples() != ref.Samples()
+          || digit.Compression() != ref.Compression() || digit.GetPedestal() != ref.GetPedestal()
+          || digit.ADCs() != ref.ADCs()) {
+        std::cerr << "Digit of channel " << digit.Channel() << " differs from the copy pipeline one!" << std::endl;
+        ++nErrors;
+        continue;
+      }
+      raw::Uncompress(digit.ADCs(), adcs, digit.Compression());
+      FillWaveform(digit.Channel(), expected);
+      if (adcs != expected || digit.Samples() != nSamples) {
+        std::cerr << "Digit of channel " << digit.Channel() << " does not match its waveform!" << std::endl;
+        ++nErrors;
+      }
+    }
+    return nErrors;
+  }
+
+} // local namespace
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char** argv) {
+
+  unsigned int const nChannels = (argc > 1)? std::stoul(argv[1]): 11264;
+  std::size_t const nSamples = (argc > 2)? std::stoul(argv[2]): 3400;
+
+  int nErrors = 0;
+  for (raw::Compress_t compression: { raw::kNone, raw::kHuffman }) {
+    std::vector<raw::RawDigit> copyDigits, builderDigits;
+    BenchmarkResult_t const copy = RunCopyPipeline(nChannels, nSamples, compression, copyDigits);
+    BenchmarkResult_t const builder = RunBuilderPipeline(nChannels, nSamples, compression, builderDigits);
+
+    nErrors += CheckDigits(builderDigits, copyDigits, nSamples);
+
+    std::cout << "Compression " << compression << ", " << nChannels << " channels x "
+      << nSamples << " samples:"
+      << "\n  copy pipeline:    " << copy.allocationsPerChannel << " allocations/channel, "
+      << copy.microsecondsPerChannel << " us/channel"
+      << "\n  builder pipeline: " << builder.allocationsPerChannel << " allocations/channel, "
+      << builder.microsecondsPerChannel << " us/channel"
+      << std::endl;
+
+    if ((compression == raw::kNone) && (builder.allocationsPerChannel > 1.0)) {
+      std::cerr << "Uncompressed digitization takes more than one allocation per channel!"
+        << std::endl;
+      ++nErrors;
+    }
+  } // for compression
+
+  return nErrors;
+} // main()
@@ -0,0 +1,311 @@
+/**
+ * @file   simple_flash_algo_test.cxx
+ * @brief  Comparison of lightana::SimpleFlashAlgo with its previous algorithm
+ *
+ * Usage:
+ *   `simple_flash_algo_test [NEvents]`
+ *
+ * Random sets of optical hits (flashes of different size, hits in the same
+ * time bin, single photoelectron background, channels not used by the
+ * algorithm and hits in a veto range) are clustered with
+ * lightana::SimpleFlashAlgo and with a copy of the previous, dense
+ * implementation (a PE sum for each time bin of the event, candidates
+ * ordered through a map, claimed flashes searched linearly).
+ *
+ * A few configurations are tried: the default one, null thresholds (empty
+ * time bins are candidates too), short veto and integral windows, and a
+ * null veto with a long pre-sample, where several candidates are clamped to
+ * start at the first time bin. Each event also has a burst of hits right
+ * at its start for the latter.
+ *
+ * The test fails if any flash (time, width, PE per channel and associated
+ * hits) differs between the two.
+ */
+
+// SBND libraries
+#include "sbndcode/OpDetReco/OpFlash/FlashFinder/SimpleFlashAlgo.h"
+
+// framework libraries
+#include "fhiclcpp/ParameterSet.h"
+
+// C/C++ standard libraries
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+//------------------------------------------------------------------------------
+namespace {
+
+  struct Config_t {
+    std::string name;
+    double peThreshold = 10.;
+    double minPECoinc = 5.;
+    double minMultCoinc = 2.;
+    double integralTime = 8.;
+    double preSample = 0.1;
+    double vetoSize = 8.;
+    double timeResolution = 0.03;
+  };
+
+  std::vector<double> const VetoRangeStart { 40. };
+  std::vector<double> const VetoRangeEnd   { 50. };
+  std::size_t const NChannels = 312;
+
+
+  std::vector<Config_t> MakeConfigs() {
+    std::vector<Config_t> configs;
+
+    configs.push_back(Config_t{ "default" });
+
+    Config_t all { "null thresholds" };
+    all.peThreshold = all.minPECoinc = all.minMultCoinc = 0.;
+    configs.push_back(all);
+
+    Config_t narrow { "short windows" };
+    narrow.integralTime = narrow.vetoSize = 0.1;
+    configs.push_back(narrow);
+
+    // the veto is shorter than a time bin, and the pre-sample spans many
+    Config_t noVeto { "no veto" };
+    noVeto.peThreshold = noVeto.minPECoinc = noVeto.minMultCoinc = 0.;
+    noVeto.integralTime = noVeto.vetoSize = 0.02;
+    noVeto.preSample = 2.;
+    configs.push_back(noVeto);
+
+    Config_t noVetoCoinc { "no veto, coincidence thresholds" };
+    noVetoCoinc.peThreshold = 0.;
+    noVetoCoinc.integralTime = noVetoCoinc.vetoSize = 0.02;
+    noVetoCoinc.preSample = 2.;
+    configs.push_back(noVetoCoinc);
+
+    return configs;
+  }
+
+
+  // channels used by the algorithm: the ones not multiple of 3
+  std::vector<int> UsedChannels() {
+    std::vector<int> channels;
+    for (std::size_t ch = 0; ch < NChannels; ++ch) if (ch % 3) channels.push_back(ch);
+    return channels;
+  }
+
+
+  fhicl::ParameterSet MakeParameterSet(Config_t const& config) {
+    fhicl::ParameterSet pset;
+    pset.put("PEThreshold", config.peThreshold);
+    pset.put("MinPECoinc", config.minPECoinc);
+    pset.put("MinMultCoinc", config.minMultCoinc);
+    pset.put("IntegralTime", config.integralTime);
+    pset.put("PreSample", config.preSample);
+    pset.put("VetoSize", config.vetoSize);
+    pset.put("TimeResolution", config.timeResolution);
+    pset.put("HitVetoRangeStart", VetoRangeStart);
+    pset.put("HitVetoRangeEnd", VetoRangeEnd);
+    pset.put("OpChannel", UsedChannels());
+    return pset;
+  }
+
+
+  lightana::LiteOpHitArray_t MakeHits(std::mt19937& gen) {
+    std::uniform_real_distribution<double> eventTime(-50., 60.);
+    std::exponential_distribution<double> delay(0.5), pe(0.3);
+    lightana::LiteOpHitArray_t hits;
+
+    auto addHit = [&hits](std::size_t channel, double time, double pe) {
+      lightana::LiteOpHit_t hit;
+      hit.channel = channel;
+      hit.peak_time = time;
+      hit.pe = pe;
+      hits.push_back(hit);
+    };
+
+    // flashes, some of their hits in the same time bin; some channels
+    // beyond the ones the algorithm knows
+    int const nFlashes = 1 + gen() % 10;
+    for (int f = 0; f < nFlashes; ++f) {
+      double const t0 = eventTime(gen);
+      int const nHits = gen() % 200;
+      for (int k = 0; k < nHits; ++k) {
+        double time = t0 + delay(gen) * ((gen() % 4)? 0.02: 1.);
+        if (gen() % 10 == 0) time = t0;
+        addHit(gen() % (NChannels + 20), time, (gen() % 5 == 0)? 1.: pe(gen));
+      }
+    }
+
+    // burst at the start of the event, within the pre-sample of the first bin
+    double const tStart = -60.;
+    std::uniform_real_distribution<double> burstTime(tStart, tStart + 1.);
+    for (int k = 0; k < 40; ++k) addHit(1 + 3*(gen() % (NChannels/3)), burstTime(gen), pe(gen));
+
+    // single photoelectron background
+    for (int k = 0; k < 100; ++k) addHit(gen() % NChannels, eventTime(gen), 1.);
+
+    std::shuffle(hits.begin(), hits.end(), gen);
+    return hits;
+  }
+
+
+  // the previous implementation of lightana::SimpleFlashAlgo::RecoFlash()
+  lightana::LiteOpFlashArray_t ReferenceRecoFlash
+    (Config_t const& config, lightana::LiteOpHitArray_t const& ophits)
+  {
+    std::vector<int> const index_to_opch_v = UsedChannels();
+    std::vector<int> opch_to_index_v(index_to_opch_v.back() + 1, -1);
+    for (std::size_t i = 0; i < index_to_opch_v.size(); ++i) opch_to_index_v[index_to_opch_v[i]] = i;
+    std::size_t const max_ch = opch_to_index_v.size() - 1;
+    std::size_t const NOpDet = index_to_opch_v.size();
+    double const time_res = config.timeResolution;
+
+    auto veto = [](double t) {
+      for (std::size_t i = 0; i < VetoRangeStart.size(); ++i)
+        if (t >= VetoRangeStart[i] && t <= VetoRangeEnd[i]) return true;
+      return false;
+    };
+
+    double min_time = 1.1e20, max_time = 1.1e20;
+    for (auto const& oph: ophits) {
+      if (max_time > 1.e20 || oph.peak_time > max_time) max_time = oph.peak_time;
+      if (min_time > 1.e20 || oph.peak_time < min_time) min_time = oph.peak_time;
+    }
+    min_time -= 10*time_res;
+    max_time += 10*time_res;
+
+    std::size_t const nbins = (std::size_t)((max_time - min_time) / time_res) + 1;
+    std::vector<double> pesum_v(nbins, 0.), mult_v(nbins, 0.);
+    std::vector<std::vector<double>> pespec_v(nbins, std::vector<double>(NOpDet, 0.));
+    std::vector<std::vector<unsigned int>> hitidx_v(nbins);
+
+    for (std::size_t hitidx = 0; hitidx < ophits.size(); ++hitidx) {
+      auto const& oph = ophits[hitidx];
+      if (oph.channel > max_ch || opch_to_index_v[oph.channel] < 0) continue;
+      if (veto(oph.peak_time)) continue;
+      std::size_t const index = (std::size_t)((oph.peak_time - min_time) / time_res);
+      pesum_v[index] += oph.pe;
+      mult_v[index] += 1;
+      pespec_v[index][opch_to_index_v[oph.channel]] += oph.pe;
+      hitidx_v[index].push_back(hitidx);
+    }
+
+    std::map<double, std::size_t> pesum_idx_map;
+    for (std::size_t idx = 0; idx < nbins; ++idx) {
+      if (pesum_v[idx] < config.minPECoinc) continue;
+      if (mult_v[idx] < config.minMultCoinc) continue;
+      pesum_idx_map[1./(pesum_v[idx])] = idx;
+    }
+
+    std::vector<std::pair<std::size_t, std::size_t>> flash_period_v;
+    std::vector<std::size_t> flash_time_v;
+    std::size_t const veto_ctr = (std::size_t)(config.vetoSize / time_res);
+    std::size_t const default_integral_ctr = (std::size_t)(config.integralTime / time_res);
+    std::size_t const precount = (std::size_t)(config.preSample / time_res);
+
+    for (auto const& pe_idx: pesum_idx_map) {
+      auto const& idx = pe_idx.second;
+      std::size_t const start_time = (idx < precount)? 0: idx - precount;
+
+      bool skip = false;
+      std::size_t integral_ctr = default_integral_ctr;
+      for (auto const& used_period: flash_period_v) {
+        if (start_time <= used_period.first && (start_time + veto_ctr) > used_period.first) {
+          skip = true;
+          break;
+        }
+        if (used_period.first <= start_time && start_time < (used_period.first + veto_ctr)) {
+          skip = true;
+          break;
+        }
+        if (used_period.first >= start_time && used_period.first < (start_time + integral_ctr))
+          integral_ctr = used_period.first - start_time;
+      }
+      if (skip) continue;
+
+      double pesum = 0;
+      for (std::size_t i = start_time; i < std::min(nbins, start_time + integral_ctr); ++i)
+        pesum += pesum_v[i];
+      if (pesum < config.peThreshold) continue;
+
+      flash_period_v.emplace_back(start_time, integral_ctr);
+      flash_time_v.push_back(idx);
+    }
+
+    lightana::LiteOpFlashArray_t res;
+    for (std::size_t flash_idx = 0; flash_idx < flash_period_v.size(); ++flash_idx) {
+      auto const& start = flash_period_v[flash_idx].first;
+      auto const& period = flash_period_v[flash_idx].second;
+      auto const& time = flash_time_v[flash_idx];
+
+      std::vector<double> pe_v(max_ch + 1, 0);
+      std::vector<unsigned int> asshit_v;
+      for (std::size_t index = start; index < (start + period) && index < nbins; ++index) {
+        for (std::size_t pmt_index = 0; pmt_index < NOpDet; ++pmt_index)
+          pe_v[index_to_opch_v[pmt_index]] += pespec_v[index][pmt_index];
+        asshit_v.insert(asshit_v.end(), hitidx_v[index].begin(), hitidx_v[index].end());
+      }
+
+      res.emplace_back(min_time + time * time_res, period * time_res / 2.,
+                       std::move(pe_v), std::move(asshit_v));
+    }
+    return res;
+  }
+
+
+  // number of flashes which differ
+  int CompareFlashes(lightana::LiteOpFlashArray_t const& flashes,
+                     lightana::LiteOpFlashArray_t const& expected)
+  {
+    if (flashes.size() != expected.size()) {
+      std::cerr << "  " << flashes.size() << " flashes, expected " << expected.size() << std::endl;
+      return 1 + std::max(flashes.size(), expected.size());
+    }
+    int nErrors = 0;
+    for (std::size_t i = 0; i < flashes.size(); ++i) {
+      auto const& flash = flashes[i];
+      auto const& exp = expected[i];
+      if (flash.time == exp.time && flash.time_err == exp.time_err
+          && flash.channel_pe == exp.channel_pe && flash.asshit_idx == exp.asshit_idx)
+        continue;
+      std::cerr << "  flash #" << i << " at " << flash.time << " (width " << flash.time_err
+        << ", " << flash.asshit_idx.size() << " hits), expected at " << exp.time
+        << " (width " << exp.time_err << ", " << exp.asshit_idx.size() << " hits)" << std::endl;
+      ++nErrors;
+    }
+    return nErrors;
+  }
+
+} // local namespace
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char** argv) {
+
+  unsigned int const nEvents = (argc > 1)? std::atoi(argv[1]): 50;
+
+  int nErrors = 0;
+  for (auto const& config: MakeConfigs()) {
+    lightana::SimpleFlashAlgo algo("SimpleFlashAlgo");
+    algo.Configure(MakeParameterSet(config));
+
+    std::mt19937 gen(20200917);
+    std::size_t nFlashes = 0;
+    int nConfigErrors = 0;
+    for (unsigned int event = 0; event < nEvents; ++event) {
+      lightana::LiteOpHitArray_t const hits = MakeHits(gen);
+      lightana::LiteOpFlashArray_t const flashes = algo.RecoFlash(hits);
+      int const nEventErrors = CompareFlashes(flashes, ReferenceRecoFlash(config, hits));
+      if (nEventErrors) std::cerr << "  (" << config.name << ", event " << event << ")" << std::endl;
+      nConfigErrors += nEventErrors;
+      nFlashes += flashes.size();
+    }
+    std::cout << config.name << ": " << nFlashes << " flashes in " << nEvents << " events, "
+      << nConfigErrors << " differences" << std::endl;
+    nErrors += nConfigErrors;
+  }
+
+  return nErrors;
+}
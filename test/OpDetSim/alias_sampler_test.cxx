@@ -0,0 +1,215 @@
+/**
+ * @file   alias_sampler_test.cxx
+ * @brief  Test of opdet::AliasSampler against CLHEP::RandGeneral
+ *
+ * Usage:
+ *   `alias_sampler_test [NSamples]`
+ *
+ * For a set of binned distributions (a flat one, a TPB-like emission time
+ * spectrum, one with empty bins and negative weights, a single bin and an
+ * all-zero one):
+ *  - the bin probabilities encoded in the alias tables must match the
+ *    normalized weights;
+ *  - NSamples values from the alias sampler and from CLHEP::RandGeneral
+ *    (continuous interpolation, as used by the optical digitizers) are
+ *    histogrammed with twice as many bins as the distribution, and the
+ *    two histograms must be compatible with each other (chi2 test) and
+ *    with the expected distribution; the means are compared too.
+ */
+
+// SBND libraries
+#include "sbndcode/OpDetSim/AliasSampler.hh"
+
+// CLHEP libraries
+#include "CLHEP/Random/MixMaxRng.h"
+#include "CLHEP/Random/RandGeneral.h"
+
+// C/C++ standard libraries
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+//------------------------------------------------------------------------------
+namespace {
+
+  struct TestCase_t {
+    std::string name;
+    std::vector<double> pdf;
+  };
+
+  std::vector<TestCase_t> MakeTestCases() {
+    std::vector<TestCase_t> cases;
+
+    cases.push_back({ "flat", std::vector<double>(100, 1.0) });
+
+    // fast rise and slow exponential decay, as the TPB emission times
+    std::vector<double> tpb(500);
+    for (std::size_t i = 0; i < tpb.size(); ++i)
+      tpb[i] = (1.0 - std::exp(-(i + 0.5)/2.0)) * std::exp(-(i + 0.5)/50.0);
+    cases.push_back({ "TPB-like", tpb });
+
+    // empty bins, negative weights (taken as 0) and a dominant spike
+    std::vector<double> spiky(60, 0.0);
+    for (std::size_t i = 0; i < spiky.size(); i += 3) spiky[i] = 1.0 + (i % 7);
+    spiky[10] = -2.0;
+    spiky[31] = 200.0;
+    cases.push_back({ "spiky", spiky });
+
+    cases.push_back({ "single bin", { 3.0 } });
+    cases.push_back({ "all zero", std::vector<double>(20, 0.0) });
+
+    return cases;
+  }
+
+
+  // expected probability of each bin, as CLHEP::RandGeneral computes it
+  std::vector<double> ExpectedProbabilities(std::vector<double> const& pdf) {
+    std::vector<double> prob(pdf.size());
+    double total = 0.0;
+    for (std::size_t i = 0; i < pdf.size(); ++i) total += prob[i] = std::max(pdf[i], 0.0);
+    for (double& p: prob) p = (total > 0.0)? p/total: 1.0/pdf.size();
+    return prob;
+  }
+
+
+  std::vector<double> Histogram(std::vector<double> const& values, std::size_t nBins) {
+    std::vector<double> histo(nBins, 0.0);
+    for (double x: values) {
+      std::size_t const bin = static_cast<std::size_t>(x * nBins);
+      histo[std::min(bin, nBins - 1)] += 1.0;
+    }
+    return histo;
+  }
+
+
+  // chi2 per degree of freedom of two histograms with the same number of
+  // entries, ignoring the bins empty in both; ndf is returned too
+  double ChiSquare2(std::vector<double> const& a, std::vector<double> const& b, unsigned int& ndf) {
+    double chi2 = 0.0;
+    ndf = 0;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+      if (a[i] + b[i] == 0.0) continue;
+      chi2 += (a[i] - b[i])*(a[i] - b[i]) / (a[i] + b[i]);
+      ++ndf;
+    }
+    return ndf? chi2/ndf: 0.0;
+  }
+
+  // chi2 per degree of freedom of a histogram and its expectation
+  double ChiSquare(std::vector<double> const& h, std::vector<double> const& expected, unsigned int& ndf) {
+    double chi2 = 0.0;
+    ndf = 0;
+    for (std::size_t i = 0; i < h.size(); ++i) {
+      if (expected[i] == 0.0) {
+        if (h[i] > 0.0) return 1e9; // entries where none is expected
+        continue;
+      }
+      chi2 += (h[i] - expected[i])*(h[i] - expected[i]) / expected[i];
+      ++ndf;
+    }
+    return ndf? chi2/ndf: 0.0;
+  }
+
+  // whether a chi2 per degree of freedom is acceptable (5 standard deviations)
+  bool GoodChiSquare(double chi2ndf, unsigned int ndf) {
+    return (ndf == 0) || (chi2ndf < 1.0 + 5.0*std::sqrt(2.0/ndf));
+  }
+
+
+  int TestCase(TestCase_t const& test, std::size_t nSamples) {
+    int nErrors = 0;
+    std::size_t const n = test.pdf.size();
+    std::vector<double> const prob = ExpectedProbabilities(test.pdf);
+
+    CLHEP::MixMaxRng aliasEngine(1234), generalEngine(5678);
+    opdet::AliasSampler alias(test.pdf);
+    CLHEP::RandGeneral general(generalEngine, test.pdf.data(), n);
+
+    // tables
+    double maxDiff = 0.0;
+    for (std::size_t i = 0; i < n; ++i)
+      maxDiff = std::max(maxDiff, std::abs(alias.BinProbability(i) - prob[i]));
+    if (alias.NBins() != n || maxDiff > 1e-12) {
+      std::cerr << test.name << ": alias table probabilities off by up to " << maxDiff << std::endl;
+      ++nErrors;
+    }
+
+    // samples
+    std::vector<double> aliasValues(nSamples), generalValues(nSamples);
+    alias.fireArray(aliasEngine, nSamples, aliasValues.data());
+    general.fireArray(nSamples, generalValues.data());
+
+    for (double x: aliasValues) {
+      if (x < 0.0 || x >= 1.0) {
+        std::cerr << test.name << ": alias sampler value " << x << " out of [0, 1)" << std::endl;
+        ++nErrors;
+        break;
+      }
+    }
+
+    // two sub-bins per bin, to check the uniform distribution inside bins
+    std::size_t const nHistoBins = 2*n;
+    std::vector<double> const aliasHisto = Histogram(aliasValues, nHistoBins);
+    std::vector<double> const generalHisto = Histogram(generalValues, nHistoBins);
+    std::vector<double> expected(nHistoBins);
+    for (std::size_t i = 0; i < nHistoBins; ++i) expected[i] = prob[i/2] * nSamples / 2.0;
+
+    unsigned int ndfAlias, ndfGeneral, ndf2;
+    double const chi2Alias = ChiSquare(aliasHisto, expected, ndfAlias);
+    double const chi2General = ChiSquare(generalHisto, expected, ndfGeneral);
+    double const chi2Both = ChiSquare2(aliasHisto, generalHisto, ndf2);
+
+    double aliasMean = 0.0, generalMean = 0.0, expectedMean = 0.0, expectedVariance = 0.0;
+    for (double x: aliasValues) aliasMean += x;
+    for (double x: generalValues) generalMean += x;
+    aliasMean /= nSamples;
+    generalMean /= nSamples;
+    for (std::size_t i = 0; i < n; ++i) {
+      double const center = (i + 0.5)/n;
+      expectedMean += prob[i] * center;
+      expectedVariance += prob[i] * (center*center + 1.0/(12.0*n*n));
+    }
+    expectedVariance -= expectedMean*expectedMean;
+    double const meanError = std::sqrt(2.0 * expectedVariance / nSamples);
+
+    std::cout << test.name << " (" << n << " bins): chi2/ndf alias " << chi2Alias << " (" << ndfAlias
+      << "), RandGeneral " << chi2General << " (" << ndfGeneral << "), alias vs. RandGeneral "
+      << chi2Both << " (" << ndf2 << "); mean alias " << aliasMean << ", RandGeneral " << generalMean
+      << ", expected " << expectedMean << std::endl;
+
+    if (!GoodChiSquare(chi2Alias, ndfAlias) || !GoodChiSquare(chi2Both, ndf2)) {
+      std::cerr << test.name << ": alias sampler distribution does not match!" << std::endl;
+      ++nErrors;
+    }
+    if (std::abs(aliasMean - generalMean) > 5.0 * meanError + 1e-12) {
+      std::cerr << test.name << ": mean of the alias sampler " << aliasMean
+        << " differs from the one of RandGeneral " << generalMean << std::endl;
+      ++nErrors;
+    }
+
+    // single values
+    double const x = alias.fire(aliasEngine);
+    if (x < 0.0 || x >= 1.0 || prob[std::min(static_cast<std::size_t>(x*n), n - 1)] == 0.0) {
+      std::cerr << test.name << ": single value " << x << " not in the distribution" << std::endl;
+      ++nErrors;
+    }
+
+    return nErrors;
+  }
+
+} // local namespace
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char** argv) {
+
+  std::size_t const nSamples = (argc > 1)? std::stoul(argv[1]): 2000000;
+
+  int nErrors = 0;
+  for (TestCase_t const& test: MakeTestCases()) nErrors += TestCase(test, nSamples);
+
+  return nErrors;
+} // main()
@@ -0,0 +1,160 @@
+/**
+ * @file   ophit_peak_finder_benchmark.cxx
+ * @brief  Timing and consistency benchmark of opdet::FindOpHitPeaks
+ *
+ * Usage:
+ *   `ophit_peak_finder_benchmark [Threshold [WaveformFile]]`
+ *
+ * Finds the peaks of a set of waveforms with opdet::FindOpHitPeaks and
+ * with the previous algorithm of opHitFinderSBND (maximum of the whole
+ * waveform, peak zeroed, repeated until below threshold), and compares
+ * both the peaks and the time taken per waveform.
+ *
+ * The waveforms are read from WaveformFile if given, one per line as
+ * samples separated by blanks, already baseline-subtracted with the pulses
+ * positive (as opHitFinderSBND passes them to the peak finder). Otherwise
+ * a set of busy, cosmic-like waveforms is generated: 5000 ticks of noise
+ * with a few hundred single and piled-up pulses each.
+ *
+ * The test fails if any peak differs between the two algorithms.
+ */
+
+// SBND libraries
+#include "sbndcode/OpDetSim/OpHitPeakFinder.hh"
+
+// C/C++ standard libraries
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+//------------------------------------------------------------------------------
+namespace {
+
+  // the algorithm of opHitFinderSBND::findAndSuppressPeak()
+  bool FindAndSuppressPeak(std::vector<float>& waveform, double threshold, opdet::OpHitPeak& peak) {
+    auto const max_element_it = std::max_element(waveform.begin(), waveform.end());
+    peak.amplitude = *max_element_it;
+    if (peak.amplitude < threshold) return false;
+    peak.timebin = std::distance(waveform.begin(), max_element_it);
+    auto const it_e = std::find_if(max_element_it, waveform.end(),
+      [threshold](double x){ return x < threshold; });
+    auto const it_s = std::find_if(std::make_reverse_iterator(max_element_it),
+      std::make_reverse_iterator(waveform.begin()),
+      [threshold](double x){ return x < threshold; }).base();
+    peak.sum = std::accumulate(it_s, it_e, 0.0);
+    peak.start = std::distance(waveform.begin(), it_s);
+    peak.end = std::distance(waveform.begin(), it_e);
+    std::fill(it_s, it_e, 0.0);
+    return true;
+  }
+
+
+  std::vector<std::vector<float>> ReadWaveforms(std::string const& fileName) {
+    std::vector<std::vector<float>> waveforms;
+    std::ifstream file(fileName);
+    if (!file) {
+      std::cerr << "Can't open waveform file '" << fileName << "'" << std::endl;
+      return waveforms;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+      std::istringstream samples(line);
+      std::vector<float> waveform
+        { std::istream_iterator<float>(samples), std::istream_iterator<float>() };
+      if (!waveform.empty()) waveforms.push_back(std::move(waveform));
+    }
+    return waveforms;
+  }
+
+
+  // busy waveforms: noise plus many pulses of a few photoelectrons, some
+  // of them piled up, with an ADC-like granularity
+  std::vector<std::vector<float>> MakeWaveforms(unsigned int nWaveforms, std::size_t nTicks) {
+    std::mt19937 engine(20201001);
+    std::normal_distribution<double> noise(0.0, 2.0);
+    std::uniform_int_distribution<std::size_t> pulseTime(0, nTicks - 1);
+    std::poisson_distribution<int> nPE(3.0);
+    std::vector<double> pulse(40);
+    for (std::size_t i = 0; i < pulse.size(); ++i)
+      pulse[i] = 8.0 * (std::exp(-(i/6.0)) - std::exp(-(i/1.5)));
+
+    std::vector<std::vector<float>> waveforms(nWaveforms, std::vector<float>(nTicks));
+    for (std::vector<float>& waveform: waveforms) {
+      for (float& sample: waveform) sample = noise(engine);
+      for (int p = 0; p < 300; ++p) {
+        std::size_t const t = pulseTime(engine);
+        int const pe = 1 + nPE(engine);
+        for (std::size_t i = 0; i < pulse.size() && t + i < nTicks; ++i) waveform[t + i] += pe * pulse[i];
+      }
+      for (float& sample: waveform) sample = std::round(sample);
+    }
+    return waveforms;
+  }
+
+
+  bool SamePeak(opdet::OpHitPeak const& a, opdet::OpHitPeak const& b) {
+    return a.timebin == b.timebin && a.amplitude == b.amplitude && a.sum == b.sum
+      && a.start == b.start && a.end == b.end;
+  }
+
+} // local namespace
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char** argv) {
+
+  double const threshold = (argc > 1)? std::stod(argv[1]): 10.0;
+  std::vector<std::vector<float>> const waveforms
+    = (argc > 2)? ReadWaveforms(argv[2]): MakeWaveforms(200, 5000);
+  if (waveforms.empty()) return 1;
+
+  using clock = std::chrono::steady_clock;
+
+  // previous algorithm, on a copy of each waveform (it zeroes the peaks)
+  std::vector<std::vector<opdet::OpHitPeak>> expected(waveforms.size());
+  std::vector<float> work;
+  double oldTime = 0.0;
+  for (std::size_t w = 0; w < waveforms.size(); ++w) {
+    work = waveforms[w];
+    auto const start = clock::now();
+    opdet::OpHitPeak peak;
+    while (FindAndSuppressPeak(work, threshold, peak)) expected[w].push_back(peak);
+    oldTime += std::chrono::duration<double, std::micro>(clock::now() - start).count();
+  }
+
+  // one pass
+  std::vector<opdet::OpHitPeak> peaks;
+  double newTime = 0.0;
+  unsigned long nPeaks = 0;
+  int nErrors = 0;
+  for (std::size_t w = 0; w < waveforms.size(); ++w) {
+    auto const start = clock::now();
+    opdet::FindOpHitPeaks(waveforms[w], threshold, peaks);
+    newTime += std::chrono::duration<double, std::micro>(clock::now() - start).count();
+
+    nPeaks += peaks.size();
+    if (peaks.size() != expected[w].size()
+      || !std::equal(peaks.begin(), peaks.end(), expected[w].begin(), SamePeak))
+    {
+      std::cerr << "Waveform #" << w << ": " << peaks.size() << " peaks found, "
+        << expected[w].size() << " expected, or different peaks" << std::endl;
+      ++nErrors;
+    }
+  }
+
+  std::cout << waveforms.size() << " waveforms, " << nPeaks << " peaks above " << threshold
+    << ":\n  max_element and suppress: " << oldTime/waveforms.size() << " us/waveform"
+    << "\n  one pass:                 " << newTime/waveforms.size() << " us/waveform"
+    << std::endl;
+
+  return nErrors;
+} // main()